@@ -0,0 +1,834 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128archive.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#define gst_ebur128_archive_lseek lseek
+#define gst_ebur128_archive_ftruncate ftruncate
+#else
+#include <io.h>
+#define gst_ebur128_archive_lseek _lseeki64
+#define gst_ebur128_archive_ftruncate _chsize_s
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+// time, timestamp, running-time and stream-time
+#define GST_EBUR128_ARCHIVE_TIME_COLUMNS 4
+
+// momentary, shortterm, global and range, followed by the windows and two peaks per channel
+#define GST_EBUR128_ARCHIVE_VALUE_COLUMNS(channels, num_windows) (4 + (num_windows) + 2 * (channels))
+
+typedef struct {
+  GByteArray *bytes;
+  guint64 bits;
+} GstEbur128BitWriter;
+
+typedef struct {
+  const guint8 *data;
+  guint64 bits;
+  guint64 position;
+} GstEbur128BitReader;
+
+typedef struct {
+  guint64 previous;
+  guint64 delta;
+} GstEbur128DeltaState;
+
+typedef struct {
+  guint64 previous;
+  guint leading;
+  guint trailing;
+} GstEbur128XorState;
+
+// buckets of the delta-of-deltas after a prefix of 0, 1, 2, 3 or 4 one-bits; 0 bits is a delta-of-delta of 0
+static const guint gst_ebur128_archive_delta_bits[] = {0, 7, 9, 12, 64};
+
+struct _GstEbur128ArchiveWriter {
+  gchar *location;
+  int fd;
+  guint block_records;
+  GArray *blocks;
+
+  // block that is being compressed, only written once it is complete
+  GstEbur128ArchiveBlock block;
+  guint32 flags;
+  guint32 channels;
+  guint32 num_windows;
+  GstEbur128BitWriter payload;
+  GstEbur128DeltaState times[GST_EBUR128_ARCHIVE_TIME_COLUMNS];
+  GstEbur128XorState *values;
+};
+
+struct _GstEbur128ArchiveReader {
+  gchar *location;
+  int fd;
+  GArray *blocks;
+
+  // blocks are ordered by time, so queries can bisect the index
+  gboolean ordered;
+};
+
+static void gst_ebur128_archive_set_error(GError **error, const gchar *what, const gchar *location) {
+  int errsv = errno;
+  g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errsv), "could not %s %s: %s", what, location,
+              g_strerror(errsv));
+}
+
+static void gst_ebur128_archive_set_invalid(GError **error, const gchar *location, const gchar *reason) {
+  g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s is not a valid loudness archive: %s", location, reason);
+}
+
+static void gst_ebur128_archive_put_u32(guint8 *data, guint32 value) {
+  value = GUINT32_TO_LE(value);
+  memcpy(data, &value, sizeof(value));
+}
+
+static void gst_ebur128_archive_put_u64(guint8 *data, guint64 value) {
+  value = GUINT64_TO_LE(value);
+  memcpy(data, &value, sizeof(value));
+}
+
+static guint32 gst_ebur128_archive_get_u32(const guint8 *data) {
+  guint32 value;
+  memcpy(&value, data, sizeof(value));
+  return GUINT32_FROM_LE(value);
+}
+
+static guint64 gst_ebur128_archive_get_u64(const guint8 *data) {
+  guint64 value;
+  memcpy(&value, data, sizeof(value));
+  return GUINT64_FROM_LE(value);
+}
+
+static gboolean gst_ebur128_archive_write_all(int fd, const guint8 *data, gsize size) {
+  while (size > 0) {
+    gssize ret = write(fd, data, size);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      return FALSE;
+    }
+    data += ret;
+    size -= ret;
+  }
+  return TRUE;
+}
+
+// reads exactly size bytes at offset, a short file is reported as EIO
+static gboolean gst_ebur128_archive_read_at(int fd, guint64 offset, guint8 *data, gsize size) {
+  if (gst_ebur128_archive_lseek(fd, offset, SEEK_SET) < 0) {
+    return FALSE;
+  }
+  while (size > 0) {
+    gssize ret = read(fd, data, size);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      if (ret == 0) {
+        errno = EIO;
+      }
+      return FALSE;
+    }
+    data += ret;
+    size -= ret;
+  }
+  return TRUE;
+}
+
+static guint gst_ebur128_archive_leading_zeros(guint64 value) {
+#if defined(__GNUC__)
+  return __builtin_clzll(value);
+#else
+  guint n = 0;
+  while (!(value & G_GUINT64_CONSTANT(0x8000000000000000))) {
+    value <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+static guint gst_ebur128_archive_trailing_zeros(guint64 value) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(value);
+#else
+  guint n = 0;
+  while (!(value & 1)) {
+    value >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+// appends the n lowest bits of value, most significant first
+static void gst_ebur128_bit_writer_put(GstEbur128BitWriter *writer, guint64 value, guint n) {
+  while (n > 0) {
+    guint free = 8 - (writer->bits & 7);
+    if (free == 8) {
+      guint8 zero = 0;
+      g_byte_array_append(writer->bytes, &zero, 1);
+    }
+
+    guint take = MIN(free, n);
+    guint8 chunk = (value >> (n - take)) & ((1u << take) - 1);
+    writer->bytes->data[writer->bits >> 3] |= chunk << (free - take);
+    writer->bits += take;
+    n -= take;
+  }
+}
+
+static gboolean gst_ebur128_bit_reader_get(GstEbur128BitReader *reader, guint n, guint64 *value) {
+  if (reader->bits - reader->position < n) {
+    return FALSE;
+  }
+
+  guint64 result = 0;
+  while (n > 0) {
+    guint available = 8 - (reader->position & 7);
+    guint take = MIN(available, n);
+    guint8 byte = reader->data[reader->position >> 3];
+    result = (result << take) | ((byte >> (available - take)) & ((1u << take) - 1));
+    reader->position += take;
+    n -= take;
+  }
+  *value = result;
+  return TRUE;
+}
+
+static void gst_ebur128_archive_put_time(GstEbur128BitWriter *writer, GstEbur128DeltaState *state, guint64 value,
+                                         gboolean first) {
+  if (first) {
+    gst_ebur128_bit_writer_put(writer, value, 64);
+    state->previous = value;
+    state->delta = 0;
+    return;
+  }
+
+  // unsigned arithmetic wraps, so GST_CLOCK_TIME_NONE and steps backwards round-trip as well
+  guint64 delta = value - state->previous;
+  gint64 dod = (gint64)(delta - state->delta);
+  state->previous = value;
+  state->delta = delta;
+
+  guint bucket = 0;
+  while (bucket < G_N_ELEMENTS(gst_ebur128_archive_delta_bits) - 1) {
+    guint bits = gst_ebur128_archive_delta_bits[bucket];
+    if (bits == 0 ? dod == 0 : (dod >= -((gint64)1 << (bits - 1)) && dod < ((gint64)1 << (bits - 1)))) {
+      break;
+    }
+    bucket++;
+  }
+
+  // bucket one-bits, terminated by a zero-bit unless it is the last bucket
+  if (bucket < G_N_ELEMENTS(gst_ebur128_archive_delta_bits) - 1) {
+    gst_ebur128_bit_writer_put(writer, ((1u << bucket) - 1) << 1, bucket + 1);
+  } else {
+    gst_ebur128_bit_writer_put(writer, (1u << bucket) - 1, bucket);
+  }
+  gst_ebur128_bit_writer_put(writer, (guint64)dod, gst_ebur128_archive_delta_bits[bucket]);
+}
+
+static gboolean gst_ebur128_archive_get_time(GstEbur128BitReader *reader, GstEbur128DeltaState *state,
+                                             guint64 *value, gboolean first) {
+  if (first) {
+    if (!gst_ebur128_bit_reader_get(reader, 64, value)) {
+      return FALSE;
+    }
+    state->previous = *value;
+    state->delta = 0;
+    return TRUE;
+  }
+
+  guint bucket = 0;
+  guint64 bit = 1;
+  while (bucket < G_N_ELEMENTS(gst_ebur128_archive_delta_bits) - 1) {
+    if (!gst_ebur128_bit_reader_get(reader, 1, &bit)) {
+      return FALSE;
+    }
+    if (!bit) {
+      break;
+    }
+    bucket++;
+  }
+
+  guint bits = gst_ebur128_archive_delta_bits[bucket];
+  guint64 raw = 0;
+  if (bits > 0 && !gst_ebur128_bit_reader_get(reader, bits, &raw)) {
+    return FALSE;
+  }
+
+  // sign-extend the bucket to 64 bit
+  gint64 dod = bits == 0 || bits == 64 ? (gint64)raw : (gint64)(raw << (64 - bits)) >> (64 - bits);
+  state->delta += (guint64)dod;
+  state->previous += state->delta;
+  *value = state->previous;
+  return TRUE;
+}
+
+static void gst_ebur128_archive_put_value(GstEbur128BitWriter *writer, GstEbur128XorState *state, gdouble value,
+                                          gboolean first) {
+  guint64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  if (first) {
+    gst_ebur128_bit_writer_put(writer, bits, 64);
+    state->previous = bits;
+    state->leading = G_MAXUINT;
+    return;
+  }
+
+  guint64 xor = bits ^ state->previous;
+  state->previous = bits;
+  if (xor == 0) {
+    gst_ebur128_bit_writer_put(writer, 0, 1);
+    return;
+  }
+
+  // the leading zeros have to fit into 5 bits
+  guint leading = MIN(gst_ebur128_archive_leading_zeros(xor), 31);
+  guint trailing = gst_ebur128_archive_trailing_zeros(xor);
+  if (state->leading != G_MAXUINT && leading >= state->leading && trailing >= state->trailing) {
+    // the meaningful bits fit into those of the previous value
+    gst_ebur128_bit_writer_put(writer, 2, 2);
+    gst_ebur128_bit_writer_put(writer, xor >> state->trailing, 64 - state->leading - state->trailing);
+    return;
+  }
+
+  guint meaningful = 64 - leading - trailing;
+  gst_ebur128_bit_writer_put(writer, 3, 2);
+  gst_ebur128_bit_writer_put(writer, leading, 5);
+  gst_ebur128_bit_writer_put(writer, meaningful - 1, 6);
+  gst_ebur128_bit_writer_put(writer, xor >> trailing, meaningful);
+  state->leading = leading;
+  state->trailing = trailing;
+}
+
+static gboolean gst_ebur128_archive_get_value(GstEbur128BitReader *reader, GstEbur128XorState *state, gdouble *value,
+                                              gboolean first) {
+  guint64 bits = 0;
+  if (first) {
+    if (!gst_ebur128_bit_reader_get(reader, 64, &bits)) {
+      return FALSE;
+    }
+    state->leading = G_MAXUINT;
+  } else {
+    guint64 control, xor = 0;
+    if (!gst_ebur128_bit_reader_get(reader, 1, &control)) {
+      return FALSE;
+    }
+    if (control) {
+      if (!gst_ebur128_bit_reader_get(reader, 1, &control)) {
+        return FALSE;
+      }
+
+      if (control) {
+        guint64 leading, meaningful;
+        if (!gst_ebur128_bit_reader_get(reader, 5, &leading) || !gst_ebur128_bit_reader_get(reader, 6, &meaningful)) {
+          return FALSE;
+        }
+        meaningful++;
+        if (leading + meaningful > 64) {
+          return FALSE;
+        }
+        state->leading = leading;
+        state->trailing = 64 - leading - meaningful;
+      } else if (state->leading == G_MAXUINT) {
+        return FALSE;
+      }
+
+      if (!gst_ebur128_bit_reader_get(reader, 64 - state->leading - state->trailing, &xor)) {
+        return FALSE;
+      }
+      xor <<= state->trailing;
+    }
+    bits = state->previous ^ xor;
+  }
+
+  state->previous = bits;
+  memcpy(value, &bits, sizeof(bits));
+  return TRUE;
+}
+
+/**
+ * Collects the time-columns and the value-columns named in the flags of the record, in the order they are stored,
+ * and returns the number of value-columns.
+ */
+static guint gst_ebur128_archive_columns(GstEbur128MeasurementRecord *record, guint64 **times, gdouble **values) {
+  times[0] = &record->timestamp;
+  times[1] = &record->running_time;
+  times[2] = &record->stream_time;
+
+  guint n = 0;
+  const guint32 loudness_flags[] = {GST_EBUR128_META_MOMENTARY, GST_EBUR128_META_SHORTTERM, GST_EBUR128_META_GLOBAL,
+                                    GST_EBUR128_META_RANGE};
+  gdouble *loudness[] = {&record->momentary, &record->shortterm, &record->global, &record->range};
+  for (guint i = 0; i < G_N_ELEMENTS(loudness); i++) {
+    if (record->flags & loudness_flags[i]) {
+      values[n++] = loudness[i];
+    }
+  }
+
+  for (guint i = 0; i < record->num_windows; i++) {
+    values[n++] = gst_ebur128_measurement_windows(record) + i;
+  }
+  if (record->flags & GST_EBUR128_META_SAMPLE_PEAK) {
+    for (guint channel = 0; channel < record->channels; channel++) {
+      values[n++] = gst_ebur128_measurement_sample_peak(record) + channel;
+    }
+  }
+  if (record->flags & GST_EBUR128_META_TRUE_PEAK) {
+    for (guint channel = 0; channel < record->channels; channel++) {
+      values[n++] = gst_ebur128_measurement_true_peak(record) + channel;
+    }
+  }
+  return n;
+}
+
+static void gst_ebur128_archive_parse_entry(const guint8 *data, GstEbur128ArchiveBlock *block) {
+  block->offset = gst_ebur128_archive_get_u64(data);
+  block->first_time = (gint64)gst_ebur128_archive_get_u64(data + 8);
+  block->last_time = (gint64)gst_ebur128_archive_get_u64(data + 16);
+  block->records = gst_ebur128_archive_get_u32(data + 24);
+}
+
+/**
+ * Reads the index from the footer, or rebuilds it from the block-headers of an archive that has not been closed.
+ * end is set to where the next block goes, which is where the index starts or the first incomplete block.
+ */
+static gboolean gst_ebur128_archive_load(int fd, const gchar *location, GArray *blocks, guint64 *end,
+                                         GError **error) {
+  gint64 size = gst_ebur128_archive_lseek(fd, 0, SEEK_END);
+  guint8 header[GST_EBUR128_ARCHIVE_HEADER_SIZE];
+  if (size < 0 || !gst_ebur128_archive_read_at(fd, 0, header, sizeof(header))) {
+    gst_ebur128_archive_set_error(error, "read", location);
+    return FALSE;
+  }
+  if (gst_ebur128_archive_get_u32(header) != GST_EBUR128_ARCHIVE_MAGIC) {
+    gst_ebur128_archive_set_invalid(error, location, "wrong magic");
+    return FALSE;
+  }
+  if (gst_ebur128_archive_get_u32(header + 4) != GST_EBUR128_ARCHIVE_VERSION) {
+    gst_ebur128_archive_set_invalid(error, location, "unsupported version");
+    return FALSE;
+  }
+  guint64 header_size = gst_ebur128_archive_get_u32(header + 8);
+
+  guint8 footer[GST_EBUR128_ARCHIVE_FOOTER_SIZE];
+  if ((guint64)size >= header_size + sizeof(footer) &&
+      gst_ebur128_archive_read_at(fd, size - sizeof(footer), footer, sizeof(footer)) &&
+      gst_ebur128_archive_get_u32(footer + 12) == GST_EBUR128_ARCHIVE_INDEX_MAGIC) {
+    guint64 index_offset = gst_ebur128_archive_get_u64(footer);
+    guint32 n_blocks = gst_ebur128_archive_get_u32(footer + 8);
+    gsize index_size = (gsize)n_blocks * GST_EBUR128_ARCHIVE_INDEX_ENTRY_SIZE;
+
+    if (index_offset >= header_size && index_offset + index_size + sizeof(footer) == (guint64)size) {
+      guint8 *index = g_malloc(index_size);
+      if (!gst_ebur128_archive_read_at(fd, index_offset, index, index_size)) {
+        gst_ebur128_archive_set_error(error, "read", location);
+        g_free(index);
+        return FALSE;
+      }
+
+      g_array_set_size(blocks, n_blocks);
+      for (guint i = 0; i < n_blocks; i++) {
+        gst_ebur128_archive_parse_entry(index + (gsize)i * GST_EBUR128_ARCHIVE_INDEX_ENTRY_SIZE,
+                                        &g_array_index(blocks, GstEbur128ArchiveBlock, i));
+      }
+      g_free(index);
+      *end = index_offset;
+      return TRUE;
+    }
+  }
+
+  // no index, so every block that has been written completely counts
+  guint64 offset = header_size;
+  guint8 block_header[GST_EBUR128_ARCHIVE_BLOCK_HEADER_SIZE];
+  while (offset + sizeof(block_header) <= (guint64)size &&
+         gst_ebur128_archive_read_at(fd, offset, block_header, sizeof(block_header)) &&
+         gst_ebur128_archive_get_u32(block_header) == GST_EBUR128_ARCHIVE_BLOCK_MAGIC) {
+    guint64 payload_size = gst_ebur128_archive_get_u32(block_header + 4);
+    if (offset + sizeof(block_header) + payload_size > (guint64)size) {
+      break;
+    }
+
+    GstEbur128ArchiveBlock block = {
+        .offset = offset,
+        .first_time = (gint64)gst_ebur128_archive_get_u64(block_header + 24),
+        .last_time = (gint64)gst_ebur128_archive_get_u64(block_header + 32),
+        .records = gst_ebur128_archive_get_u32(block_header + 8),
+    };
+    g_array_append_val(blocks, block);
+    offset += sizeof(block_header) + payload_size;
+  }
+  *end = offset;
+  return TRUE;
+}
+
+/**
+ * Opens the archive at location for appending, or creates it. block_records is the number of records compressed into
+ * one block, which is the unit queries read and the most a crash can lose.
+ */
+GstEbur128ArchiveWriter *gst_ebur128_archive_writer_open(const gchar *location, guint block_records, GError **error) {
+  g_return_val_if_fail(location != NULL, NULL);
+  g_return_val_if_fail(block_records > 0, NULL);
+
+  int fd = g_open(location, O_RDWR | O_CREAT | O_BINARY, 0644);
+  if (fd < 0) {
+    gst_ebur128_archive_set_error(error, "open", location);
+    return NULL;
+  }
+
+  GArray *blocks = g_array_new(FALSE, FALSE, sizeof(GstEbur128ArchiveBlock));
+  guint64 end;
+  gint64 size = gst_ebur128_archive_lseek(fd, 0, SEEK_END);
+  if (size == 0) {
+    guint8 header[GST_EBUR128_ARCHIVE_HEADER_SIZE] = {0};
+    gst_ebur128_archive_put_u32(header, GST_EBUR128_ARCHIVE_MAGIC);
+    gst_ebur128_archive_put_u32(header + 4, GST_EBUR128_ARCHIVE_VERSION);
+    gst_ebur128_archive_put_u32(header + 8, GST_EBUR128_ARCHIVE_HEADER_SIZE);
+    if (!gst_ebur128_archive_write_all(fd, header, sizeof(header))) {
+      gst_ebur128_archive_set_error(error, "write", location);
+      goto fail;
+    }
+    end = sizeof(header);
+  } else if (!gst_ebur128_archive_load(fd, location, blocks, &end, error)) {
+    goto fail;
+  }
+
+  // the index is written again when the archive is closed, and an incomplete block is dropped
+  if (gst_ebur128_archive_ftruncate(fd, end) != 0 || gst_ebur128_archive_lseek(fd, end, SEEK_SET) < 0) {
+    gst_ebur128_archive_set_error(error, "truncate", location);
+    goto fail;
+  }
+
+  GstEbur128ArchiveWriter *writer = g_new0(GstEbur128ArchiveWriter, 1);
+  writer->location = g_strdup(location);
+  writer->fd = fd;
+  writer->block_records = block_records;
+  writer->blocks = blocks;
+  writer->payload.bytes = g_byte_array_new();
+  return writer;
+
+fail:
+  g_array_free(blocks, TRUE);
+  close(fd);
+  return NULL;
+}
+
+static gboolean gst_ebur128_archive_writer_write_block(GstEbur128ArchiveWriter *writer, GError **error) {
+  if (writer->block.records == 0) {
+    return TRUE;
+  }
+
+  guint8 header[GST_EBUR128_ARCHIVE_BLOCK_HEADER_SIZE];
+  gst_ebur128_archive_put_u32(header, GST_EBUR128_ARCHIVE_BLOCK_MAGIC);
+  gst_ebur128_archive_put_u32(header + 4, writer->payload.bytes->len);
+  gst_ebur128_archive_put_u32(header + 8, writer->block.records);
+  gst_ebur128_archive_put_u32(header + 12, writer->flags);
+  gst_ebur128_archive_put_u32(header + 16, writer->channels);
+  gst_ebur128_archive_put_u32(header + 20, writer->num_windows);
+  gst_ebur128_archive_put_u64(header + 24, (guint64)writer->block.first_time);
+  gst_ebur128_archive_put_u64(header + 32, (guint64)writer->block.last_time);
+
+  // header and payload go into one write, so a reader that walks the block-headers never sees half a block
+  g_byte_array_prepend(writer->payload.bytes, header, sizeof(header));
+  gboolean success = gst_ebur128_archive_write_all(writer->fd, writer->payload.bytes->data, writer->payload.bytes->len);
+  g_byte_array_set_size(writer->payload.bytes, 0);
+  writer->payload.bits = 0;
+  if (!success) {
+    gst_ebur128_archive_set_error(error, "write", writer->location);
+    return FALSE;
+  }
+
+  g_array_append_val(writer->blocks, writer->block);
+  writer->block.records = 0;
+  return TRUE;
+}
+
+gboolean gst_ebur128_archive_writer_append(GstEbur128ArchiveWriter *writer, gint64 time,
+                                           const GstEbur128MeasurementRecord *record, GError **error) {
+  if (writer->block.records > 0 && (writer->block.records >= writer->block_records || writer->flags != record->flags ||
+                                    writer->channels != record->channels ||
+                                    writer->num_windows != record->num_windows)) {
+    if (!gst_ebur128_archive_writer_write_block(writer, error)) {
+      return FALSE;
+    }
+  }
+
+  gboolean first = writer->block.records == 0;
+  if (first) {
+    if (writer->values == NULL || writer->channels != record->channels ||
+        writer->num_windows != record->num_windows) {
+      g_free(writer->values);
+      writer->values =
+          g_new(GstEbur128XorState, GST_EBUR128_ARCHIVE_VALUE_COLUMNS(record->channels, record->num_windows));
+    }
+
+    gint64 offset = gst_ebur128_archive_lseek(writer->fd, 0, SEEK_CUR);
+    if (offset < 0) {
+      gst_ebur128_archive_set_error(error, "seek in", writer->location);
+      return FALSE;
+    }
+    writer->block.offset = offset;
+    writer->block.first_time = time;
+    writer->block.last_time = time;
+    writer->flags = record->flags;
+    writer->channels = record->channels;
+    writer->num_windows = record->num_windows;
+  }
+
+  guint64 *times[GST_EBUR128_ARCHIVE_TIME_COLUMNS - 1];
+  gdouble **values = g_newa(gdouble *, GST_EBUR128_ARCHIVE_VALUE_COLUMNS(record->channels, record->num_windows));
+  guint n_values = gst_ebur128_archive_columns((GstEbur128MeasurementRecord *)record, times, values);
+
+  gst_ebur128_archive_put_time(&writer->payload, &writer->times[0], (guint64)time, first);
+  for (guint i = 0; i < G_N_ELEMENTS(times); i++) {
+    gst_ebur128_archive_put_time(&writer->payload, &writer->times[i + 1], *times[i], first);
+  }
+  for (guint i = 0; i < n_values; i++) {
+    gst_ebur128_archive_put_value(&writer->payload, &writer->values[i], *values[i], first);
+  }
+
+  writer->block.first_time = MIN(writer->block.first_time, time);
+  writer->block.last_time = MAX(writer->block.last_time, time);
+  writer->block.records++;
+  return TRUE;
+}
+
+// syncs the blocks written so far to disk, the one that is being compressed is not part of them
+gboolean gst_ebur128_archive_writer_sync(GstEbur128ArchiveWriter *writer, GError **error) {
+  if (g_fsync(writer->fd) != 0) {
+    gst_ebur128_archive_set_error(error, "sync", writer->location);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * Writes the incomplete block and the index, syncs the archive to disk and frees the writer, also when that fails.
+ */
+gboolean gst_ebur128_archive_writer_close(GstEbur128ArchiveWriter *writer, GError **error) {
+  gboolean success = gst_ebur128_archive_writer_write_block(writer, error);
+
+  if (success) {
+    gint64 index_offset = gst_ebur128_archive_lseek(writer->fd, 0, SEEK_CUR);
+    gsize index_size = (gsize)writer->blocks->len * GST_EBUR128_ARCHIVE_INDEX_ENTRY_SIZE;
+    guint8 *index = g_malloc0(index_size + GST_EBUR128_ARCHIVE_FOOTER_SIZE);
+
+    for (guint i = 0; i < writer->blocks->len; i++) {
+      const GstEbur128ArchiveBlock *block = &g_array_index(writer->blocks, GstEbur128ArchiveBlock, i);
+      guint8 *entry = index + (gsize)i * GST_EBUR128_ARCHIVE_INDEX_ENTRY_SIZE;
+      gst_ebur128_archive_put_u64(entry, block->offset);
+      gst_ebur128_archive_put_u64(entry + 8, (guint64)block->first_time);
+      gst_ebur128_archive_put_u64(entry + 16, (guint64)block->last_time);
+      gst_ebur128_archive_put_u32(entry + 24, block->records);
+    }
+
+    guint8 *footer = index + index_size;
+    gst_ebur128_archive_put_u64(footer, (guint64)index_offset);
+    gst_ebur128_archive_put_u32(footer + 8, writer->blocks->len);
+    gst_ebur128_archive_put_u32(footer + 12, GST_EBUR128_ARCHIVE_INDEX_MAGIC);
+
+    success = index_offset >= 0 &&
+              gst_ebur128_archive_write_all(writer->fd, index, index_size + GST_EBUR128_ARCHIVE_FOOTER_SIZE);
+    if (!success) {
+      gst_ebur128_archive_set_error(error, "write", writer->location);
+    }
+    g_free(index);
+  }
+
+  if (success) {
+    success = gst_ebur128_archive_writer_sync(writer, error);
+  }
+
+  close(writer->fd);
+  g_array_free(writer->blocks, TRUE);
+  g_byte_array_free(writer->payload.bytes, TRUE);
+  g_free(writer->values);
+  g_free(writer->location);
+  g_free(writer);
+  return success;
+}
+
+/**
+ * Opens the archive at location for reading. Blocks appended after this are not seen, the archive has to be opened
+ * again for them.
+ */
+GstEbur128ArchiveReader *gst_ebur128_archive_reader_open(const gchar *location, GError **error) {
+  g_return_val_if_fail(location != NULL, NULL);
+
+  int fd = g_open(location, O_RDONLY | O_BINARY, 0);
+  if (fd < 0) {
+    gst_ebur128_archive_set_error(error, "open", location);
+    return NULL;
+  }
+
+  GArray *blocks = g_array_new(FALSE, FALSE, sizeof(GstEbur128ArchiveBlock));
+  guint64 end;
+  if (!gst_ebur128_archive_load(fd, location, blocks, &end, error)) {
+    g_array_free(blocks, TRUE);
+    close(fd);
+    return NULL;
+  }
+
+  GstEbur128ArchiveReader *reader = g_new0(GstEbur128ArchiveReader, 1);
+  reader->location = g_strdup(location);
+  reader->fd = fd;
+  reader->blocks = blocks;
+
+  // the wall-clock can step backwards, which makes the archive unordered and queries look at every block
+  reader->ordered = TRUE;
+  for (guint i = 0; i < blocks->len; i++) {
+    const GstEbur128ArchiveBlock *block = &g_array_index(blocks, GstEbur128ArchiveBlock, i);
+    const GstEbur128ArchiveBlock *previous = i > 0 ? block - 1 : NULL;
+    if (previous != NULL && block->first_time < previous->last_time) {
+      reader->ordered = FALSE;
+      break;
+    }
+  }
+  return reader;
+}
+
+void gst_ebur128_archive_reader_close(GstEbur128ArchiveReader *reader) {
+  close(reader->fd);
+  g_array_free(reader->blocks, TRUE);
+  g_free(reader->location);
+  g_free(reader);
+}
+
+guint gst_ebur128_archive_reader_get_n_blocks(GstEbur128ArchiveReader *reader) {
+  return reader->blocks->len;
+}
+
+const GstEbur128ArchiveBlock *gst_ebur128_archive_reader_get_block(GstEbur128ArchiveReader *reader, guint index) {
+  g_return_val_if_fail(index < reader->blocks->len, NULL);
+  return &g_array_index(reader->blocks, GstEbur128ArchiveBlock, index);
+}
+
+// decompresses one block and passes the records between start and stop to func, returns FALSE when func stopped
+static gboolean gst_ebur128_archive_reader_read_block(GstEbur128ArchiveReader *reader,
+                                                      const GstEbur128ArchiveBlock *block, gint64 start, gint64 stop,
+                                                      GstEbur128ArchiveFunc func, gpointer user_data,
+                                                      gboolean *stopped, GError **error) {
+  guint8 header[GST_EBUR128_ARCHIVE_BLOCK_HEADER_SIZE];
+  if (!gst_ebur128_archive_read_at(reader->fd, block->offset, header, sizeof(header))) {
+    gst_ebur128_archive_set_error(error, "read", reader->location);
+    return FALSE;
+  }
+  if (gst_ebur128_archive_get_u32(header) != GST_EBUR128_ARCHIVE_BLOCK_MAGIC) {
+    gst_ebur128_archive_set_invalid(error, reader->location, "index points to no block");
+    return FALSE;
+  }
+
+  guint32 payload_size = gst_ebur128_archive_get_u32(header + 4);
+  guint32 records = gst_ebur128_archive_get_u32(header + 8);
+  guint32 channels = gst_ebur128_archive_get_u32(header + 16);
+  guint32 num_windows = gst_ebur128_archive_get_u32(header + 20);
+  if (channels > G_MAXUINT16 || num_windows > G_MAXUINT16) {
+    gst_ebur128_archive_set_invalid(error, reader->location, "implausible block layout");
+    return FALSE;
+  }
+
+  guint8 *payload = g_malloc(payload_size);
+  if (!gst_ebur128_archive_read_at(reader->fd, block->offset + sizeof(header), payload, payload_size)) {
+    gst_ebur128_archive_set_error(error, "read", reader->location);
+    g_free(payload);
+    return FALSE;
+  }
+
+  GstEbur128MeasurementRecord *record = g_malloc0(GST_EBUR128_MEASUREMENT_SIZE(channels, num_windows));
+  record->version = GST_EBUR128_MEASUREMENT_VERSION;
+  record->flags = gst_ebur128_archive_get_u32(header + 12);
+  record->channels = channels;
+  record->num_windows = num_windows;
+
+  guint64 *times[GST_EBUR128_ARCHIVE_TIME_COLUMNS - 1];
+  gdouble **values = g_new(gdouble *, GST_EBUR128_ARCHIVE_VALUE_COLUMNS(channels, num_windows));
+  guint n_values = gst_ebur128_archive_columns(record, times, values);
+
+  GstEbur128DeltaState time_states[GST_EBUR128_ARCHIVE_TIME_COLUMNS];
+  GstEbur128XorState *value_states = g_new(GstEbur128XorState, MAX(n_values, 1));
+  GstEbur128BitReader bits = {.data = payload, .bits = (guint64)payload_size * 8, .position = 0};
+
+  gboolean success = TRUE;
+  for (guint32 index = 0; success && !*stopped && index < records; index++) {
+    gboolean first = index == 0;
+    guint64 time;
+
+    success = gst_ebur128_archive_get_time(&bits, &time_states[0], &time, first);
+    for (guint i = 0; success && i < G_N_ELEMENTS(times); i++) {
+      success = gst_ebur128_archive_get_time(&bits, &time_states[i + 1], times[i], first);
+    }
+    for (guint i = 0; success && i < n_values; i++) {
+      success = gst_ebur128_archive_get_value(&bits, &value_states[i], values[i], first);
+    }
+
+    if (success && (gint64)time >= start && (gint64)time < stop) {
+      *stopped = !func((gint64)time, record, user_data);
+    }
+  }
+  if (!success) {
+    gst_ebur128_archive_set_invalid(error, reader->location, "truncated block");
+  }
+
+  g_free(value_states);
+  g_free(values);
+  g_free(record);
+  g_free(payload);
+  return success;
+}
+
+/**
+ * Passes every record measured at or after start and before stop to func. Only the blocks whose time overlaps with
+ * the query are read, which are found by bisecting the index.
+ */
+gboolean gst_ebur128_archive_reader_query(GstEbur128ArchiveReader *reader, gint64 start, gint64 stop,
+                                          GstEbur128ArchiveFunc func, gpointer user_data, GError **error) {
+  g_return_val_if_fail(func != NULL, FALSE);
+
+  guint first = 0;
+  if (reader->ordered) {
+    // first block that ends at or after start
+    guint last = reader->blocks->len;
+    while (first < last) {
+      guint middle = first + (last - first) / 2;
+      if (g_array_index(reader->blocks, GstEbur128ArchiveBlock, middle).last_time < start) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+  }
+
+  gboolean stopped = FALSE;
+  for (guint i = first; i < reader->blocks->len && !stopped; i++) {
+    const GstEbur128ArchiveBlock *block = &g_array_index(reader->blocks, GstEbur128ArchiveBlock, i);
+    if (block->first_time >= stop) {
+      if (reader->ordered) {
+        break;
+      }
+      continue;
+    }
+    if (block->last_time < start && !reader->ordered) {
+      continue;
+    }
+
+    if (!gst_ebur128_archive_reader_read_block(reader, block, start, stop, func, user_data, &stopped, error)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
@@ -0,0 +1,76 @@
+#ifndef __GST_EBUR128ARCHIVE_H__
+#define __GST_EBUR128ARCHIVE_H__
+
+#include "gstebur128measurement.h"
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// "EBRA", "EBLK" and "EIDX" in a little-endian dump
+#define GST_EBUR128_ARCHIVE_MAGIC 0x41524245
+#define GST_EBUR128_ARCHIVE_BLOCK_MAGIC 0x4b4c4245
+#define GST_EBUR128_ARCHIVE_INDEX_MAGIC 0x58444945
+#define GST_EBUR128_ARCHIVE_VERSION 1
+
+#define GST_EBUR128_ARCHIVE_HEADER_SIZE 16
+#define GST_EBUR128_ARCHIVE_BLOCK_HEADER_SIZE 40
+#define GST_EBUR128_ARCHIVE_INDEX_ENTRY_SIZE 32
+#define GST_EBUR128_ARCHIVE_FOOTER_SIZE 16
+
+/**
+ * Append-only Archive of Measurement-Records, for keeping a long History of Loudness on local Disk.
+ *
+ * All Integers are little-endian. The File starts with a Header of magic, version and header_size (u32 each, one u32
+ * reserved), followed by Blocks. Every Block has a Header of magic, payload-size, records, flags, channels and
+ * num_windows (u32 each), then the earliest and the latest time of its Records (i64), and a Payload of compressed
+ * Records, which all have the Layout of the Block.
+ *
+ * Every Record is stored with the time it was measured at, in nanoseconds since the UNIX-Epoch, which is what the
+ * Archive is indexed and queried by. time, timestamp, running-time and stream-time are stored as delta-of-deltas and
+ * the Measurements as XOR to the previous value of their column, bit-packed like in Facebooks Gorilla. Measurements
+ * that are not named in flags are not stored and read back as 0. Compression is lossless.
+ *
+ * When the Archive is closed, an Index of all Blocks (offset u64, earliest and latest time i64, records u32, one u32
+ * reserved) and a Footer (offset of the Index u64, number of Blocks u32, magic u32) is appended, so Readers find every
+ * Block without touching the Data. Writers cut it off again when they append. An Archive that was not closed, because
+ * it is still being written or its Writer crashed, is indexed by walking the Block-Headers instead, and only the Block
+ * the Writer had not finished yet is missing.
+ */
+typedef struct _GstEbur128ArchiveBlock GstEbur128ArchiveBlock;
+struct _GstEbur128ArchiveBlock {
+  guint64 offset;
+
+  // earliest and latest time of the records in the block, which are not ordered when the wall-clock stepped backwards
+  gint64 first_time;
+  gint64 last_time;
+  guint32 records;
+};
+
+typedef struct _GstEbur128ArchiveWriter GstEbur128ArchiveWriter;
+
+GstEbur128ArchiveWriter *gst_ebur128_archive_writer_open(const gchar *location, guint block_records, GError **error);
+gboolean gst_ebur128_archive_writer_append(GstEbur128ArchiveWriter *writer, gint64 time,
+                                           const GstEbur128MeasurementRecord *record, GError **error);
+gboolean gst_ebur128_archive_writer_sync(GstEbur128ArchiveWriter *writer, GError **error);
+gboolean gst_ebur128_archive_writer_close(GstEbur128ArchiveWriter *writer, GError **error);
+
+/**
+ * Called for every Record a query finds, in the order they have been written. The Record is only valid during the
+ * call. Returning FALSE stops the query.
+ */
+typedef gboolean (*GstEbur128ArchiveFunc)(gint64 time, const GstEbur128MeasurementRecord *record, gpointer user_data);
+
+typedef struct _GstEbur128ArchiveReader GstEbur128ArchiveReader;
+
+GstEbur128ArchiveReader *gst_ebur128_archive_reader_open(const gchar *location, GError **error);
+void gst_ebur128_archive_reader_close(GstEbur128ArchiveReader *reader);
+
+guint gst_ebur128_archive_reader_get_n_blocks(GstEbur128ArchiveReader *reader);
+const GstEbur128ArchiveBlock *gst_ebur128_archive_reader_get_block(GstEbur128ArchiveReader *reader, guint index);
+
+gboolean gst_ebur128_archive_reader_query(GstEbur128ArchiveReader *reader, gint64 start, gint64 stop,
+                                          GstEbur128ArchiveFunc func, gpointer user_data, GError **error);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128ARCHIVE_H__
@@ -0,0 +1,64 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128checkpoint.h"
+#include <string.h>
+
+void gst_ebur128_checkpoint_put_u32(GByteArray *bytes, guint32 value) {
+  value = GUINT32_TO_LE(value);
+  g_byte_array_append(bytes, (const guint8 *)&value, sizeof(value));
+}
+
+void gst_ebur128_checkpoint_put_u64(GByteArray *bytes, guint64 value) {
+  value = GUINT64_TO_LE(value);
+  g_byte_array_append(bytes, (const guint8 *)&value, sizeof(value));
+}
+
+void gst_ebur128_checkpoint_put_double(GByteArray *bytes, gdouble value) {
+  guint64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  gst_ebur128_checkpoint_put_u64(bytes, bits);
+}
+
+void gst_ebur128_checkpoint_reader_init(GstEbur128CheckpointReader *reader, const guint8 *data, gsize size) {
+  reader->data = data;
+  reader->size = size;
+  reader->position = 0;
+  reader->truncated = FALSE;
+}
+
+gsize gst_ebur128_checkpoint_reader_remaining(GstEbur128CheckpointReader *reader) {
+  return reader->size - reader->position;
+}
+
+// copies size bytes and advances, or zeroes them and marks the reader as truncated
+static void gst_ebur128_checkpoint_read(GstEbur128CheckpointReader *reader, gpointer value, gsize size) {
+  if (reader->truncated || gst_ebur128_checkpoint_reader_remaining(reader) < size) {
+    reader->truncated = TRUE;
+    memset(value, 0, size);
+    return;
+  }
+
+  memcpy(value, reader->data + reader->position, size);
+  reader->position += size;
+}
+
+guint32 gst_ebur128_checkpoint_get_u32(GstEbur128CheckpointReader *reader) {
+  guint32 value;
+  gst_ebur128_checkpoint_read(reader, &value, sizeof(value));
+  return GUINT32_FROM_LE(value);
+}
+
+guint64 gst_ebur128_checkpoint_get_u64(GstEbur128CheckpointReader *reader) {
+  guint64 value;
+  gst_ebur128_checkpoint_read(reader, &value, sizeof(value));
+  return GUINT64_FROM_LE(value);
+}
+
+gdouble gst_ebur128_checkpoint_get_double(GstEbur128CheckpointReader *reader) {
+  guint64 bits = gst_ebur128_checkpoint_get_u64(reader);
+  gdouble value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
@@ -0,0 +1,42 @@
+#ifndef __GST_EBUR128CHECKPOINT_H__
+#define __GST_EBUR128CHECKPOINT_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// "EBCP" in a little-endian dump
+#define GST_EBUR128_CHECKPOINT_MAGIC 0x50434245
+#define GST_EBUR128_CHECKPOINT_VERSION 1
+
+/**
+ * Helpers for the Checkpoint of a State, a compact and versioned Blob of everything integrated loudness, loudness-range
+ * and the peaks depend on, so a restarted pipeline resumes them without analyzing the programme again.
+ *
+ * All Integers are little-endian, Doubles are stored as their IEEE-754 bits. The Blob starts with magic, version,
+ * channels and the sets it contains (u32 each), followed by sample- and true-peak of every channel (double each) and
+ * the gating-sets, see gst_ebur128_state_save.
+ *
+ * Reads past the end return 0 and mark the Reader as truncated, so a Blob is only checked once it has been read.
+ */
+void gst_ebur128_checkpoint_put_u32(GByteArray *bytes, guint32 value);
+void gst_ebur128_checkpoint_put_u64(GByteArray *bytes, guint64 value);
+void gst_ebur128_checkpoint_put_double(GByteArray *bytes, gdouble value);
+
+typedef struct _GstEbur128CheckpointReader GstEbur128CheckpointReader;
+struct _GstEbur128CheckpointReader {
+  const guint8 *data;
+  gsize size;
+  gsize position;
+  gboolean truncated;
+};
+
+void gst_ebur128_checkpoint_reader_init(GstEbur128CheckpointReader *reader, const guint8 *data, gsize size);
+gsize gst_ebur128_checkpoint_reader_remaining(GstEbur128CheckpointReader *reader);
+guint32 gst_ebur128_checkpoint_get_u32(GstEbur128CheckpointReader *reader);
+guint64 gst_ebur128_checkpoint_get_u64(GstEbur128CheckpointReader *reader);
+gdouble gst_ebur128_checkpoint_get_double(GstEbur128CheckpointReader *reader);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128CHECKPOINT_H__
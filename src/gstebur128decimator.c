@@ -0,0 +1,249 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128decimator.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GST_EBUR128_DECIMATOR_X86 1
+#include <immintrin.h>
+#endif
+
+// up to 768 kHz down to 48 kHz
+#define MAX_STAGES 4
+
+// non-zero tap-pairs of the last and of every earlier stage, and the kaiser-window both are designed with
+#define LAST_STAGE_PAIRS 8
+#define EARLY_STAGE_PAIRS 4
+#define KAISER_BETA 4.5
+
+typedef struct _GstEbur128DecimatorStage GstEbur128DecimatorStage;
+struct _GstEbur128DecimatorStage {
+  // taps = 4 * pairs - 1, pair k sits 2k + 1 frames before and after the center-tap
+  guint pairs;
+  guint taps;
+  gdouble center;
+  gdouble coefficients[LAST_STAGE_PAIRS];
+
+  // the last taps - 1 input-frames followed by the ones not consumed yet, (taps - 1 + max_frames) * stride doubles
+  gdouble *buffer;
+  guint fill;
+};
+
+typedef void (*GstEbur128DecimatorFunc)(const GstEbur128DecimatorStage *stage, guint stride, const gdouble *input,
+                                        gdouble *output, guint num_frames);
+
+struct _GstEbur128Decimator {
+  guint factor;
+  guint stride;
+  const gchar *kernel_name;
+  GstEbur128DecimatorFunc func;
+
+  GstEbur128DecimatorStage stages[MAX_STAGES];
+  guint num_stages;
+};
+
+static gdouble gst_ebur128_decimator_bessel_i0(gdouble x) {
+  gdouble sum = 1.0, term = 1.0;
+  for (guint k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+/**
+ * Kaiser-windowed sinc with its cutoff at half the Nyquist-Frequency, which puts every even tap but the center one at
+ * zero. Normalized to unity gain at DC.
+ */
+static void gst_ebur128_decimator_design_stage(GstEbur128DecimatorStage *stage, guint pairs) {
+  stage->pairs = pairs;
+  stage->taps = 4 * pairs - 1;
+
+  gdouble half_length = 2.0 * pairs - 1.0;
+  gdouble dc = 0.5;
+  for (guint k = 0; k < pairs; k++) {
+    gdouble offset = 2.0 * k + 1.0;
+    gdouble sinc = sin(G_PI * offset / 2.0) / (G_PI * offset);
+    gdouble ratio = offset / half_length;
+    gdouble window = gst_ebur128_decimator_bessel_i0(KAISER_BETA * sqrt(1.0 - ratio * ratio)) /
+                     gst_ebur128_decimator_bessel_i0(KAISER_BETA);
+    stage->coefficients[k] = sinc * window;
+    dc += 2.0 * stage->coefficients[k];
+  }
+
+  stage->center = 0.5 / dc;
+  for (guint k = 0; k < pairs; k++) {
+    stage->coefficients[k] /= dc;
+  }
+}
+
+/**
+ * Reference-Implementation, one lane after the other.
+ */
+static void gst_ebur128_decimator_process_scalar(const GstEbur128DecimatorStage *stage, guint stride,
+                                                 const gdouble *input, gdouble *output, guint num_frames) {
+  for (guint frame = 0; frame < num_frames; frame++) {
+    const gdouble *center = input + (2 * frame + stage->taps / 2) * stride;
+    gdouble *out = output + frame * stride;
+
+    for (guint lane = 0; lane < stride; lane++) {
+      gdouble acc = stage->center * center[lane];
+      for (guint k = 0; k < stage->pairs; k++) {
+        const gdouble *before = center - (2 * k + 1) * stride;
+        const gdouble *after = center + (2 * k + 1) * stride;
+        acc += stage->coefficients[k] * (before[lane] + after[lane]);
+      }
+      out[lane] = acc;
+    }
+  }
+}
+
+#ifdef GST_EBUR128_DECIMATOR_X86
+/**
+ * Two lanes per __m128d, same operation-order as the scalar Implementation.
+ */
+__attribute__((target("sse2"))) static void
+gst_ebur128_decimator_process_sse2(const GstEbur128DecimatorStage *stage, guint stride, const gdouble *input,
+                                   gdouble *output, guint num_frames) {
+  const __m128d center_coefficient = _mm_set1_pd(stage->center);
+
+  for (guint frame = 0; frame < num_frames; frame++) {
+    const gdouble *center = input + (2 * frame + stage->taps / 2) * stride;
+    gdouble *out = output + frame * stride;
+
+    for (guint lane = 0; lane < stride; lane += 2) {
+      __m128d acc = _mm_mul_pd(center_coefficient, _mm_loadu_pd(center + lane));
+      for (guint k = 0; k < stage->pairs; k++) {
+        const gdouble *before = center - (2 * k + 1) * stride;
+        const gdouble *after = center + (2 * k + 1) * stride;
+        __m128d pair = _mm_add_pd(_mm_loadu_pd(before + lane), _mm_loadu_pd(after + lane));
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(stage->coefficients[k]), pair));
+      }
+      _mm_storeu_pd(out + lane, acc);
+    }
+  }
+}
+
+/**
+ * Four lanes per __m256d, same operation-order as the scalar Implementation.
+ */
+__attribute__((target("avx2"))) static void
+gst_ebur128_decimator_process_avx2(const GstEbur128DecimatorStage *stage, guint stride, const gdouble *input,
+                                   gdouble *output, guint num_frames) {
+  const __m256d center_coefficient = _mm256_set1_pd(stage->center);
+
+  for (guint frame = 0; frame < num_frames; frame++) {
+    const gdouble *center = input + (2 * frame + stage->taps / 2) * stride;
+    gdouble *out = output + frame * stride;
+
+    for (guint lane = 0; lane < stride; lane += 4) {
+      __m256d acc = _mm256_mul_pd(center_coefficient, _mm256_loadu_pd(center + lane));
+      for (guint k = 0; k < stage->pairs; k++) {
+        const gdouble *before = center - (2 * k + 1) * stride;
+        const gdouble *after = center + (2 * k + 1) * stride;
+        __m256d pair = _mm256_add_pd(_mm256_loadu_pd(before + lane), _mm256_loadu_pd(after + lane));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_set1_pd(stage->coefficients[k]), pair));
+      }
+      _mm256_storeu_pd(out + lane, acc);
+    }
+  }
+}
+#endif
+
+// the stride is given by the K-Weighting Filter, so the widest kernel whose lanes divide it is taken
+static void gst_ebur128_decimator_select_kernel(GstEbur128Decimator *decimator) {
+  decimator->kernel_name = "scalar";
+  decimator->func = gst_ebur128_decimator_process_scalar;
+
+#ifdef GST_EBUR128_DECIMATOR_X86
+  __builtin_cpu_init();
+
+  if (decimator->stride % 4 == 0 && __builtin_cpu_supports("avx2")) {
+    decimator->kernel_name = "avx2";
+    decimator->func = gst_ebur128_decimator_process_avx2;
+  } else if (decimator->stride % 2 == 0 && __builtin_cpu_supports("sse2")) {
+    decimator->kernel_name = "sse2";
+    decimator->func = gst_ebur128_decimator_process_sse2;
+  }
+#endif
+}
+
+GstEbur128Decimator *gst_ebur128_decimator_new(guint factor, guint stride, guint max_frames) {
+  GstEbur128Decimator *decimator = g_new0(GstEbur128Decimator, 1);
+  decimator->stride = stride;
+
+  for (decimator->factor = 1; decimator->factor < factor && decimator->num_stages < MAX_STAGES;
+       decimator->factor *= 2) {
+    decimator->num_stages++;
+  }
+
+  for (guint i = 0; i < decimator->num_stages; i++) {
+    GstEbur128DecimatorStage *stage = &decimator->stages[i];
+    gboolean last = i == decimator->num_stages - 1;
+    gst_ebur128_decimator_design_stage(stage, last ? LAST_STAGE_PAIRS : EARLY_STAGE_PAIRS);
+    stage->buffer = g_new(gdouble, (gsize)(stage->taps - 1 + max_frames) * stride);
+  }
+
+  gst_ebur128_decimator_select_kernel(decimator);
+  gst_ebur128_decimator_reset(decimator);
+  return decimator;
+}
+
+void gst_ebur128_decimator_free(GstEbur128Decimator *decimator) {
+  for (guint i = 0; i < decimator->num_stages; i++) {
+    g_free(decimator->stages[i].buffer);
+  }
+  g_free(decimator);
+}
+
+// every stage starts with taps - 1 frames of silence before the stream
+void gst_ebur128_decimator_reset(GstEbur128Decimator *decimator) {
+  for (guint i = 0; i < decimator->num_stages; i++) {
+    GstEbur128DecimatorStage *stage = &decimator->stages[i];
+    stage->fill = stage->taps - 1;
+    memset(stage->buffer, 0, (gsize)stage->fill * decimator->stride * sizeof(gdouble));
+  }
+}
+
+guint gst_ebur128_decimator_get_factor(GstEbur128Decimator *decimator) { return decimator->factor; }
+
+const gchar *gst_ebur128_decimator_get_kernel_name(GstEbur128Decimator *decimator) { return decimator->kernel_name; }
+
+/**
+ * Number of input-frames after which the cascade has produced exactly output_frames frames, so the caller can stop at
+ * a sub-block boundary of the output.
+ */
+guint gst_ebur128_decimator_get_input_frames(GstEbur128Decimator *decimator, guint output_frames) {
+  guint frames = output_frames;
+  for (guint i = decimator->num_stages; i > 0 && frames > 0; i--) {
+    GstEbur128DecimatorStage *stage = &decimator->stages[i - 1];
+    frames = stage->taps + 2 * (frames - 1) - stage->fill;
+  }
+  return frames;
+}
+
+/**
+ * Runs num_frames frames through all stages and returns the number of decimated frames, which are written to the start
+ * of frames.
+ */
+guint gst_ebur128_decimator_process(GstEbur128Decimator *decimator, gdouble *frames, guint num_frames) {
+  const guint stride = decimator->stride;
+
+  for (guint i = 0; i < decimator->num_stages; i++) {
+    GstEbur128DecimatorStage *stage = &decimator->stages[i];
+    memcpy(stage->buffer + (gsize)stage->fill * stride, frames, (gsize)num_frames * stride * sizeof(gdouble));
+    stage->fill += num_frames;
+
+    num_frames = stage->fill >= stage->taps ? (stage->fill - stage->taps) / 2 + 1 : 0;
+    decimator->func(stage, stride, stage->buffer, frames, num_frames);
+
+    guint consumed = 2 * num_frames;
+    stage->fill -= consumed;
+    memmove(stage->buffer, stage->buffer + (gsize)consumed * stride, (gsize)stage->fill * stride * sizeof(gdouble));
+  }
+
+  return num_frames;
+}
@@ -0,0 +1,34 @@
+#ifndef __GST_EBUR128DECIMATOR_H__
+#define __GST_EBUR128DECIMATOR_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Anti-Alias Decimator in front of the K-Weighting Filter.
+ *
+ * Decimates by a power of two with a cascade of half-band FIR stages, every stage halves the rate. Half-band filters
+ * have every other tap at zero and are symmetric, so a stage costs one multiplication per non-zero tap-pair and output
+ * frame. The last stage is sharp enough to keep the band up to 0.366 of its output rate within 0.015 dB (17.6 kHz at
+ * 48 kHz) and to attenuate everything that would alias into that band by at least 50 dB, the stages before it only
+ * need to protect the band the last stage passes and are shorter.
+ *
+ * Frames are laid out like the input of the K-Weighting Filter, channel c of frame f at frames[f * stride + c], and are
+ * processed in place with all channels of a frame side by side in SIMD-Lanes.
+ */
+typedef struct _GstEbur128Decimator GstEbur128Decimator;
+
+GstEbur128Decimator *gst_ebur128_decimator_new(guint factor, guint stride, guint max_frames);
+void gst_ebur128_decimator_free(GstEbur128Decimator *decimator);
+void gst_ebur128_decimator_reset(GstEbur128Decimator *decimator);
+
+guint gst_ebur128_decimator_get_factor(GstEbur128Decimator *decimator);
+const gchar *gst_ebur128_decimator_get_kernel_name(GstEbur128Decimator *decimator);
+
+guint gst_ebur128_decimator_get_input_frames(GstEbur128Decimator *decimator, guint output_frames);
+guint gst_ebur128_decimator_process(GstEbur128Decimator *decimator, gdouble *frames, guint num_frames);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128DECIMATOR_H__
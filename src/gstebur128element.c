@@ -24,29 +24,96 @@
 #define GLIB_DISABLE_DEPRECATION_WARNINGS
 
 #include "gstebur128element.h"
+#include "gstebur128measurement.h"
+#include "gstebur128meta.h"
 #include "gstebur128shared.h"
+#include <math.h>
+#include <string.h>
 
 GST_DEBUG_CATEGORY_STATIC(gst_ebur128_debug);
 #define GST_CAT_DEFAULT gst_ebur128_debug
 
 /* Filter signals and args */
-enum { LAST_SIGNAL };
+enum { SIGNAL_GET_LATEST, SIGNAL_SAVE_STATE, SIGNAL_RESTORE_STATE, LAST_SIGNAL };
+
+static guint gst_ebur128_signals[LAST_SIGNAL] = {0};
 
 enum {
   PROP_0,
   PROP_MOMENTARY,
   PROP_SHORTTERM,
   PROP_GLOBAL,
+  PROP_INTEGRATED_HORIZON,
   PROP_WINDOW,
+  PROP_WINDOWS,
   PROP_RANGE,
   PROP_SAMPLE_PEAK,
   PROP_TRUE_PEAK,
   PROP_MAX_HISTORY,
+  PROP_GATING_ENGINE,
+  PROP_ANALYSIS_RATE,
   PROP_POST_MESSAGES,
-  PROP_INTERVAL
+  PROP_POST_THRESHOLD,
+  PROP_POST_MAX_SILENCE,
+  PROP_POST_BATCH,
+  PROP_PACKED_PEAKS,
+  PROP_INTERVAL,
+  PROP_ASYNC,
+  PROP_ASYNC_QUEUE_SIZE,
+  PROP_ASYNC_OVERFLOW,
+  PROP_ATTACH_META,
+  PROP_SHM_NAME,
+  PROP_SHM_RECORDS,
+  PROP_LOCATION,
+  PROP_LOG_FORMAT,
+  PROP_LOG_FSYNC_INTERVAL
 };
 
 #define PROP_INTERVAL_DEFAULT (GST_SECOND / 10)
+#define PROP_POST_THRESHOLD_DEFAULT 0.0
+#define PROP_POST_MAX_SILENCE_DEFAULT GST_SECOND
+#define PROP_POST_BATCH_DEFAULT 1
+#define PROP_ASYNC_QUEUE_SIZE_DEFAULT 64
+#define PROP_ASYNC_OVERFLOW_DEFAULT GST_EBUR128_ASYNC_OVERFLOW_BLOCK
+#define PROP_GATING_ENGINE_DEFAULT GST_EBUR128_GATING_ENGINE_EXACT
+#define PROP_SHM_RECORDS_DEFAULT 1024
+#define PROP_LOG_FORMAT_DEFAULT GST_EBUR128_LOG_FORMAT_CSV
+#define PROP_LOG_FSYNC_INTERVAL_DEFAULT GST_SECOND
+
+// records the logger can hold while its thread is writing, 100s worth of the default interval
+#define LOG_QUEUE_SIZE 1024
+
+#define GST_TYPE_EBUR128_ASYNC_OVERFLOW (gst_ebur128_async_overflow_get_type())
+static GType gst_ebur128_async_overflow_get_type(void) {
+  static GType ebur128_async_overflow = 0;
+  static const GEnumValue async_overflows[] = {{GST_EBUR128_ASYNC_OVERFLOW_BLOCK, "Block", "block"},
+                                               {GST_EBUR128_ASYNC_OVERFLOW_DROP, "Drop", "drop"},
+                                               {0, NULL, NULL}};
+  if (!ebur128_async_overflow) {
+    ebur128_async_overflow = g_enum_register_static("GstEbur128AsyncOverflow", async_overflows);
+  }
+  return ebur128_async_overflow;
+}
+
+#define GST_TYPE_EBUR128_LOG_FORMAT (gst_ebur128_log_format_get_type())
+static GType gst_ebur128_log_format_get_type(void) {
+  static GType ebur128_log_format = 0;
+  static const GEnumValue log_formats[] = {{GST_EBUR128_LOG_FORMAT_CSV, "CSV", "csv"},
+                                           {GST_EBUR128_LOG_FORMAT_NDJSON, "NDJSON", "ndjson"},
+                                           {GST_EBUR128_LOG_FORMAT_ARCHIVE, "Archive", "archive"},
+                                           {0, NULL, NULL}};
+  if (!ebur128_log_format) {
+    ebur128_log_format = g_enum_register_static("GstEbur128LogFormat", log_formats);
+  }
+  return ebur128_log_format;
+}
+
+// a reference to a buffer queued for the analysis-thread, with the segment it was received in
+typedef struct {
+  GstBuffer *buffer;
+  GstSegment segment;
+  gboolean discont;
+} GstEbur128AsyncItem;
 
 /* the capabilities of the inputs and outputs.
  *
@@ -54,16 +121,19 @@ enum {
  */
 
 #define SUPPORTED_AUDIO_FORMATS                                                                                        \
-  "{ " GST_AUDIO_NE(S16) ", " GST_AUDIO_NE(S32) "," GST_AUDIO_NE(F32) ", " GST_AUDIO_NE(F64) " }"
+  "{ " GST_AUDIO_NE(S16) ", " GST_AUDIO_NE(S32) "," GST_AUDIO_NE(F32) ", " GST_AUDIO_NE(F64) ", "                      \
+  GST_AUDIO_NE(S24) ", " GST_AUDIO_NE(S24_32) ", U8, "                                                                 \
+  GST_AUDIO_OE(S16) ", " GST_AUDIO_OE(S32) ", " GST_AUDIO_OE(F32) ", " GST_AUDIO_OE(F64) ", "                          \
+  GST_AUDIO_OE(S24) ", " GST_AUDIO_OE(S24_32) " }"
 
-#define SUPPORTED_AUDIO_CHANNELS "(int) { 1, 2, 5 }"
+#define SUPPORTED_AUDIO_CHANNELS "(int) [ 1, MAX ]"
 
 #define SUPPORTED_CAPS_STRING                                                                                          \
   "audio/x-raw, "                                                                                                      \
   "format = (string) " SUPPORTED_AUDIO_FORMATS ", "                                                                    \
   "rate = " GST_AUDIO_RATE_RANGE ", "                                                                                  \
   "channels = " SUPPORTED_AUDIO_CHANNELS ", "                                                                          \
-  "layout = (string) interleaved "
+  "layout = (string) { interleaved, non-interleaved } "
 
 static GstStaticPadTemplate sink_template_factory =
     GST_STATIC_PAD_TEMPLATE("sink", GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS(SUPPORTED_CAPS_STRING));
@@ -71,6 +141,12 @@ static GstStaticPadTemplate sink_template_factory =
 static GstStaticPadTemplate src_template_factory =
     GST_STATIC_PAD_TEMPLATE("src", GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS(SUPPORTED_CAPS_STRING));
 
+static GstStaticPadTemplate meas_src_template_factory = GST_STATIC_PAD_TEMPLATE(
+    "meas_src", GST_PAD_SRC, GST_PAD_REQUEST, GST_STATIC_CAPS(GST_EBUR128_MEASUREMENT_MEDIA_TYPE));
+
+// records preallocated for the meas_src pad, the pool grows if downstream holds on to more of them
+#define MEASUREMENT_POOL_MIN_BUFFERS 8
+
 #define gst_ebur128_parent_class parent_class
 G_DEFINE_TYPE(GstEbur128, gst_ebur128, GST_TYPE_BASE_TRANSFORM);
 
@@ -81,6 +157,7 @@ static void gst_ebur128_finalize(GObject *object);
 
 static gboolean gst_ebur128_set_caps(GstBaseTransform *trans, GstCaps *in, GstCaps *out);
 static gboolean gst_ebur128_start(GstBaseTransform *trans);
+static gboolean gst_ebur128_stop(GstBaseTransform *trans);
 static gboolean gst_ebur128_sink_event(GstBaseTransform *trans, GstEvent *event);
 static GstFlowReturn gst_ebur128_transform_ip(GstBaseTransform *trans, GstBuffer *in);
 
@@ -89,11 +166,33 @@ static void gst_ebur128_init_libebur128(GstEbur128 *filter);
 static void gst_ebur128_reinit_libebur128_if_mode_changed(GstEbur128 *filter);
 static void gst_ebur128_destroy_libebur128(GstEbur128 *filter);
 static void gst_ebur128_recalc_interval_frames(GstEbur128 *filter);
-static gboolean gst_ebur128_post_message(GstEbur128 *filter);
-typedef int (*per_channel_func_t)(ebur128_state *st, unsigned int channel_number, double *out);
-
-static gboolean gst_ebur128_fill_channel_array(GstEbur128 *filter, GValue *array_gvalue, const char *func_name,
-                                               per_channel_func_t func);
+static gulong gst_ebur128_calculate_max_window(GstEbur128 *filter);
+static gboolean gst_ebur128_post_message(GstEbur128 *filter, guint64 frames_processed, gboolean force);
+static void gst_ebur128_flush_batch(GstEbur128 *filter);
+static void gst_ebur128_queue_measurement(GstEbur128 *filter);
+static void gst_ebur128_queue_measurement_gap(GstEbur128 *filter, guint64 from_frames, guint64 to_frames);
+static void gst_ebur128_push_measurements(GstEbur128 *filter);
+static void gst_ebur128_take_latest(GstEbur128 *filter, GstEbur128Latest *latest, guint64 frames_processed);
+static void gst_ebur128_take_record(GstEbur128 *filter, const GstEbur128Latest *latest, guint64 frames_processed);
+static void gst_ebur128_write_shm(GstEbur128 *filter);
+static void gst_ebur128_write_log(GstEbur128 *filter);
+static void gst_ebur128_emit(GstEbur128 *filter, guint64 frames_processed, gboolean eos);
+static gboolean gst_ebur128_get_latest(GstEbur128 *filter, gpointer latest);
+static GBytes *gst_ebur128_save_state(GstEbur128 *filter);
+static void gst_ebur128_restore_state(GstEbur128 *filter, GBytes *checkpoint);
+static void gst_ebur128_release_measurement_pool(GstEbur128 *filter);
+static GstPad *gst_ebur128_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *name,
+                                           const GstCaps *caps);
+static void gst_ebur128_release_pad(GstElement *element, GstPad *pad);
+static gboolean gst_ebur128_analyze(GstEbur128 *filter, GstBuffer *buf, const GstSegment *segment, gboolean discont);
+static void gst_ebur128_start_async(GstEbur128 *filter);
+static void gst_ebur128_stop_async(GstEbur128 *filter);
+static void gst_ebur128_drain_async(GstEbur128 *filter);
+static void gst_ebur128_attach_meta(GstEbur128 *filter, GstBuffer *buf);
+static void gst_ebur128_snapshot(GstEbur128State *state, gsize frames, gpointer user_data);
+static void gst_ebur128_fill_channel_array(GstEbur128 *filter, GValue *array_gvalue, const gdouble *values,
+                                           guint channels);
+static void gst_ebur128_fill_windows_array(GValue *array_gvalue, const gdouble *values, guint num_windows);
 
 /* GObject vmethod implementations */
 
@@ -110,8 +209,12 @@ static void gst_ebur128_class_init(GstEbur128Class *klass) {
   gobject_class->get_property = gst_ebur128_get_property;
   gobject_class->finalize = gst_ebur128_finalize;
 
+  element_class->request_new_pad = GST_DEBUG_FUNCPTR(gst_ebur128_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR(gst_ebur128_release_pad);
+
   trans_class->set_caps = GST_DEBUG_FUNCPTR(gst_ebur128_set_caps);
   trans_class->start = GST_DEBUG_FUNCPTR(gst_ebur128_start);
+  trans_class->stop = GST_DEBUG_FUNCPTR(gst_ebur128_stop);
   trans_class->transform_ip = GST_DEBUG_FUNCPTR(gst_ebur128_transform_ip);
   trans_class->sink_event = GST_DEBUG_FUNCPTR(gst_ebur128_sink_event);
 
@@ -135,6 +238,17 @@ static void gst_ebur128_class_init(GstEbur128Class *klass) {
                                                        /* default */ FALSE,
                                                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(
+      gobject_class, PROP_INTEGRATED_HORIZON,
+      g_param_spec_ulong("integrated-horizon", "Integrated Loudness over a Horizon",
+                         "Enable gated Integrated Loudness Metering over the trailing Horizon by setting a non-zero "
+                         "Horizon in ms, e.g. 86400000 for a rolling Day. Expired Blocks are dropped a 24th of the "
+                         "Horizon at a time, so up to that much more is covered. Takes about 3.2 MiB regardless of the "
+                         "Horizon. Changing it restarts the Horizon.",
+                         /* min */ 0,
+                         /* max */ ULONG_MAX,
+                         /* default */ 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property(gobject_class, PROP_WINDOW,
                                   g_param_spec_ulong("window", "Window Loudness Metering",
                                                      "Enable Window Loudness Metering by setting a "
@@ -143,6 +257,18 @@ static void gst_ebur128_class_init(GstEbur128Class *klass) {
                                                      /* max */ ULONG_MAX,
                                                      /* default */ 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(
+      gobject_class, PROP_WINDOWS,
+      gst_param_spec_array("windows", "Multiple Window Loudness Metering",
+                           "Enable Window Loudness Metering for multiple Windows at once by setting a list of "
+                           "Window-Sizes in ms. All Windows are answered from the same History, so the Audio is only "
+                           "filtered once.",
+                           g_param_spec_ulong("window", "Window-Size", "Window-Size in ms",
+                                              /* min */ 1,
+                                              /* max */ ULONG_MAX,
+                                              /* default */ 1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+                           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property(
       gobject_class, PROP_RANGE,
       g_param_spec_boolean("range", "Loudness Range Metering", "Enable Loudness Range Metering",
@@ -170,6 +296,30 @@ static void gst_ebur128_class_init(GstEbur128Class *klass) {
                                                      /* default */ ULONG_MAX,
                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(
+      gobject_class, PROP_GATING_ENGINE,
+      g_param_spec_enum("gating-engine", "Gating Engine",
+                        "How the History for Range Metering and Global Loudness Metering is kept. exact keeps every "
+                        "Block and grows with the Stream, histogram sums the Blocks into 0.01 LU Bins of 125 KiB per "
+                        "Measurement however long the Stream runs. Its Global Loudness stays within 0.01 LU and its "
+                        "Range within 0.02 LU of exact. histogram ignores max-history. integrated-horizon always keeps "
+                        "histograms, 25 more of them. Changing it from exact to histogram carries Range and Global "
+                        "Loudness over, the other way round restarts them.",
+                        GST_TYPE_EBUR128_GATING_ENGINE, PROP_GATING_ENGINE_DEFAULT,
+                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_ANALYSIS_RATE,
+      g_param_spec_ulong("analysis-rate", "Analysis Rate",
+                         "Decimate high-rate Audio by a power of two to at least this rate (in Hz) before the "
+                         "Loudness-Filter, which is cheaper but ignores content above about 0.37 of the rate. Loudness "
+                         "of content below that stays within 0.05 LU, Peaks are measured at the native rate. Rates "
+                         "below 44100 are raised to it. 0 analyzes at the native rate. Changing it restarts "
+                         "Momentary, Short-Term and Window Loudness, Global Loudness and Range carry on.",
+                         /* min */ 0,
+                         /* max */ ULONG_MAX,
+                         /* default */ 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property(
       gobject_class, PROP_POST_MESSAGES,
       g_param_spec_boolean("post-messages", "Post Messages",
@@ -177,13 +327,161 @@ static void gst_ebur128_class_init(GstEbur128Class *klass) {
                            "passed interval",
                            TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(
+      gobject_class, PROP_POST_THRESHOLD,
+      g_param_spec_double("post-threshold", "Post Threshold",
+                          "Only post a message when a Loudness changed by more than this many LU (or a Peak by more "
+                          "than this many dB) since the last posted one, 0 posts every interval",
+                          /* min */ 0.0, /* max */ G_MAXDOUBLE, PROP_POST_THRESHOLD_DEFAULT,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_POST_MAX_SILENCE,
+      g_param_spec_uint64("post-max-silence", "Post Max Silence",
+                          "Longest time without a message when a post-threshold is set, even if nothing changed (in "
+                          "nanoseconds, GST_CLOCK_TIME_NONE for no limit)",
+                          /* min */ 0, /* max */ G_MAXUINT64, PROP_POST_MAX_SILENCE_DEFAULT,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_POST_BATCH,
+      g_param_spec_uint("post-batch", "Post Batch",
+                        "Collect this many 'loudness' structures into the 'measurements' array of one "
+                        "'loudness-batch' message. The remainder is posted at EOS. 1 posts every one on its own",
+                        /* min */ 1, /* max */ G_MAXINT, PROP_POST_BATCH_DEFAULT,
+                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_PACKED_PEAKS,
+      g_param_spec_boolean("packed-peaks", "Packed Peaks",
+                           "Carry sample-peak and true-peak of the Messages as GBytes of native-endian doubles, one "
+                           "per Channel, instead of a GValueArray, which is much cheaper for many Channels",
+                           /* default */ FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property(
       gobject_class, PROP_INTERVAL,
       g_param_spec_uint64("interval", "Interval", "Interval of time between message posts (in nanoseconds)", 1,
                           G_MAXUINT64, PROP_INTERVAL_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(
+      gobject_class, PROP_ASYNC,
+      g_param_spec_boolean("async", "Asynchronous Analysis",
+                           "Analyze on a dedicated Thread instead of the Streaming-Thread. Buffers are passed on "
+                           "immediately and a Reference is queued for the Analysis, so Messages are posted after their "
+                           "Buffers have passed, but still carry the original Timestamps. Downstream Elements that "
+                           "modify Buffers in place copy them while they are queued. Takes effect with the next "
+                           "Buffer.",
+                           /* default */ FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_ASYNC_QUEUE_SIZE,
+      g_param_spec_uint("async-queue-size", "Asynchronous Analysis Queue-Size",
+                        "Number of Buffers that can be queued for the Analysis-Thread, rounded up to a power of two. "
+                        "Takes effect when asynchronous Analysis is started.",
+                        /* min */ 1,
+                        /* max */ G_MAXINT / 2,
+                        /* default */ PROP_ASYNC_QUEUE_SIZE_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_ASYNC_OVERFLOW,
+      g_param_spec_enum("async-overflow", "Asynchronous Analysis Overflow",
+                        "What happens to a Buffer when the Analysis-Thread has fallen behind by a full Queue: block "
+                        "holds back the Streaming-Thread until there is room again, drop passes the Buffer on without "
+                        "analyzing it. Timestamps of the Messages after a dropped Buffer continue from the next "
+                        "analyzed one.",
+                        GST_TYPE_EBUR128_ASYNC_OVERFLOW, PROP_ASYNC_OVERFLOW_DEFAULT,
+                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_ATTACH_META,
+      g_param_spec_boolean("attach-meta", "Attach Meta",
+                           "Attach a GstEbur128Meta with the enabled Measurements at the end of each Buffer and the "
+                           "Peaks of the Buffer itself, so downstream Elements can read them without the Bus. Makes "
+                           "Buffers writable instead of passing them through. Not attached with async Analysis, which "
+                           "only measures Buffers after they have been passed on.",
+                           /* default */ FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_SHM_NAME,
+      g_param_spec_string("shm-name", "Shared-Memory Name",
+                          "Also write every Measurement-Record into a Shared-Memory Ring with this POSIX name (like "
+                          "/ebur128, which is /dev/shm/ebur128 on Linux), so local Processes can read them with the "
+                          "Reader in gstebur128shm.h. NULL disables it.",
+                          /* default */ NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_SHM_RECORDS,
+      g_param_spec_uint("shm-records", "Shared-Memory Records",
+                        "Number of Records the Shared-Memory Ring holds, rounded up to a power of two. Takes effect "
+                        "when the Ring is created.",
+                        /* min */ 1,
+                        /* max */ G_MAXINT / 4,
+                        /* default */ PROP_SHM_RECORDS_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_LOCATION,
+      g_param_spec_string("location", "Log Location",
+                          "Write every Measurement as a row into this File, from a dedicated Thread, so the "
+                          "Streaming-Thread never waits for the Filesystem. The File is truncated when it is opened "
+                          "first and appended to when the Channels or Windows change. NULL disables it.",
+                          /* default */ NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_LOG_FORMAT,
+      g_param_spec_enum("log-format", "Log Format",
+                        "Format of the rows written to location: csv has all columns with a header-line, ndjson one "
+                        "JSON-Object with the fields of the Message per line, archive appends to a compressed binary "
+                        "Archive indexed by wall-clock time",
+                        GST_TYPE_EBUR128_LOG_FORMAT, PROP_LOG_FORMAT_DEFAULT,
+                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      gobject_class, PROP_LOG_FSYNC_INTERVAL,
+      g_param_spec_uint64("log-fsync-interval", "Log fsync Interval",
+                          "Shortest time between two syncs of the Log to Disk (in nanoseconds), rows written in "
+                          "between are synced together. 0 syncs after every write, GST_CLOCK_TIME_NONE only when the "
+                          "Log is closed.",
+                          /* min */ 0, /* max */ G_MAXUINT64, PROP_LOG_FSYNC_INTERVAL_DEFAULT,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstEbur128::get-latest:
+   * @latest: (type gpointer): GstEbur128Latest to copy the values into
+   *
+   * Copies the Measurements of the last interval, without waiting for the streaming-thread. Returns FALSE as long as
+   * no Measurement has been taken. See gstebur128latest.h for the Layout.
+   */
+  gst_ebur128_signals[SIGNAL_GET_LATEST] =
+      g_signal_new_class_handler("get-latest", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+                                 G_CALLBACK(gst_ebur128_get_latest), NULL, NULL, NULL, G_TYPE_BOOLEAN, 1,
+                                 G_TYPE_POINTER);
+
+  /**
+   * GstEbur128::save-state:
+   *
+   * Returns a Checkpoint of Integrated Loudness, Loudness Range, the Integrated Horizon and the Peaks as a compact,
+   * versioned Blob, taken between two Buffers, or NULL before the first Caps. See gstebur128checkpoint.h for the
+   * Layout.
+   */
+  gst_ebur128_signals[SIGNAL_SAVE_STATE] =
+      g_signal_new_class_handler("save-state", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+                                 G_CALLBACK(gst_ebur128_save_state), NULL, NULL, NULL, G_TYPE_BYTES, 0);
+
+  /**
+   * GstEbur128::restore-state:
+   * @checkpoint: Blob returned by save-state, from an Element measuring the same number of Channels
+   *
+   * Resumes from a Checkpoint instead of starting over. Called before the Pipeline starts, it is restored as soon as
+   * the Caps are known, otherwise before the next Buffer. A Checkpoint that can not be restored is reported as Warning.
+   */
+  gst_ebur128_signals[SIGNAL_RESTORE_STATE] =
+      g_signal_new_class_handler("restore-state", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+                                 G_CALLBACK(gst_ebur128_restore_state), NULL, NULL, NULL, G_TYPE_NONE, 1,
+                                 G_TYPE_BYTES);
+
   gst_element_class_add_static_pad_template(element_class, &sink_template_factory);
   gst_element_class_add_static_pad_template(element_class, &src_template_factory);
+  gst_element_class_add_static_pad_template(element_class, &meas_src_template_factory);
 
   gst_element_class_set_static_metadata(element_class, "ebur128", "Filter/Analyzer/Audio",
                                         "Calculates the EBU-R 128 Loudness of an Audio-Stream and "
@@ -199,66 +497,160 @@ static void gst_ebur128_init(GstEbur128 *filter) {
   filter->momentary = TRUE;
   filter->shortterm = FALSE;
   filter->global = FALSE;
+  filter->integrated_horizon = 0;
   filter->window = 0;
+  filter->windows = g_array_new(FALSE, FALSE, sizeof(gulong));
+  filter->measures.windows = g_array_new(FALSE, FALSE, sizeof(gulong));
   filter->range = FALSE;
   filter->sample_peak = FALSE;
   filter->true_peak = FALSE;
   filter->max_history = ULONG_MAX;
+  filter->gating_engine = PROP_GATING_ENGINE_DEFAULT;
+  filter->analysis_rate = 0;
   filter->post_messages = TRUE;
+  filter->post_threshold = PROP_POST_THRESHOLD_DEFAULT;
+  filter->post_max_silence = PROP_POST_MAX_SILENCE_DEFAULT;
+  filter->post_batch = PROP_POST_BATCH_DEFAULT;
+  filter->packed_peaks = FALSE;
   filter->interval = PROP_INTERVAL_DEFAULT;
-
+  filter->async = FALSE;
+  filter->async_queue_size = PROP_ASYNC_QUEUE_SIZE_DEFAULT;
+  filter->async_overflow = PROP_ASYNC_OVERFLOW_DEFAULT;
+  filter->attach_meta = FALSE;
+  filter->shm_name = NULL;
+  filter->shm_records = PROP_SHM_RECORDS_DEFAULT;
+  filter->location = NULL;
+  filter->log_format = PROP_LOG_FORMAT_DEFAULT;
+  filter->log_fsync_interval = PROP_LOG_FSYNC_INTERVAL_DEFAULT;
+
+  gst_ebur128_latest_cell_init(&filter->latest);
+  g_rec_mutex_init(&filter->state_lock);
+  g_queue_init(&filter->meas_queue);
   gst_audio_info_init(&filter->audio_info);
+  gst_segment_init(&filter->segment, GST_FORMAT_TIME);
 }
 
 static void gst_ebur128_finalize(GObject *object) {
   GstEbur128 *filter = GST_EBUR128(object);
   gst_ebur128_destroy_libebur128(filter);
+  g_array_free(filter->windows, TRUE);
+  g_array_free(filter->measures.windows, TRUE);
+  g_clear_pointer(&filter->shm_writer, gst_ebur128_shm_writer_free);
+  g_free(filter->shm_name);
+  g_clear_pointer(&filter->logger, gst_ebur128_logger_free);
+  g_free(filter->log_opened);
+  g_free(filter->record);
+  g_free(filter->posted);
+  g_free(filter->location);
+  if (G_IS_VALUE(&filter->batch)) {
+    g_value_unset(&filter->batch);
+  }
+  g_clear_pointer(&filter->pending_checkpoint, g_bytes_unref);
+  g_queue_clear_full(&filter->meas_queue, (GDestroyNotify)gst_mini_object_unref);
+  g_rec_mutex_clear(&filter->state_lock);
+
+  G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+// properties set while a buffer is analyzed only apply from the next one on, the streaming- and analysis-thread
+// never read them directly
+static void gst_ebur128_take_measures(GstEbur128 *filter) {
+  GstEbur128Measures *measures = &filter->measures;
+
+  GST_OBJECT_LOCK(filter);
+  measures->momentary = filter->momentary;
+  measures->shortterm = filter->shortterm;
+  measures->global = filter->global;
+  measures->integrated_horizon = filter->integrated_horizon;
+  measures->window = filter->window;
+  g_array_set_size(measures->windows, 0);
+  g_array_append_vals(measures->windows, filter->windows->data, filter->windows->len);
+  measures->range = filter->range;
+  measures->sample_peak = filter->sample_peak;
+  measures->true_peak = filter->true_peak;
+  GST_OBJECT_UNLOCK(filter);
 }
 
 static gint gst_ebur128_calculate_libebur128_mode(GstEbur128 *filter) {
+  const GstEbur128Measures *measures = &filter->measures;
   gint mode = 0;
 
-  if (filter->momentary || filter->window > 0)
+  if (measures->momentary || gst_ebur128_calculate_max_window(filter) > 0)
     mode |= EBUR128_MODE_M;
-  if (filter->shortterm)
+  if (measures->shortterm)
     mode |= EBUR128_MODE_S;
-  if (filter->global)
+  if (measures->global)
     mode |= EBUR128_MODE_I;
-  if (filter->range)
+  if (measures->range)
     mode |= EBUR128_MODE_LRA;
 
-  if (filter->sample_peak)
+  if (measures->sample_peak)
     mode |= EBUR128_MODE_SAMPLE_PEAK;
-  if (filter->true_peak)
+  if (measures->true_peak)
     mode |= EBUR128_MODE_TRUE_PEAK;
 
   return mode;
 }
 
+// the history is sized for the longest of window and windows, the shorter ones are answered from its newest part
+static gulong gst_ebur128_calculate_max_window(GstEbur128 *filter) {
+  const GstEbur128Measures *measures = &filter->measures;
+  gulong max_window = measures->window;
+  for (guint i = 0; i < measures->windows->len; i++) {
+    max_window = MAX(max_window, g_array_index(measures->windows, gulong, i));
+  }
+  return max_window;
+}
+
 static void gst_ebur128_init_libebur128(GstEbur128 *filter) {
   gint rate = GST_AUDIO_INFO_RATE(&filter->audio_info);
   gint channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
   gint mode = gst_ebur128_calculate_libebur128_mode(filter);
+  gulong max_window = gst_ebur128_calculate_max_window(filter);
 
-  filter->state = ebur128_init(channels, rate, mode);
-  if (filter->window > 0) {
-    ebur128_set_max_window(filter->state, filter->window);
+  filter->state = gst_ebur128_state_new(channels, rate, mode);
+  gst_ebur128_set_channel_map(filter->state, &filter->audio_info);
+  if (max_window > 0) {
+    int ret = gst_ebur128_state_set_max_window(filter->state, max_window);
+    gst_ebur128_validate_lib_return("ebur128_set_max_window", ret);
   }
-  ebur128_set_max_history(filter->state, filter->max_history);
+  gst_ebur128_state_set_max_history(filter->state, filter->max_history);
+  gst_ebur128_state_set_gating_engine(filter->state, filter->gating_engine);
+  gst_ebur128_state_set_horizon(filter->state, filter->measures.integrated_horizon);
+  gst_ebur128_state_set_analysis_rate(filter->state, filter->analysis_rate);
+  gst_ebur128_state_set_prev_true_peak_floor(filter->state, filter->attach_meta ? 0.0 : G_MAXDOUBLE);
+  gst_ebur128_state_set_snapshot_func(filter->state, filter->interval_frames, gst_ebur128_snapshot, filter);
 
   GST_INFO_OBJECT(filter,
                   "Initializing libebur128: "
-                  "rate=%d channels=%d mode=0x%x max_window=%lu, max_history=%lu",
-                  rate, channels, mode, filter->window, filter->max_history);
+                  "rate=%d channels=%d mode=0x%x max_window=%lu, max_history=%lu, decimation=%u, kernel=%s",
+                  rate, channels, mode, max_window, filter->max_history, filter->state->decimation,
+                  gst_ebur128_kweighting_get_kernel_name(filter->state->kweighting));
 }
 
 static void gst_ebur128_destroy_libebur128(GstEbur128 *filter) {
   if (filter->state != NULL) {
     GST_INFO_OBJECT(filter, "Destroying libebur128 State");
-    ebur128_destroy(&filter->state);
+    gst_ebur128_state_destroy(&filter->state);
   }
 }
 
+// a new state continues the running message-interval of the old one and, where it can, its measurements
+static void gst_ebur128_reinit_libebur128(GstEbur128 *filter) {
+  guint snapshot_position = filter->state->snapshot_position;
+  GBytes *checkpoint = gst_ebur128_state_save(filter->state);
+  gst_ebur128_destroy_libebur128(filter);
+  gst_ebur128_init_libebur128(filter);
+  filter->state->snapshot_position = MIN(snapshot_position, filter->interval_frames - 1);
+
+  GError *error = NULL;
+  if (!gst_ebur128_state_restore(filter->state, checkpoint, &error)) {
+    GST_INFO_OBJECT(filter, "Global Loudness and Range start over: %s", error->message);
+    g_error_free(error);
+  }
+  g_bytes_unref(checkpoint);
+}
+
 static void gst_ebur128_reinit_libebur128_if_mode_changed(GstEbur128 *filter) {
   if (!filter->state) {
     // libebur128 not initialized yet
@@ -267,13 +659,45 @@ static void gst_ebur128_reinit_libebur128_if_mode_changed(GstEbur128 *filter) {
 
   gint new_mode = gst_ebur128_calculate_libebur128_mode(filter);
   gint current_mode = filter->state->mode;
+  if (filter->analysis_rate != filter->state->analysis_rate) {
+    GST_LOG_OBJECT(filter, "Analysis-Rate has changed from %lu to %lu, Re-Initializing libebur128 state",
+                   filter->state->analysis_rate, filter->analysis_rate);
+    gst_ebur128_reinit_libebur128(filter);
+    return;
+  }
+
+  if (filter->gating_engine != filter->state->gating_engine) {
+    GST_LOG_OBJECT(filter, "Gating-Engine has changed from %d to %d, Re-Initializing libebur128 state",
+                   filter->state->gating_engine, filter->gating_engine);
+    gst_ebur128_reinit_libebur128(filter);
+    return;
+  }
+
+  // toggled measurements are switched within the running state, the accumulated ones carry on
   if (current_mode != new_mode) {
-    GST_LOG_OBJECT(filter,
-                   "libebur128 Mode has changed from 0x%x to 0x%x, Destroying and "
-                   "Re-Initializing libebur128 state",
-                   current_mode, new_mode);
-    gst_ebur128_destroy_libebur128(filter);
-    gst_ebur128_init_libebur128(filter);
+    GST_LOG_OBJECT(filter, "libebur128 Mode has changed from 0x%x to 0x%x", current_mode, new_mode);
+    gst_ebur128_state_set_mode(filter->state, new_mode);
+  }
+
+  // a changed window only resizes the history, keeping the blocks that still fit
+  gulong max_window = gst_ebur128_calculate_max_window(filter);
+  if (max_window != filter->state->max_window) {
+    GST_LOG_OBJECT(filter, "Maximum Window has changed from %lu to %lu", filter->state->max_window, max_window);
+    int ret = gst_ebur128_state_set_max_window(filter->state, max_window);
+    gst_ebur128_validate_lib_return("ebur128_set_max_window", ret);
+  }
+
+  if (filter->measures.integrated_horizon != filter->state->horizon) {
+    GST_LOG_OBJECT(filter, "Integrated Horizon has changed from %lu to %lu", filter->state->horizon,
+                   filter->measures.integrated_horizon);
+    gst_ebur128_state_set_horizon(filter->state, filter->measures.integrated_horizon);
+  }
+
+  // a shorter history drops the oldest blocks of both gating-sets, a longer one keeps them all
+  if (filter->max_history != filter->state->max_history) {
+    GST_LOG_OBJECT(filter, "Maximum History has changed from %lu to %lu", filter->state->max_history,
+                   filter->max_history);
+    gst_ebur128_state_set_max_history(filter->state, filter->max_history);
   }
 }
 
@@ -295,6 +719,9 @@ static void gst_ebur128_recalc_interval_frames(GstEbur128 *filter) {
   }
 
   filter->interval_frames = interval_frames;
+  if (filter->state) {
+    gst_ebur128_state_set_snapshot_func(filter->state, interval_frames, gst_ebur128_snapshot, filter);
+  }
 
   GST_INFO_OBJECT(filter,
                   "interval_frames now %u for interval "
@@ -302,123 +729,350 @@ static void gst_ebur128_recalc_interval_frames(GstEbur128 *filter) {
                   interval_frames, GST_TIME_ARGS(interval), sample_rate);
 }
 
-static gboolean gst_ebur128_post_message(GstEbur128 *filter) {
-  if (!filter->post_messages) {
-    return TRUE;
+// taken by the state while a buffer is added, every interval_frames frames
+static void gst_ebur128_snapshot(GstEbur128State *state, gsize frames, gpointer user_data) {
+  GstEbur128 *filter = GST_EBUR128(user_data);
+  gst_ebur128_emit(filter, filter->frames_processed + frames, FALSE);
+}
+
+/**
+ * Publishes the latest values, posts the message and pushes the record for the measurement at frames_processed. The
+ * last one at EOS is always posted and completes the pending batch.
+ */
+static void gst_ebur128_emit(GstEbur128 *filter, guint64 frames_processed, gboolean eos) {
+  GstEbur128Latest latest;
+  gst_ebur128_take_latest(filter, &latest, frames_processed);
+  gst_ebur128_latest_publish(&filter->latest, &latest);
+  gst_ebur128_take_record(filter, &latest, frames_processed);
+
+  gst_ebur128_post_message(filter, frames_processed, eos);
+  if (eos) {
+    gst_ebur128_flush_batch(filter);
+  }
+
+  gst_ebur128_queue_measurement(filter);
+  gst_ebur128_write_shm(filter);
+  gst_ebur128_write_log(filter);
+}
+
+// handler of the get-latest action-signal, may be called from any thread
+static gboolean gst_ebur128_get_latest(GstEbur128 *filter, gpointer latest) {
+  g_return_val_if_fail(latest != NULL, FALSE);
+  return gst_ebur128_latest_read(&filter->latest, latest);
+}
+
+static GBytes *gst_ebur128_save_state(GstEbur128 *filter) {
+  g_rec_mutex_lock(&filter->state_lock);
+  GBytes *checkpoint = filter->state != NULL ? gst_ebur128_state_save(filter->state) : NULL;
+  g_rec_mutex_unlock(&filter->state_lock);
+  return checkpoint;
+}
+
+static void gst_ebur128_restore_state(GstEbur128 *filter, GBytes *checkpoint) {
+  g_return_if_fail(checkpoint != NULL);
+
+  GST_OBJECT_LOCK(filter);
+  g_clear_pointer(&filter->pending_checkpoint, g_bytes_unref);
+  filter->pending_checkpoint = g_bytes_ref(checkpoint);
+  GST_OBJECT_UNLOCK(filter);
+}
+
+// restores a checkpoint that has been handed to restore-state, called with the state-lock held
+static void gst_ebur128_restore_pending_checkpoint(GstEbur128 *filter) {
+  GST_OBJECT_LOCK(filter);
+  GBytes *checkpoint = g_steal_pointer(&filter->pending_checkpoint);
+  GST_OBJECT_UNLOCK(filter);
+
+  if (checkpoint == NULL) {
+    return;
   }
 
-  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST(filter);
+  GError *error = NULL;
+  if (gst_ebur128_state_restore(filter->state, checkpoint, &error)) {
+    GST_INFO_OBJECT(filter, "Restored a Checkpoint of %" G_GSIZE_FORMAT " bytes", g_bytes_get_size(checkpoint));
+  } else {
+    GST_ELEMENT_WARNING(filter, STREAM, FAILED, ("Could not restore the Checkpoint"), ("%s", error->message));
+    g_error_free(error);
+  }
+  g_bytes_unref(checkpoint);
+}
 
-  // Increment Message-Timestamp
+static void gst_ebur128_message_times(GstEbur128 *filter, guint64 frames_processed, GstClockTime *timestamp,
+                                      GstClockTime *running_time, GstClockTime *stream_time) {
+  // Increment Message-Timestamp, in the segment of the buffer that is analyzed
   guint sample_rate = GST_AUDIO_INFO_RATE(&filter->audio_info);
-  GstClockTime duration_processed = GST_FRAMES_TO_CLOCK_TIME(filter->frames_processed, sample_rate);
+  GstClockTime duration_processed = GST_FRAMES_TO_CLOCK_TIME(frames_processed, sample_rate);
+
+  *timestamp = filter->start_ts + duration_processed;
+  *running_time = gst_segment_to_running_time(&filter->segment, GST_FORMAT_TIME, *timestamp);
+  *stream_time = gst_segment_to_stream_time(&filter->segment, GST_FORMAT_TIME, *timestamp);
+}
+
+// a change that is not a number, like from silence (-inf) to sound, always counts
+static gboolean gst_ebur128_changed(gdouble posted, gdouble value, gdouble threshold) {
+  return posted != value && !(fabs(value - posted) <= threshold);
+}
 
-  GstClockTime timestamp = filter->start_ts + duration_processed;
-  GstClockTime running_time = gst_segment_to_running_time(&trans->segment, GST_FORMAT_TIME, timestamp);
-  GstClockTime stream_time = gst_segment_to_stream_time(&trans->segment, GST_FORMAT_TIME, timestamp);
+static gboolean gst_ebur128_peak_changed(gdouble posted, gdouble value, gdouble threshold) {
+  return gst_ebur128_changed(20 * log10(posted), 20 * log10(value), threshold);
+}
+
+/**
+ * Whether a message is due with a post-threshold, compared to the last posted one. The windows follow the other
+ * loudnesses closely enough that they are not compared themselves, so they are only current with them. The peaks of all
+ * channels are compared, the record holds the ones beyond the latest values as well.
+ */
+static gboolean gst_ebur128_message_due(GstEbur128 *filter, guint64 frames_processed) {
+  const GstEbur128MeasurementRecord *record = filter->record;
+  const GstEbur128MeasurementRecord *posted = filter->posted;
+  if (filter->post_threshold <= 0.0 || posted == NULL || frames_processed < filter->posted_frames ||
+      posted->channels != record->channels || posted->num_windows != record->num_windows) {
+    return TRUE;
+  }
 
-  GstStructure *structure =
-      gst_structure_new("loudness", "timestamp", G_TYPE_UINT64, timestamp, "stream-time", G_TYPE_UINT64, stream_time,
-                        "running-time", G_TYPE_UINT64, running_time, NULL);
+  guint sample_rate = GST_AUDIO_INFO_RATE(&filter->audio_info);
+  GstClockTime silence = GST_FRAMES_TO_CLOCK_TIME(frames_processed - filter->posted_frames, sample_rate);
+  if (GST_CLOCK_TIME_IS_VALID(filter->post_max_silence) && silence >= filter->post_max_silence) {
+    return TRUE;
+  }
+
+  gdouble threshold = filter->post_threshold;
+  if (record->flags != posted->flags || gst_ebur128_changed(posted->momentary, record->momentary, threshold) ||
+      gst_ebur128_changed(posted->shortterm, record->shortterm, threshold) ||
+      gst_ebur128_changed(posted->global, record->global, threshold) ||
+      gst_ebur128_changed(posted->range, record->range, threshold)) {
+    return TRUE;
+  }
+
+  const gdouble *posted_sample_peak = gst_ebur128_measurement_sample_peak(posted);
+  const gdouble *posted_true_peak = gst_ebur128_measurement_true_peak(posted);
+  const gdouble *sample_peak = gst_ebur128_measurement_sample_peak(record);
+  const gdouble *true_peak = gst_ebur128_measurement_true_peak(record);
+  for (guint channel = 0; channel < record->channels; channel++) {
+    if (gst_ebur128_peak_changed(posted_sample_peak[channel], sample_peak[channel], threshold) ||
+        gst_ebur128_peak_changed(posted_true_peak[channel], true_peak[channel], threshold)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static void gst_ebur128_flush_batch(GstEbur128 *filter) {
+  if (!G_IS_VALUE(&filter->batch)) {
+    return;
+  }
+
+  if (gst_value_array_get_size(&filter->batch) > 0) {
+    GstStructure *structure = gst_structure_new_empty("loudness-batch");
+    gst_structure_take_value(structure, "measurements", &filter->batch);
+
+    GstMessage *message = gst_message_new_element(GST_OBJECT(filter), structure);
+    gst_element_post_message(GST_ELEMENT(filter), message);
+    GST_LOG_OBJECT(filter, "emitting loudness-batch-message");
+  } else {
+    g_value_unset(&filter->batch);
+  }
+  filter->batch = (GValue)G_VALUE_INIT;
+}
+
+// collects the structure into the pending batch, which is posted once it holds post-batch of them
+static void gst_ebur128_batch_structure(GstEbur128 *filter, GstStructure *structure) {
+  if (!G_IS_VALUE(&filter->batch)) {
+    g_value_init(&filter->batch, GST_TYPE_ARRAY);
+  }
+
+  GValue value = G_VALUE_INIT;
+  g_value_init(&value, GST_TYPE_STRUCTURE);
+  g_value_take_boxed(&value, structure);
+  gst_value_array_append_and_take_value(&filter->batch, &value);
+
+  if (gst_value_array_get_size(&filter->batch) >= filter->post_batch) {
+    gst_ebur128_flush_batch(filter);
+  }
+}
+
+/**
+ * Posts the record of the current interval as message. Everything but the integrated-horizon, which has no place in the
+ * record, is taken from there instead of being queried again.
+ */
+static gboolean gst_ebur128_post_message(GstEbur128 *filter, guint64 frames_processed, gboolean force) {
+  if (!filter->post_messages || !(force || gst_ebur128_message_due(filter, frames_processed))) {
+    return TRUE;
+  }
+
+  const GstEbur128Measures *measures = &filter->measures;
+  const GstEbur128MeasurementRecord *record = filter->record;
+  GstStructure *structure = gst_structure_new("loudness", "timestamp", G_TYPE_UINT64, record->timestamp, "stream-time",
+                                              G_TYPE_UINT64, record->stream_time, "running-time", G_TYPE_UINT64,
+                                              record->running_time, NULL);
 
   gboolean success = TRUE;
   // momentary loudness (last 400ms) in LUFS.
-  if (filter->momentary) {
-    double momentary;
-    int ret = ebur128_loudness_momentary(filter->state, &momentary);
-    success &= gst_ebur128_validate_lib_return("ebur128_loudness_momentary", ret);
-    gst_structure_set(structure, "momentary", G_TYPE_DOUBLE, momentary, NULL);
+  if (measures->momentary) {
+    gst_structure_set(structure, "momentary", G_TYPE_DOUBLE, record->momentary, NULL);
   }
 
   // short-term loudness (last 3s) in LUFS.
-  if (filter->shortterm) {
-    double shortterm;
-    int ret = ebur128_loudness_shortterm(filter->state, &shortterm);
-    success &= gst_ebur128_validate_lib_return("ebur128_loudness_shortterm", ret);
-    gst_structure_set(structure, "shortterm", G_TYPE_DOUBLE, shortterm, NULL);
+  if (measures->shortterm) {
+    gst_structure_set(structure, "shortterm", G_TYPE_DOUBLE, record->shortterm, NULL);
   }
 
   // global integrated loudness in LUFS.
-  if (filter->global) {
-    double global;
-    int ret = ebur128_loudness_global(filter->state, &global);
-    success &= gst_ebur128_validate_lib_return("ebur128_loudness_global", ret);
-    gst_structure_set(structure, "global", G_TYPE_DOUBLE, global, NULL);
+  if (measures->global) {
+    gst_structure_set(structure, "global", G_TYPE_DOUBLE, record->global, NULL);
+  }
+
+  // gated integrated loudness of the trailing horizon in LUFS.
+  if (measures->integrated_horizon > 0) {
+    double integrated_horizon;
+    int ret = gst_ebur128_state_loudness_horizon(filter->state, &integrated_horizon);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_horizon", ret);
+    gst_structure_set(structure, "integrated-horizon", G_TYPE_DOUBLE, integrated_horizon, NULL);
   }
 
-  // loudness of the specified window in LUFS.
-  if (filter->window > 0) {
-    double window;
-    int ret = ebur128_loudness_window(filter->state, filter->window, &window);
-    success &= gst_ebur128_validate_lib_return("ebur128_loudness_window", ret);
-    gst_structure_set(structure, "window", G_TYPE_DOUBLE, window, NULL);
+  // loudness of the specified window in LUFS, the first of the windows in the record.
+  const gdouble *windows = gst_ebur128_measurement_windows(record);
+  if (measures->window > 0) {
+    gst_structure_set(structure, "window", G_TYPE_DOUBLE, *windows++, NULL);
+  }
+
+  // loudness of each of the specified windows in LUFS, in the order of the windows-property.
+  if (measures->windows->len > 0) {
+    GValue windows_gvalue = {
+        0,
+    };
+    gst_ebur128_fill_windows_array(&windows_gvalue, windows, measures->windows->len);
+    gst_structure_take_value(structure, "windows", &windows_gvalue);
   }
 
   // loudness range (LRA) of programme in LU.
-  if (filter->range) {
-    double range;
-    int ret = ebur128_loudness_range(filter->state, &range);
-    success &= gst_ebur128_validate_lib_return("ebur128_loudness_range", ret);
-    gst_structure_set(structure, "range", G_TYPE_DOUBLE, range, NULL);
+  if (measures->range) {
+    gst_structure_set(structure, "range", G_TYPE_DOUBLE, record->range, NULL);
   }
 
   // Maximum sample peak in float format (1.0 is 0 dBFS) from the last Frames,
   // by channel. The equation to convert to dBFS is: 20 * log10(out).
-  if (filter->sample_peak) {
+  if (measures->sample_peak) {
     GValue sample_peak = {
         0,
     };
-    success &= gst_ebur128_fill_channel_array(filter, &sample_peak, "ebur128_sample_peak", &ebur128_sample_peak);
+    gst_ebur128_fill_channel_array(filter, &sample_peak, gst_ebur128_measurement_sample_peak(record),
+                                   record->channels);
     gst_structure_take_value(structure, "sample-peak", &sample_peak);
   }
 
   // Maximum true peak in float format (1.0 is 0 dBFS) from all frames that have
   // been processed, by channel. The eqation to convert to dBTP is: 20 *
   // log10(out).
-  if (filter->true_peak) {
+  if (measures->true_peak) {
     GValue true_peak = {
         0,
     };
-    success &= gst_ebur128_fill_channel_array(filter, &true_peak, "ebur128_true_peak", &ebur128_true_peak);
+    gst_ebur128_fill_channel_array(filter, &true_peak, gst_ebur128_measurement_true_peak(record), record->channels);
     gst_structure_take_value(structure, "true-peak", &true_peak);
   }
 
   if (success) {
-    GstMessage *message = gst_message_new_element(GST_OBJECT(filter), structure);
-    gst_element_post_message(GST_ELEMENT(filter), message);
-
-    GST_INFO_OBJECT(filter, "emitting loudness-message at %" GST_TIME_FORMAT, GST_TIME_ARGS(timestamp));
+    gsize size = GST_EBUR128_MEASUREMENT_SIZE(record->channels, record->num_windows);
+    filter->posted = g_realloc(filter->posted, size);
+    memcpy(filter->posted, record, size);
+    filter->posted_frames = frames_processed;
+
+    if (filter->post_batch > 1 || G_IS_VALUE(&filter->batch)) {
+      gst_ebur128_batch_structure(filter, structure);
+    } else {
+      GstMessage *message = gst_message_new_element(GST_OBJECT(filter), structure);
+      gst_element_post_message(GST_ELEMENT(filter), message);
+
+      GST_LOG_OBJECT(filter, "emitting loudness-message at %" GST_TIME_FORMAT, GST_TIME_ARGS(record->timestamp));
+    }
 
   } else {
     GST_ERROR_OBJECT(filter, "error getting the requested calculation results from libebur128");
+    gst_structure_free(structure);
   }
   return success;
 }
 
-static gboolean gst_ebur128_fill_channel_array(GstEbur128 *filter, GValue *array_gvalue, const char *func_name,
-                                               per_channel_func_t func) {
+/**
+ * Fills array_gvalue with the value of every channel, either as GValueArray of doubles or, with packed-peaks, as GBytes
+ * of native doubles.
+ */
+static void gst_ebur128_fill_channel_array(GstEbur128 *filter, GValue *array_gvalue, const gdouble *values,
+                                           guint channels) {
+  if (filter->packed_peaks) {
+    g_value_init(array_gvalue, G_TYPE_BYTES);
+    g_value_take_boxed(array_gvalue, g_bytes_new(values, channels * sizeof(gdouble)));
+    return;
+  }
+
   g_value_init(array_gvalue, G_TYPE_VALUE_ARRAY);
-  GValueArray *array = g_value_array_new(0);
+  GValueArray *array = g_value_array_new(channels);
   g_value_take_boxed(array_gvalue, array);
 
-  double double_value = 0.0;
   GValue double_gvalue = {
       0,
   };
   g_value_init(&double_gvalue, G_TYPE_DOUBLE);
 
-  gint channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
+  for (guint channel = 0; channel < channels; channel++) {
+    g_value_set_double(&double_gvalue, values[channel]);
+    g_value_array_append(array, &double_gvalue);
+  }
+}
 
-  gboolean success = TRUE;
+static void gst_ebur128_fill_windows_array(GValue *array_gvalue, const gdouble *values, guint num_windows) {
+  g_value_init(array_gvalue, G_TYPE_VALUE_ARRAY);
+  GValueArray *array = g_value_array_new(num_windows);
+  g_value_take_boxed(array_gvalue, array);
 
-  for (gint channel = 0; channel < channels; channel++) {
-    int ret = func(filter->state, channel, &double_value);
-    success &= gst_ebur128_validate_lib_return(func_name, ret);
-    g_value_set_double(&double_gvalue, double_value);
+  GValue double_gvalue = {
+      0,
+  };
+  g_value_init(&double_gvalue, G_TYPE_DOUBLE);
+
+  for (guint i = 0; i < num_windows; i++) {
+    g_value_set_double(&double_gvalue, values[i]);
     g_value_array_append(array, &double_gvalue);
   }
+}
 
-  return success;
+// the windows are parsed into a new array, which replaces the old one with the object-lock held
+static void gst_ebur128_set_windows(GstEbur128 *filter, const GValue *value) {
+  GArray *windows = g_array_new(FALSE, FALSE, sizeof(gulong));
+
+  for (guint i = 0; i < gst_value_array_get_size(value); i++) {
+    GValue window_gvalue = G_VALUE_INIT;
+    g_value_init(&window_gvalue, G_TYPE_ULONG);
+
+    // gst-launch and gst_util_set_object_arg hand in the windows as plain integers
+    if (g_value_transform(gst_value_array_get_value(value, i), &window_gvalue) &&
+        g_value_get_ulong(&window_gvalue) > 0) {
+      gulong window = g_value_get_ulong(&window_gvalue);
+      g_array_append_val(windows, window);
+    } else {
+      GST_WARNING_OBJECT(filter, "ignoring invalid window at index %u", i);
+    }
+
+    g_value_unset(&window_gvalue);
+  }
+
+  GST_OBJECT_LOCK(filter);
+  GArray *previous = filter->windows;
+  filter->windows = windows;
+  GST_OBJECT_UNLOCK(filter);
+  g_array_free(previous, TRUE);
+}
+
+static void gst_ebur128_get_windows(GstEbur128 *filter, GValue *value) {
+  GST_OBJECT_LOCK(filter);
+  for (guint i = 0; i < filter->windows->len; i++) {
+    GValue window_gvalue = G_VALUE_INIT;
+    g_value_init(&window_gvalue, G_TYPE_ULONG);
+    g_value_set_ulong(&window_gvalue, g_array_index(filter->windows, gulong, i));
+    gst_value_array_append_and_take_value(value, &window_gvalue);
+  }
+  GST_OBJECT_UNLOCK(filter);
 }
 
 static void gst_ebur128_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec) {
@@ -426,46 +1080,115 @@ static void gst_ebur128_set_property(GObject *object, guint prop_id, const GValu
 
   switch (prop_id) {
   case PROP_MOMENTARY:
+    GST_OBJECT_LOCK(filter);
     filter->momentary = g_value_get_boolean(value);
+    GST_OBJECT_UNLOCK(filter);
     break;
   case PROP_SHORTTERM:
+    GST_OBJECT_LOCK(filter);
     filter->shortterm = g_value_get_boolean(value);
+    GST_OBJECT_UNLOCK(filter);
     break;
   case PROP_GLOBAL:
+    GST_OBJECT_LOCK(filter);
     filter->global = g_value_get_boolean(value);
+    GST_OBJECT_UNLOCK(filter);
+    break;
+  case PROP_INTEGRATED_HORIZON:
+    GST_OBJECT_LOCK(filter);
+    filter->integrated_horizon = g_value_get_ulong(value);
+    GST_OBJECT_UNLOCK(filter);
     break;
   case PROP_WINDOW:
+    GST_OBJECT_LOCK(filter);
     filter->window = g_value_get_ulong(value);
+    GST_OBJECT_UNLOCK(filter);
+    break;
+  case PROP_WINDOWS:
+    gst_ebur128_set_windows(filter, value);
     break;
   case PROP_RANGE:
+    GST_OBJECT_LOCK(filter);
     filter->range = g_value_get_boolean(value);
+    GST_OBJECT_UNLOCK(filter);
     break;
   case PROP_SAMPLE_PEAK:
+    GST_OBJECT_LOCK(filter);
     filter->sample_peak = g_value_get_boolean(value);
+    GST_OBJECT_UNLOCK(filter);
     break;
   case PROP_TRUE_PEAK:
+    GST_OBJECT_LOCK(filter);
     filter->true_peak = g_value_get_boolean(value);
+    GST_OBJECT_UNLOCK(filter);
     break;
   case PROP_MAX_HISTORY:
     filter->max_history = g_value_get_ulong(value);
     break;
+  case PROP_GATING_ENGINE:
+    filter->gating_engine = g_value_get_enum(value);
+    break;
+  case PROP_ANALYSIS_RATE:
+    filter->analysis_rate = g_value_get_ulong(value);
+    break;
   case PROP_POST_MESSAGES:
     filter->post_messages = g_value_get_boolean(value);
     break;
+  case PROP_POST_THRESHOLD:
+    filter->post_threshold = g_value_get_double(value);
+    break;
+  case PROP_POST_MAX_SILENCE:
+    filter->post_max_silence = g_value_get_uint64(value);
+    break;
+  case PROP_POST_BATCH:
+    filter->post_batch = g_value_get_uint(value);
+    break;
+  case PROP_PACKED_PEAKS:
+    filter->packed_peaks = g_value_get_boolean(value);
+    break;
   case PROP_INTERVAL:
     filter->interval = g_value_get_uint64(value);
-    /* Not exactly thread-safe, but property does not advertise that it
-     * can be changed at runtime anyway */
-    if (GST_AUDIO_INFO_RATE(&filter->audio_info)) {
-      gst_ebur128_recalc_interval_frames(filter);
-    }
+    break;
+  case PROP_ASYNC:
+    filter->async = g_value_get_boolean(value);
+    break;
+  case PROP_ASYNC_QUEUE_SIZE:
+    filter->async_queue_size = g_value_get_uint(value);
+    break;
+  case PROP_ASYNC_OVERFLOW:
+    filter->async_overflow = g_value_get_enum(value);
+    break;
+  case PROP_ATTACH_META:
+    filter->attach_meta = g_value_get_boolean(value);
+    gst_base_transform_set_passthrough(GST_BASE_TRANSFORM(filter), !filter->attach_meta);
+    break;
+  case PROP_SHM_NAME:
+    GST_OBJECT_LOCK(filter);
+    g_free(filter->shm_name);
+    filter->shm_name = g_value_dup_string(value);
+    filter->shm_failed = FALSE;
+    GST_OBJECT_UNLOCK(filter);
+    break;
+  case PROP_SHM_RECORDS:
+    filter->shm_records = g_value_get_uint(value);
+    break;
+  case PROP_LOCATION:
+    GST_OBJECT_LOCK(filter);
+    g_free(filter->location);
+    filter->location = g_value_dup_string(value);
+    filter->log_failed = FALSE;
+    GST_OBJECT_UNLOCK(filter);
+    break;
+  case PROP_LOG_FORMAT:
+    filter->log_format = g_value_get_enum(value);
+    break;
+  case PROP_LOG_FSYNC_INTERVAL:
+    filter->log_fsync_interval = g_value_get_uint64(value);
     break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
     break;
   }
-
-  gst_ebur128_reinit_libebur128_if_mode_changed(filter);
 }
 
 static void gst_ebur128_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec) {
@@ -481,8 +1204,16 @@ static void gst_ebur128_get_property(GObject *object, guint prop_id, GValue *val
   case PROP_GLOBAL:
     g_value_set_boolean(value, filter->global);
     break;
+  case PROP_INTEGRATED_HORIZON:
+    g_value_set_ulong(value, filter->integrated_horizon);
+    break;
   case PROP_WINDOW:
+    GST_OBJECT_LOCK(filter);
     g_value_set_ulong(value, filter->window);
+    GST_OBJECT_UNLOCK(filter);
+    break;
+  case PROP_WINDOWS:
+    gst_ebur128_get_windows(filter, value);
     break;
   case PROP_RANGE:
     g_value_set_boolean(value, filter->range);
@@ -496,12 +1227,61 @@ static void gst_ebur128_get_property(GObject *object, guint prop_id, GValue *val
   case PROP_MAX_HISTORY:
     g_value_set_ulong(value, filter->max_history);
     break;
+  case PROP_GATING_ENGINE:
+    g_value_set_enum(value, filter->gating_engine);
+    break;
+  case PROP_ANALYSIS_RATE:
+    g_value_set_ulong(value, filter->analysis_rate);
+    break;
   case PROP_POST_MESSAGES:
     g_value_set_boolean(value, filter->post_messages);
     break;
+  case PROP_POST_THRESHOLD:
+    g_value_set_double(value, filter->post_threshold);
+    break;
+  case PROP_POST_MAX_SILENCE:
+    g_value_set_uint64(value, filter->post_max_silence);
+    break;
+  case PROP_POST_BATCH:
+    g_value_set_uint(value, filter->post_batch);
+    break;
+  case PROP_PACKED_PEAKS:
+    g_value_set_boolean(value, filter->packed_peaks);
+    break;
   case PROP_INTERVAL:
     g_value_set_uint64(value, filter->interval);
     break;
+  case PROP_ASYNC:
+    g_value_set_boolean(value, filter->async);
+    break;
+  case PROP_ASYNC_QUEUE_SIZE:
+    g_value_set_uint(value, filter->async_queue_size);
+    break;
+  case PROP_ASYNC_OVERFLOW:
+    g_value_set_enum(value, filter->async_overflow);
+    break;
+  case PROP_ATTACH_META:
+    g_value_set_boolean(value, filter->attach_meta);
+    break;
+  case PROP_SHM_NAME:
+    GST_OBJECT_LOCK(filter);
+    g_value_set_string(value, filter->shm_name);
+    GST_OBJECT_UNLOCK(filter);
+    break;
+  case PROP_SHM_RECORDS:
+    g_value_set_uint(value, filter->shm_records);
+    break;
+  case PROP_LOCATION:
+    GST_OBJECT_LOCK(filter);
+    g_value_set_string(value, filter->location);
+    GST_OBJECT_UNLOCK(filter);
+    break;
+  case PROP_LOG_FORMAT:
+    g_value_set_enum(value, filter->log_format);
+    break;
+  case PROP_LOG_FSYNC_INTERVAL:
+    g_value_set_uint64(value, filter->log_fsync_interval);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
     break;
@@ -514,29 +1294,86 @@ static gboolean gst_ebur128_set_caps(GstBaseTransform *trans, GstCaps *in, GstCa
   GST_LOG_OBJECT(filter, "Received Caps in:  %" GST_PTR_FORMAT, in);
   GST_LOG_OBJECT(filter, "Received Caps out: %" GST_PTR_FORMAT, out);
 
-  /* store audio-info */
-  if (!gst_audio_info_from_caps(&filter->audio_info, in)) {
+  GstAudioInfo audio_info;
+  if (!gst_audio_info_from_caps(&audio_info, in)) {
     GST_ERROR_OBJECT(filter, "Unhandled Caps: %" GST_PTR_FORMAT, in);
     return FALSE;
   }
 
-  /* init libebur128 */
-  gst_ebur128_init_libebur128(filter);
+  /* passthrough_on_same_caps has just enabled passthrough, but the meta needs writable buffers */
+  gst_base_transform_set_passthrough(trans, !filter->attach_meta);
+
+  /* buffers of the old caps are analyzed with the old state and audio-info */
+  gst_ebur128_drain_async(filter);
+
+  g_rec_mutex_lock(&filter->state_lock);
+  gboolean same_layout = filter->state != NULL && gst_ebur128_same_layout(&filter->audio_info, &audio_info);
+  filter->audio_info = audio_info;
+
+  /* a new sample-format is analyzed by the running state, a new rate or channel-layout needs a new one, which continues
+   * the measurements of the old one */
+  if (same_layout) {
+    GST_INFO_OBJECT(filter, "Rate and Channel-Layout are unchanged, keeping the libebur128 State");
+  } else {
+    GstEbur128State *previous = g_steal_pointer(&filter->state);
+    gst_ebur128_take_measures(filter);
+    gst_ebur128_init_libebur128(filter);
+
+    if (previous != NULL) {
+      if (!gst_ebur128_state_carry_over(filter->state, previous)) {
+        GST_INFO_OBJECT(filter, "Global Loudness and Range start over: can not continue histograms with exact gating");
+      }
+      gst_ebur128_state_destroy(&previous);
+    }
+  }
+
+  /* resume from a checkpoint handed to restore-state before */
+  gst_ebur128_restore_pending_checkpoint(filter);
 
   /* calculate interval */
   gst_ebur128_recalc_interval_frames(filter);
+  g_rec_mutex_unlock(&filter->state_lock);
 
   return TRUE;
 }
 
 static gboolean gst_ebur128_sink_event(GstBaseTransform *trans, GstEvent *event) {
-  if (GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
-    GstEbur128 *filter = GST_EBUR128(trans);
+  GstEbur128 *filter = GST_EBUR128(trans);
+
+  switch (GST_EVENT_TYPE(event)) {
+  case GST_EVENT_FLUSH_START:
+    // not serialized, the streaming-thread may be waiting for space in the ring or about to stop it
+    GST_OBJECT_LOCK(filter);
+    if (filter->ring != NULL) {
+      GST_DEBUG_OBJECT(filter, "flushing, dropping queued Buffers");
+      gst_ebur128_ring_set_flushing(filter->ring, TRUE);
+    }
+    GST_OBJECT_UNLOCK(filter);
+    break;
+  case GST_EVENT_FLUSH_STOP:
+    // waits until the analysis-thread has discarded the buffers queued before the flush
+    if (filter->ring != NULL) {
+      gst_ebur128_drain_async(filter);
+      gst_ebur128_ring_set_flushing(filter->ring, FALSE);
+    }
+    break;
+  case GST_EVENT_EOS:
+    gst_ebur128_drain_async(filter);
 
+    g_rec_mutex_lock(&filter->state_lock);
     if (filter->state) {
       GST_DEBUG_OBJECT(filter, "received EOS, emitting last Message");
-      gst_ebur128_post_message(filter);
+      gst_ebur128_emit(filter, filter->frames_processed, TRUE);
     }
+    g_rec_mutex_unlock(&filter->state_lock);
+    gst_ebur128_push_measurements(filter);
+
+    if (filter->meas_configured_pad) {
+      gst_pad_push_event(filter->meas_configured_pad, gst_event_new_eos());
+    }
+    break;
+  default:
+    break;
   }
 
   return GST_BASE_TRANSFORM_CLASS(parent_class)->sink_event(trans, event);
@@ -546,64 +1383,658 @@ static gboolean gst_ebur128_start(GstBaseTransform *trans) {
   GstEbur128 *filter = GST_EBUR128(trans);
 
   filter->start_ts = GST_CLOCK_TIME_NONE;
-  filter->frames_since_last_mesage = 0;
+  filter->async_dropped = FALSE;
+  filter->async_error = FALSE;
+  g_clear_pointer(&filter->posted, g_free);
+  filter->log_failed = FALSE;
+
+  // renegotiation continues the measurements, a new stream starts them over. The old state is kept until here, so it
+  // can be saved after the pipeline has stopped
+  g_rec_mutex_lock(&filter->state_lock);
+  gst_ebur128_destroy_libebur128(filter);
+  g_rec_mutex_unlock(&filter->state_lock);
 
   return TRUE;
 }
 
-static GstFlowReturn gst_ebur128_transform_ip(GstBaseTransform *trans, GstBuffer *buf) {
+static gboolean gst_ebur128_stop(GstBaseTransform *trans) {
   GstEbur128 *filter = GST_EBUR128(trans);
 
-  // Map and Analyze buffer
-  GstMapInfo map_info;
-  gst_buffer_map(buf, &map_info, GST_MAP_READ);
+  gst_ebur128_stop_async(filter);
+  g_queue_clear_full(&filter->meas_queue, (GDestroyNotify)gst_mini_object_unref);
+  gst_ebur128_release_measurement_pool(filter);
+  gst_clear_object(&filter->meas_configured_pad);
+  g_clear_pointer(&filter->shm_writer, gst_ebur128_shm_writer_free);
+
+  // writes what is still queued, the next start truncates the log again
+  g_clear_pointer(&filter->logger, gst_ebur128_logger_free);
+  g_clear_pointer(&filter->log_opened, g_free);
+
+  // a batch that did not see EOS is dropped with the stream
+  if (G_IS_VALUE(&filter->batch)) {
+    g_value_unset(&filter->batch);
+  }
+
+  return TRUE;
+}
+
+static GstPad *gst_ebur128_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *name,
+                                           const GstCaps *caps) {
+  GstEbur128 *filter = GST_EBUR128(element);
+
+  GST_OBJECT_LOCK(filter);
+  if (filter->meas_srcpad != NULL) {
+    GST_OBJECT_UNLOCK(filter);
+    GST_WARNING_OBJECT(filter, "meas_src Pad has already been requested");
+    return NULL;
+  }
+
+  GstPad *pad = gst_pad_new_from_template(templ, "meas_src");
+  gst_pad_use_fixed_caps(pad);
+  filter->meas_srcpad = pad;
+  GST_OBJECT_UNLOCK(filter);
+
+  gst_element_add_pad(element, pad);
+  return pad;
+}
+
+static void gst_ebur128_release_pad(GstElement *element, GstPad *pad) {
+  GstEbur128 *filter = GST_EBUR128(element);
+
+  GST_OBJECT_LOCK(filter);
+  if (filter->meas_srcpad == pad) {
+    filter->meas_srcpad = NULL;
+  }
+  GST_OBJECT_UNLOCK(filter);
+
+  gst_pad_set_active(pad, FALSE);
+  gst_element_remove_pad(element, pad);
+}
+
+static void gst_ebur128_release_measurement_pool(GstEbur128 *filter) {
+  if (filter->meas_pool != NULL) {
+    gst_buffer_pool_set_active(filter->meas_pool, FALSE);
+    gst_clear_object(&filter->meas_pool);
+  }
+}
+
+// sticky events are sent ahead of the next record or gap, so storing them never blocks on downstream
+static void gst_ebur128_store_measurement_event(GstPad *pad, GstEvent *event) {
+  gst_pad_store_sticky_event(pad, event);
+  gst_event_unref(event);
+}
+
+/**
+ * Sends stream-start to a pad that has not seen it yet, and caps and a pool sized for the records whenever the
+ * number of channels or windows changes.
+ */
+static gboolean gst_ebur128_configure_measurement_pad(GstEbur128 *filter, GstPad *pad, guint channels,
+                                                      guint num_windows) {
+  if (filter->meas_configured_pad != pad) {
+    gst_object_replace((GstObject **)&filter->meas_configured_pad, GST_OBJECT(pad));
+    gst_ebur128_release_measurement_pool(filter);
+
+    gchar *stream_id = gst_pad_create_stream_id(pad, GST_ELEMENT(filter), "meas");
+    gst_ebur128_store_measurement_event(pad, gst_event_new_stream_start(stream_id));
+    g_free(stream_id);
+    gst_segment_init(&filter->meas_segment, GST_FORMAT_UNDEFINED);
+  }
+
+  gsize size = GST_EBUR128_MEASUREMENT_SIZE(channels, num_windows);
+  if (filter->meas_pool == NULL || filter->meas_size != size) {
+    gst_ebur128_release_measurement_pool(filter);
+
+    GstCaps *caps = gst_caps_new_simple(GST_EBUR128_MEASUREMENT_MEDIA_TYPE, "version", G_TYPE_INT,
+                                        GST_EBUR128_MEASUREMENT_VERSION, "channels", G_TYPE_INT, channels, "windows",
+                                        G_TYPE_INT, num_windows, NULL);
+    gst_ebur128_store_measurement_event(pad, gst_event_new_caps(caps));
+
+    filter->meas_pool = gst_buffer_pool_new();
+    GstStructure *config = gst_buffer_pool_get_config(filter->meas_pool);
+    gst_buffer_pool_config_set_params(config, caps, size, MEASUREMENT_POOL_MIN_BUFFERS, 0);
+    gst_buffer_pool_set_config(filter->meas_pool, config);
+    gst_caps_unref(caps);
+
+    if (!gst_buffer_pool_set_active(filter->meas_pool, TRUE)) {
+      GST_ERROR_OBJECT(filter, "could not activate the Buffer-Pool for the meas_src Pad");
+      gst_clear_object(&filter->meas_pool);
+      return FALSE;
+    }
+    filter->meas_size = size;
+  }
+
+  if (!gst_segment_is_equal(&filter->meas_segment, &filter->segment)) {
+    gst_segment_copy_into(&filter->segment, &filter->meas_segment);
+    gst_ebur128_store_measurement_event(pad, gst_event_new_segment(&filter->meas_segment));
+  }
+
+  return TRUE;
+}
+
+/**
+ * Takes the measurements the message would carry, which are published for the get-latest signal and are the head of
+ * the record.
+ */
+static void gst_ebur128_take_latest(GstEbur128 *filter, GstEbur128Latest *latest, guint64 frames_processed) {
+  const GstEbur128Measures *measures = &filter->measures;
+  memset(latest, 0, sizeof(GstEbur128Latest));
+  latest->channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
+
+  GstClockTime stream_time;
+  gst_ebur128_message_times(filter, frames_processed, &latest->timestamp, &latest->running_time, &stream_time);
+
+  gboolean success = TRUE;
+  if (measures->momentary) {
+    latest->flags |= GST_EBUR128_META_MOMENTARY;
+    int ret = gst_ebur128_state_loudness_momentary(filter->state, &latest->momentary);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_momentary", ret);
+  }
+  if (measures->shortterm) {
+    latest->flags |= GST_EBUR128_META_SHORTTERM;
+    int ret = gst_ebur128_state_loudness_shortterm(filter->state, &latest->shortterm);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_shortterm", ret);
+  }
+  if (measures->global) {
+    latest->flags |= GST_EBUR128_META_GLOBAL;
+    int ret = gst_ebur128_state_loudness_global(filter->state, &latest->global);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_global", ret);
+  }
+  if (measures->range) {
+    latest->flags |= GST_EBUR128_META_RANGE;
+    int ret = gst_ebur128_state_loudness_range(filter->state, &latest->range);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_range", ret);
+  }
+
+  latest->flags |= measures->sample_peak ? GST_EBUR128_META_SAMPLE_PEAK : 0;
+  latest->flags |= measures->true_peak ? GST_EBUR128_META_TRUE_PEAK : 0;
+  for (guint channel = 0; channel < MIN(latest->channels, GST_EBUR128_LATEST_MAX_CHANNELS); channel++) {
+    if (measures->sample_peak) {
+      int ret = gst_ebur128_state_sample_peak(filter->state, channel, &latest->sample_peak[channel]);
+      success &= gst_ebur128_validate_lib_return("ebur128_sample_peak", ret);
+    }
+    if (measures->true_peak) {
+      int ret = gst_ebur128_state_true_peak(filter->state, channel, &latest->true_peak[channel]);
+      success &= gst_ebur128_validate_lib_return("ebur128_true_peak", ret);
+    }
+  }
+
+  if (!success) {
+    GST_ERROR_OBJECT(filter, "error getting the requested calculation results for the latest Measurement");
+  }
+}
+
+// the history only answers windows up to the max-window applied to it, a longer one is not a number
+static gboolean gst_ebur128_loudness_window(GstEbur128 *filter, gulong window, gdouble *out) {
+  if (window > filter->state->max_window) {
+    *out = NAN;
+    return TRUE;
+  }
+
+  int ret = gst_ebur128_state_loudness_window(filter->state, window, out);
+  return gst_ebur128_validate_lib_return("ebur128_loudness_window", ret);
+}
+
+// window and windows in the order of the records
+static guint gst_ebur128_num_windows(GstEbur128 *filter) {
+  return (filter->measures.window > 0 ? 1 : 0) + filter->measures.windows->len;
+}
+
+/**
+ * Completes the latest values to the record of the interval, which the message, the meas_src pad, the shared-memory
+ * ring and the log are all served from. Only the windows and the peaks of channels beyond the latest values are
+ * queried, once per interval.
+ */
+static void gst_ebur128_take_record(GstEbur128 *filter, const GstEbur128Latest *latest, guint64 frames_processed) {
+  const GstEbur128Measures *measures = &filter->measures;
+  guint channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
+  guint num_windows = gst_ebur128_num_windows(filter);
+  gsize size = GST_EBUR128_MEASUREMENT_SIZE(channels, num_windows);
+
+  if (filter->record == NULL || filter->record->channels != channels || filter->record->num_windows != num_windows) {
+    g_free(filter->record);
+    filter->record = g_malloc(size);
+  }
+
+  GstEbur128MeasurementRecord *measurement = filter->record;
+  memset(measurement, 0, size);
+  measurement->version = GST_EBUR128_MEASUREMENT_VERSION;
+  measurement->flags = latest->flags;
+  measurement->channels = channels;
+  measurement->num_windows = num_windows;
+
+  gst_ebur128_message_times(filter, frames_processed, &measurement->timestamp, &measurement->running_time,
+                            &measurement->stream_time);
+  measurement->momentary = latest->momentary;
+  measurement->shortterm = latest->shortterm;
+  measurement->global = latest->global;
+  measurement->range = latest->range;
+
+  gboolean success = TRUE;
+  gdouble *windows = gst_ebur128_measurement_windows(measurement);
+  guint window_index = 0;
+  if (measures->window > 0) {
+    success &= gst_ebur128_loudness_window(filter, measures->window, &windows[window_index++]);
+  }
+  for (guint i = 0; i < measures->windows->len && window_index < num_windows; i++) {
+    gulong window = g_array_index(measures->windows, gulong, i);
+    success &= gst_ebur128_loudness_window(filter, window, &windows[window_index++]);
+  }
+
+  // the latest values only hold the peaks of the first channels
+  gdouble *sample_peak = gst_ebur128_measurement_sample_peak(measurement);
+  gdouble *true_peak = gst_ebur128_measurement_true_peak(measurement);
+  guint latest_channels = MIN(channels, GST_EBUR128_LATEST_MAX_CHANNELS);
+  memcpy(sample_peak, latest->sample_peak, latest_channels * sizeof(gdouble));
+  memcpy(true_peak, latest->true_peak, latest_channels * sizeof(gdouble));
+  for (guint channel = latest_channels; channel < channels; channel++) {
+    if (measures->sample_peak) {
+      int ret = gst_ebur128_state_sample_peak(filter->state, channel, &sample_peak[channel]);
+      success &= gst_ebur128_validate_lib_return("ebur128_sample_peak", ret);
+    }
+    if (measures->true_peak) {
+      int ret = gst_ebur128_state_true_peak(filter->state, channel, &true_peak[channel]);
+      success &= gst_ebur128_validate_lib_return("ebur128_true_peak", ret);
+    }
+  }
+
+  if (!success) {
+    GST_ERROR_OBJECT(filter, "error getting the requested calculation results for the Measurement");
+  }
+}
+
+/**
+ * Writes the record into the shared-memory ring, if shm-name is set. The ring is created for the first record and
+ * replaced by a new one whenever the name or the layout of the records changes.
+ */
+static void gst_ebur128_write_shm(GstEbur128 *filter) {
+  guint channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
+  guint num_windows = gst_ebur128_num_windows(filter);
+
+  GST_OBJECT_LOCK(filter);
+  gboolean current = filter->shm_writer != NULL &&
+                     gst_ebur128_shm_writer_matches(filter->shm_writer, filter->shm_name, channels, num_windows);
+  gchar *name = (!current && !filter->shm_failed) ? g_strdup(filter->shm_name) : NULL;
+  GST_OBJECT_UNLOCK(filter);
+
+  if (!current) {
+    g_clear_pointer(&filter->shm_writer, gst_ebur128_shm_writer_free);
+  }
+
+  if (name != NULL) {
+    GError *error = NULL;
+    filter->shm_writer = gst_ebur128_shm_writer_new(name, filter->shm_records, channels, num_windows, &error);
+    if (filter->shm_writer == NULL) {
+      GST_ELEMENT_WARNING(filter, RESOURCE, OPEN_WRITE, ("Could not create the Shared-Memory Ring %s", name),
+                          ("%s", error->message));
+      g_clear_error(&error);
+
+      // not retried for every record, only once the name is set again
+      GST_OBJECT_LOCK(filter);
+      filter->shm_failed = TRUE;
+      GST_OBJECT_UNLOCK(filter);
+    }
+    g_free(name);
+  }
+
+  if (filter->shm_writer != NULL) {
+    GstEbur128MeasurementRecord *record = gst_ebur128_shm_writer_begin(filter->shm_writer);
+    memcpy(record, filter->record, GST_EBUR128_MEASUREMENT_SIZE(channels, num_windows));
+    gst_ebur128_shm_writer_commit(filter->shm_writer);
+  }
+}
+
+/**
+ * Queues the record for the logger, if location is set. The logger is started for the first record and replaced
+ * whenever the location, the format or the layout of the records changes, which waits for the old one to finish
+ * writing.
+ */
+static void gst_ebur128_write_log(GstEbur128 *filter) {
+  guint channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
+  guint num_windows = gst_ebur128_num_windows(filter);
+
+  GST_OBJECT_LOCK(filter);
+  gboolean current = filter->logger != NULL && gst_ebur128_logger_matches(filter->logger, filter->location,
+                                                                          filter->log_format, channels, num_windows);
+  gchar *location = (!current && !filter->log_failed) ? g_strdup(filter->location) : NULL;
+  GST_OBJECT_UNLOCK(filter);
+
+  if (!current) {
+    g_clear_pointer(&filter->logger, gst_ebur128_logger_free);
+  }
+
+  if (location != NULL) {
+    gboolean append = g_strcmp0(location, filter->log_opened) == 0;
+    filter->logger = gst_ebur128_logger_new(location, append, filter->log_format, channels, num_windows,
+                                            LOG_QUEUE_SIZE, filter->log_fsync_interval);
+
+    g_free(filter->log_opened);
+    filter->log_opened = location;
+  }
+
+  if (filter->logger == NULL) {
+    return;
+  }
+
+  gchar *error = gst_ebur128_logger_take_error(filter->logger);
+  if (error != NULL) {
+    GST_ELEMENT_WARNING(filter, RESOURCE, WRITE, ("Could not write the Log to %s", filter->log_opened),
+                        ("%s", error));
+    g_free(error);
+    g_clear_pointer(&filter->logger, gst_ebur128_logger_free);
+
+    // not retried for every record, only once the location is set again
+    GST_OBJECT_LOCK(filter);
+    filter->log_failed = TRUE;
+    GST_OBJECT_UNLOCK(filter);
+    return;
+  }
+
+  if (!gst_ebur128_logger_push(filter->logger, filter->record, g_get_real_time() * 1000)) {
+    GST_WARNING_OBJECT(filter, "Log-Writer has fallen behind, dropping the row at %" GST_TIME_FORMAT,
+                       GST_TIME_ARGS(filter->record->timestamp));
+  }
+}
+
+// the requested meas_src pad, configured for the current records, or NULL
+static GstPad *gst_ebur128_measurement_pad(GstEbur128 *filter) {
+  GST_OBJECT_LOCK(filter);
+  GstPad *pad = filter->meas_srcpad ? gst_object_ref(filter->meas_srcpad) : NULL;
+  GST_OBJECT_UNLOCK(filter);
+
+  if (pad != NULL && !gst_ebur128_configure_measurement_pad(filter, pad, GST_AUDIO_INFO_CHANNELS(&filter->audio_info),
+                                                            gst_ebur128_num_windows(filter))) {
+    gst_clear_object(&pad);
+  }
+  return pad;
+}
+
+/**
+ * Queues the binary counterpart of the message for the meas_src pad, if it has been requested. Records are written
+ * straight into buffers of the pool, so nothing is allocated per interval.
+ */
+static void gst_ebur128_queue_measurement(GstEbur128 *filter) {
+  GstPad *pad = gst_ebur128_measurement_pad(filter);
+  if (pad == NULL) {
+    return;
+  }
+  gst_object_unref(pad);
+
+  GstBuffer *buffer = NULL;
+  if (gst_buffer_pool_acquire_buffer(filter->meas_pool, &buffer, NULL) != GST_FLOW_OK) {
+    GST_WARNING_OBJECT(filter, "no Buffer for the Measurement, skipping it");
+    return;
+  }
+
+  guint channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
+  guint num_windows = gst_ebur128_num_windows(filter);
+
+  GstMapInfo map;
+  gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+  memcpy(map.data, filter->record, GST_EBUR128_MEASUREMENT_SIZE(channels, num_windows));
+  GST_BUFFER_PTS(buffer) = filter->record->timestamp;
+  gst_buffer_unmap(buffer, &map);
+
+  g_queue_push_tail(&filter->meas_queue, buffer);
+}
+
+/**
+ * Queues a gap for the frames between from_frames and to_frames that did not complete a record, like sparse streams
+ * do, so a sink behind meas_src prerolls together with the audio-sink instead of waiting for the first interval.
+ */
+static void gst_ebur128_queue_measurement_gap(GstEbur128 *filter, guint64 from_frames, guint64 to_frames) {
+  GstPad *pad = gst_ebur128_measurement_pad(filter);
+  if (pad == NULL) {
+    return;
+  }
+  gst_object_unref(pad);
+
+  GstClockTime from, to, running_time, stream_time;
+  gst_ebur128_message_times(filter, from_frames, &from, &running_time, &stream_time);
+  gst_ebur128_message_times(filter, to_frames, &to, &running_time, &stream_time);
+  g_queue_push_tail(&filter->meas_queue, gst_event_new_gap(from, to - from));
+}
+
+/**
+ * Pushes what has been queued for meas_src. Called without the state-lock, so a meas_src branch that blocks, like a
+ * sink waiting for preroll, neither stalls the save-state and restore-state signals nor the audio it waits for.
+ */
+static void gst_ebur128_push_measurements(GstEbur128 *filter) {
+  g_rec_mutex_lock(&filter->state_lock);
+  GQueue queue = filter->meas_queue;
+  g_queue_init(&filter->meas_queue);
+  GstPad *pad = filter->meas_configured_pad ? gst_object_ref(filter->meas_configured_pad) : NULL;
+  g_rec_mutex_unlock(&filter->state_lock);
+
+  GstMiniObject *item;
+  while ((item = g_queue_pop_head(&queue)) != NULL) {
+    if (pad == NULL) {
+      gst_mini_object_unref(item);
+    } else if (GST_IS_EVENT(item)) {
+      gst_pad_push_event(pad, GST_EVENT_CAST(item));
+    } else {
+      GstFlowReturn ret = gst_pad_push(pad, GST_BUFFER_CAST(item));
+      if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED && ret != GST_FLOW_FLUSHING) {
+        GST_WARNING_OBJECT(filter, "pushing the Measurement failed: %s", gst_flow_get_name(ret));
+      }
+    }
+  }
+
+  if (pad != NULL) {
+    gst_object_unref(pad);
+  }
+}
+
+/**
+ * Properties are only applied between two buffers by the thread that analyzes them, so the state is never re-configured
+ * while frames are added, not even from a sync-handler of one of the messages posted on the way.
+ */
+static void gst_ebur128_apply_properties(GstEbur128 *filter) {
+  gst_ebur128_take_measures(filter);
+
+  guint interval_frames = GST_CLOCK_TIME_TO_FRAMES(filter->interval, GST_AUDIO_INFO_RATE(&filter->audio_info));
+  if (MAX(interval_frames, 1) != filter->interval_frames) {
+    gst_ebur128_recalc_interval_frames(filter);
+  }
+
+  gst_ebur128_reinit_libebur128_if_mode_changed(filter);
+  gst_ebur128_restore_pending_checkpoint(filter);
+
+  // only the meta carries the true-peak of a single buffer, messages report the one since the start
+  gst_ebur128_state_set_prev_true_peak_floor(filter->state, filter->attach_meta ? 0.0 : G_MAXDOUBLE);
+}
+
+static gboolean gst_ebur128_analyze(GstEbur128 *filter, GstBuffer *buf, const GstSegment *segment, gboolean discont) {
+  g_rec_mutex_lock(&filter->state_lock);
+  gst_ebur128_apply_properties(filter);
+
+  // Map and Analyze buffer, planar buffers are mapped plane by plane
+  GstAudioBuffer audio_buffer;
+  if (!gst_audio_buffer_map(&audio_buffer, &filter->audio_info, buf, GST_MAP_READ)) {
+    GST_ERROR_OBJECT(filter, "Could not map Buffer");
+    g_rec_mutex_unlock(&filter->state_lock);
+    return FALSE;
+  }
 
-  GstAudioFormat format = GST_AUDIO_INFO_FORMAT(&filter->audio_info);
   const gint bytes_per_frame = GST_AUDIO_INFO_BPF(&filter->audio_info);
-  gint num_frames = map_info.size / bytes_per_frame;
+  gint num_frames = audio_buffer.n_samples;
   const gint channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
 
-  // Manage Message-Timestamp
-  if (GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DISCONT)) {
-    filter->start_ts = GST_BUFFER_TIMESTAMP(buf);
-  }
-  if (G_UNLIKELY(!GST_CLOCK_TIME_IS_VALID(filter->start_ts))) {
+  // Manage Message-Timestamp, frames are counted from the start of the stream or the last discontinuity
+  gst_segment_copy_into(segment, &filter->segment);
+  if (discont || G_UNLIKELY(!GST_CLOCK_TIME_IS_VALID(filter->start_ts))) {
     filter->start_ts = GST_BUFFER_TIMESTAMP(buf);
+    filter->frames_processed = 0;
   }
 
   GST_DEBUG_OBJECT(filter,
                    "Got %s Buffer of %lu bytes representing %u frames of %u "
                    "bytes in %u channels.",
-                   GST_AUDIO_INFO_NAME(&filter->audio_info), map_info.size, num_frames, bytes_per_frame, channels);
+                   GST_AUDIO_INFO_NAME(&filter->audio_info), gst_buffer_get_size(buf), num_frames, bytes_per_frame,
+                   channels);
 
-  gboolean success = TRUE;
+  // analyzed in one pass, the state takes a snapshot and so posts a message every interval_frames on the way
+  gboolean success = gst_ebur128_add_frames(filter->state, &audio_buffer, 0, num_frames);
+  filter->frames_processed += num_frames;
+
+  // a buffer that completed no record advances meas_src by a gap
+  if (g_queue_is_empty(&filter->meas_queue)) {
+    gst_ebur128_queue_measurement_gap(filter, filter->frames_processed - num_frames, filter->frames_processed);
+  }
+
+  gst_audio_buffer_unmap(&audio_buffer);
+  g_rec_mutex_unlock(&filter->state_lock);
+
+  gst_ebur128_push_measurements(filter);
+  return success;
+}
+
+static gpointer gst_ebur128_analysis_thread(gpointer user_data) {
+  GstEbur128 *filter = GST_EBUR128(user_data);
+
+  GstEbur128AsyncItem item;
+  while (gst_ebur128_ring_pop(filter->ring, &item, TRUE)) {
+    // buffers queued before a flush must not feed the measurements after it
+    gboolean success = gst_ebur128_ring_is_flushing(filter->ring) ||
+                       gst_ebur128_analyze(filter, item.buffer, &item.segment, item.discont);
+
+    // reported by the streaming-thread with the next buffer
+    if (!success) {
+      g_atomic_int_set(&filter->async_error, TRUE);
+    }
+
+    gst_buffer_unref(item.buffer);
+    gst_ebur128_ring_done(filter->ring);
+  }
+
+  return NULL;
+}
 
-  guint8 *data_ptr = map_info.data;
-  while (num_frames > 0) {
-    const gint max_frames_to_process = filter->interval_frames - filter->frames_since_last_mesage;
+// started and stopped by the streaming-thread, which is the only one pushing into the ring. The pointer is only
+// changed with the object-lock held, under which a flush-start sets the ring flushing
+static void gst_ebur128_start_async(GstEbur128 *filter) {
+  GST_INFO_OBJECT(filter, "Starting Analysis-Thread with a Queue of %u Buffers", filter->async_queue_size);
+  GstEbur128Ring *ring = gst_ebur128_ring_new(filter->async_queue_size, sizeof(GstEbur128AsyncItem));
+  GST_OBJECT_LOCK(filter);
+  filter->ring = ring;
+  GST_OBJECT_UNLOCK(filter);
+  filter->analysis_thread = g_thread_new("ebur128-analysis", gst_ebur128_analysis_thread, filter);
+}
 
-    const gint frames_to_process = max_frames_to_process > num_frames ? num_frames : max_frames_to_process;
+// analyzes what is still queued before the thread exits
+static void gst_ebur128_stop_async(GstEbur128 *filter) {
+  if (filter->ring == NULL) {
+    return;
+  }
+
+  GST_INFO_OBJECT(filter, "Stopping Analysis-Thread");
+  gst_ebur128_ring_close(filter->ring);
+  g_thread_join(filter->analysis_thread);
+  filter->analysis_thread = NULL;
+
+  GST_OBJECT_LOCK(filter);
+  GstEbur128Ring *ring = g_steal_pointer(&filter->ring);
+  GST_OBJECT_UNLOCK(filter);
+  gst_ebur128_ring_free(ring);
+}
 
-    GST_INFO_OBJECT(filter,
-                    "Processing %d of %d Frames "
-                    "(Frames since last mesage: %d, interval_frames: %d)",
-                    frames_to_process, num_frames, filter->frames_since_last_mesage, filter->interval_frames);
+static void gst_ebur128_drain_async(GstEbur128 *filter) {
+  if (filter->ring != NULL) {
+    gst_ebur128_ring_drain(filter->ring);
+  }
+}
 
-    success &= gst_ebur128_add_frames(filter->state, format, data_ptr, frames_to_process);
+static void gst_ebur128_attach_meta(GstEbur128 *filter, GstBuffer *buf) {
+  // passthrough may only just have been switched off
+  if (!gst_buffer_is_writable(buf)) {
+    GST_DEBUG_OBJECT(filter, "Buffer is not writable, not attaching Meta");
+    return;
+  }
 
-    filter->frames_processed += frames_to_process;
+  const GstEbur128Measures *measures = &filter->measures;
+  GstEbur128MetaFlags flags = 0;
+  flags |= measures->momentary ? GST_EBUR128_META_MOMENTARY : 0;
+  flags |= measures->shortterm ? GST_EBUR128_META_SHORTTERM : 0;
+  flags |= measures->global ? GST_EBUR128_META_GLOBAL : 0;
+  flags |= measures->range ? GST_EBUR128_META_RANGE : 0;
+  flags |= measures->sample_peak ? GST_EBUR128_META_SAMPLE_PEAK : 0;
+  flags |= measures->true_peak ? GST_EBUR128_META_TRUE_PEAK : 0;
 
-    data_ptr += frames_to_process * bytes_per_frame;
-    num_frames -= frames_to_process;
-    filter->frames_since_last_mesage += frames_to_process;
+  gint channels = GST_AUDIO_INFO_CHANNELS(&filter->audio_info);
+  GstEbur128Meta *meta = gst_buffer_add_ebur128_meta(buf, flags, channels);
 
-    if (filter->frames_since_last_mesage >= filter->interval_frames) {
-      gst_ebur128_post_message(filter);
-      filter->frames_since_last_mesage = 0;
+  gboolean success = TRUE;
+  if (measures->momentary) {
+    int ret = gst_ebur128_state_loudness_momentary(filter->state, &meta->momentary);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_momentary", ret);
+  }
+  if (measures->shortterm) {
+    int ret = gst_ebur128_state_loudness_shortterm(filter->state, &meta->shortterm);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_shortterm", ret);
+  }
+  if (measures->global) {
+    int ret = gst_ebur128_state_loudness_global(filter->state, &meta->global);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_global", ret);
+  }
+  if (measures->range) {
+    int ret = gst_ebur128_state_loudness_range(filter->state, &meta->range);
+    success &= gst_ebur128_validate_lib_return("ebur128_loudness_range", ret);
+  }
+
+  // the buffer was added with a single call, so the prev-peaks are the ones of this buffer
+  for (gint channel = 0; channel < channels; channel++) {
+    if (measures->sample_peak) {
+      int ret = gst_ebur128_state_prev_sample_peak(filter->state, channel, &meta->sample_peak[channel]);
+      success &= gst_ebur128_validate_lib_return("ebur128_prev_sample_peak", ret);
+    }
+    if (measures->true_peak) {
+      int ret = gst_ebur128_state_prev_true_peak(filter->state, channel, &meta->true_peak[channel]);
+      success &= gst_ebur128_validate_lib_return("ebur128_prev_true_peak", ret);
     }
   }
 
-  gst_buffer_unmap(buf, &map_info);
+  if (!success) {
+    GST_ERROR_OBJECT(filter, "error getting the requested calculation results for the Meta");
+  }
+}
 
-  return success ? GST_FLOW_OK : GST_FLOW_ERROR;
-}
\ No newline at end of file
+static GstFlowReturn gst_ebur128_transform_ip(GstBaseTransform *trans, GstBuffer *buf) {
+  GstEbur128 *filter = GST_EBUR128(trans);
+  gboolean discont = GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DISCONT);
+
+  if (filter->async && filter->ring == NULL) {
+    gst_ebur128_start_async(filter);
+  } else if (!filter->async && filter->ring != NULL) {
+    gst_ebur128_stop_async(filter);
+  }
+
+  if (filter->ring == NULL) {
+    gboolean success = gst_ebur128_analyze(filter, buf, &trans->segment, discont);
+    if (success && filter->attach_meta) {
+      gst_ebur128_attach_meta(filter, buf);
+    }
+
+    return success ? GST_FLOW_OK : GST_FLOW_ERROR;
+  }
+
+  if (g_atomic_int_get(&filter->async_error)) {
+    GST_ERROR_OBJECT(filter, "Analysis-Thread failed to analyze a Buffer");
+    return GST_FLOW_ERROR;
+  }
+
+  // a dropped buffer leaves a gap in the analyzed frames, so the next one restarts the timestamps
+  GstEbur128AsyncItem item = {gst_buffer_ref(buf), trans->segment, discont || filter->async_dropped};
+  gboolean block = filter->async_overflow == GST_EBUR128_ASYNC_OVERFLOW_BLOCK;
+  if (gst_ebur128_ring_push(filter->ring, &item, block)) {
+    filter->async_dropped = FALSE;
+  } else if (gst_ebur128_ring_is_flushing(filter->ring)) {
+    GST_DEBUG_OBJECT(filter, "flushing, not queueing Buffer %" GST_PTR_FORMAT, buf);
+    gst_buffer_unref(item.buffer);
+    return GST_FLOW_FLUSHING;
+  } else {
+    GST_WARNING_OBJECT(filter, "Analysis-Thread has fallen behind, dropping Buffer %" GST_PTR_FORMAT, buf);
+    gst_buffer_unref(item.buffer);
+    filter->async_dropped = TRUE;
+  }
+
+  return GST_FLOW_OK;
+}
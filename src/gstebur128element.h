@@ -1,7 +1,11 @@
 #ifndef __GST_EBUR128_H__
 #define __GST_EBUR128_H__
 
-#include <ebur128.h>
+#include "gstebur128latest.h"
+#include "gstebur128logger.h"
+#include "gstebur128ring.h"
+#include "gstebur128shm.h"
+#include "gstebur128state.h"
 #include <gst/audio/audio.h>
 #include <gst/base/gstbasetransform.h>
 #include <gst/gst.h>
@@ -11,31 +15,118 @@ G_BEGIN_DECLS
 #define GST_TYPE_EBUR128 (gst_ebur128_get_type())
 G_DECLARE_FINAL_TYPE(GstEbur128, gst_ebur128, GST, EBUR128, GstBaseTransform)
 
+typedef enum {
+  /**
+   * the streaming-thread waits for the analysis-thread to make room
+   */
+  GST_EBUR128_ASYNC_OVERFLOW_BLOCK,
+
+  /**
+   * the buffer is passed on without being analyzed
+   */
+  GST_EBUR128_ASYNC_OVERFLOW_DROP
+} GstEbur128AsyncOverflow;
+
+// the measurements as of the last buffer-boundary, copied from the properties with the object-lock held, so every
+// value of a buffer is taken for the same measurements the state has been set up for
+typedef struct {
+  gboolean momentary;
+  gboolean shortterm;
+  gboolean global;
+  gulong integrated_horizon;
+  gulong window;
+  GArray *windows;
+  gboolean range;
+  gboolean sample_peak;
+  gboolean true_peak;
+} GstEbur128Measures;
+
 struct _GstEbur128 {
   GstBaseTransform base_transform;
 
   GstPad *sinkpad, *srcpad;
 
   gboolean post_messages;
+  gdouble post_threshold;
+  GstClockTime post_max_silence;
+  guint post_batch;
+  gboolean packed_peaks;
+
+  // measurement of the current interval, taken once for the message and all records, the last posted one the
+  // post-threshold compares to, and the pending 'loudness-batch' array
+  GstEbur128MeasurementRecord *record;
+  GstEbur128MeasurementRecord *posted;
+  guint64 posted_frames;
+  GValue batch;
 
   GstClockTime interval;
   guint interval_frames;
-  guint frames_since_last_mesage;
 
   GstClockTime start_ts;
   guint64 frames_processed;
 
+  // requested measurements, guarded by the object-lock, and the ones applied at the last buffer-boundary
   gboolean momentary;
   gboolean shortterm;
   gboolean global;
+  gulong integrated_horizon;
   gulong window;
+  GArray *windows;
   gboolean range;
   gboolean sample_peak;
   gboolean true_peak;
+  GstEbur128Measures measures;
   gulong max_history;
+  GstEbur128GatingEngine gating_engine;
+  gulong analysis_rate;
+
+  gboolean async;
+  guint async_queue_size;
+  GstEbur128AsyncOverflow async_overflow;
+  gboolean attach_meta;
+
+  // buffers queued for the analysis-thread, both only exist while async analysis is running. ring is only changed
+  // with the object-lock held, so a flush-start can reach it from outside the streaming-thread
+  GstEbur128Ring *ring;
+  GThread *analysis_thread;
+  gboolean async_dropped;
+  gint async_error;
+
+  // requested meas_src pad, guarded by the object-lock, and the one that has been configured by the analyzing thread
+  GstPad *meas_srcpad;
+  GstPad *meas_configured_pad;
+  GstBufferPool *meas_pool;
+  gsize meas_size;
+  GstSegment meas_segment;
+
+  // records and gaps for meas_src, queued with the state-lock held and pushed once it has been released
+  GQueue meas_queue;
+
+  // shared-memory ring of records, shm-name is guarded by the object-lock
+  gchar *shm_name;
+  guint shm_records;
+  gboolean shm_failed;
+  GstEbur128ShmWriter *shm_writer;
+
+  // log of the records, location is guarded by the object-lock
+  gchar *location;
+  GstEbur128LogFormat log_format;
+  GstClockTime log_fsync_interval;
+  gboolean log_failed;
+  GstEbur128Logger *logger;
+  gchar *log_opened;
+
+  // measurements of the last interval, for the get-latest signal
+  GstEbur128LatestCell latest;
+
+  // state is only replaced with the state-lock held, which the analyzing thread holds while it adds frames, so
+  // save-state sees it between two buffers; a checkpoint handed to restore-state is guarded by the object-lock
+  GRecMutex state_lock;
+  GBytes *pending_checkpoint;
 
-  ebur128_state *state;
+  GstEbur128State *state;
   GstAudioInfo audio_info;
+  GstSegment segment;
 };
 
 G_END_DECLS
@@ -0,0 +1,23 @@
+#ifndef __GST_EBUR128FENCE_H__
+#define __GST_EBUR128FENCE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Full memory barrier for the seqlocks, whose copies of the protected values are plain memory accesses that the
+ * g_atomic accesses to their sequence do not order.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define gst_ebur128_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+static inline void gst_ebur128_fence(void) {
+  static gint dummy;
+  g_atomic_int_inc(&dummy);
+}
+#endif
+
+G_END_DECLS
+
+#endif // __GST_EBUR128FENCE_H__
@@ -0,0 +1,457 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128gating.h"
+#include <math.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 1024
+
+// bins of the histogram-engine, from the absolute gate at -70 LUFS up to +10 LUFS
+#define HISTOGRAM_MIN_LOUDNESS -70.0
+#define HISTOGRAM_BIN_WIDTH 0.01
+#define HISTOGRAM_BINS 8000
+
+typedef struct _GstEbur128GatingNode GstEbur128GatingNode;
+struct _GstEbur128GatingNode {
+  gdouble energy;
+
+  // aggregates over the subtree rooted in this node
+  gdouble sum;
+  guint32 size;
+
+  guint32 left;
+  guint32 right;
+  guint32 priority;
+};
+
+struct _GstEbur128Gating {
+  GstEbur128GatingEngine engine;
+
+  // block-count and energy-sum of every bin and of all of them, only with the histogram-engine
+  guint64 *bin_counts;
+  gdouble *bin_sums;
+  guint64 histogram_count;
+  gdouble histogram_sum;
+
+  // nodes[0] is the empty tree, the block inserted as number i lives in nodes[i % capacity + 1]
+  GstEbur128GatingNode *nodes;
+  guint32 capacity;
+  guint64 max_blocks;
+
+  guint64 inserted;
+  guint32 root;
+  guint32 random;
+};
+
+static guint32 gst_ebur128_gating_next_priority(GstEbur128Gating *gating) {
+  // xorshift32, only needs to be good enough to keep the treap balanced
+  guint32 x = gating->random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return gating->random = x;
+}
+
+// total order over the nodes, equal energies are ordered by their slot
+static gboolean gst_ebur128_gating_less(GstEbur128Gating *gating, guint32 a, guint32 b) {
+  gdouble energy_a = gating->nodes[a].energy;
+  gdouble energy_b = gating->nodes[b].energy;
+  return energy_a < energy_b || (energy_a == energy_b && a < b);
+}
+
+static void gst_ebur128_gating_update(GstEbur128Gating *gating, guint32 t) {
+  GstEbur128GatingNode *node = &gating->nodes[t];
+  GstEbur128GatingNode *left = &gating->nodes[node->left];
+  GstEbur128GatingNode *right = &gating->nodes[node->right];
+
+  node->size = 1 + left->size + right->size;
+  node->sum = left->sum + node->energy + right->sum;
+}
+
+// splits t into nodes ordered before x and nodes ordered at or after x
+static void gst_ebur128_gating_split(GstEbur128Gating *gating, guint32 t, guint32 x, guint32 *l, guint32 *r) {
+  if (t == 0) {
+    *l = *r = 0;
+    return;
+  }
+
+  if (gst_ebur128_gating_less(gating, t, x)) {
+    gst_ebur128_gating_split(gating, gating->nodes[t].right, x, &gating->nodes[t].right, r);
+    *l = t;
+  } else {
+    gst_ebur128_gating_split(gating, gating->nodes[t].left, x, l, &gating->nodes[t].left);
+    *r = t;
+  }
+
+  gst_ebur128_gating_update(gating, t);
+}
+
+// merges two trees where all nodes of a are ordered before all nodes of b
+static guint32 gst_ebur128_gating_merge(GstEbur128Gating *gating, guint32 a, guint32 b) {
+  if (a == 0) {
+    return b;
+  } else if (b == 0) {
+    return a;
+  }
+
+  if (gating->nodes[a].priority > gating->nodes[b].priority) {
+    gating->nodes[a].right = gst_ebur128_gating_merge(gating, gating->nodes[a].right, b);
+    gst_ebur128_gating_update(gating, a);
+    return a;
+  } else {
+    gating->nodes[b].left = gst_ebur128_gating_merge(gating, a, gating->nodes[b].left);
+    gst_ebur128_gating_update(gating, b);
+    return b;
+  }
+}
+
+static guint32 gst_ebur128_gating_remove_min(GstEbur128Gating *gating, guint32 t) {
+  if (gating->nodes[t].left == 0) {
+    return gating->nodes[t].right;
+  }
+
+  gating->nodes[t].left = gst_ebur128_gating_remove_min(gating, gating->nodes[t].left);
+  gst_ebur128_gating_update(gating, t);
+  return t;
+}
+
+static void gst_ebur128_gating_insert_node(GstEbur128Gating *gating, guint32 x) {
+  guint32 l, r;
+  gst_ebur128_gating_split(gating, gating->root, x, &l, &r);
+  gating->root = gst_ebur128_gating_merge(gating, gst_ebur128_gating_merge(gating, l, x), r);
+}
+
+static void gst_ebur128_gating_remove_node(GstEbur128Gating *gating, guint32 x) {
+  guint32 l, r;
+  gst_ebur128_gating_split(gating, gating->root, x, &l, &r);
+  gating->root = gst_ebur128_gating_merge(gating, l, gst_ebur128_gating_remove_min(gating, r));
+}
+
+static void gst_ebur128_gating_allocate(GstEbur128Gating *gating, guint32 capacity) {
+  gating->nodes = g_renew(GstEbur128GatingNode, gating->nodes, (gsize)capacity + 1);
+  gating->capacity = capacity;
+}
+
+GstEbur128Gating *gst_ebur128_gating_new(guint64 max_blocks) {
+  GstEbur128Gating *gating = g_new0(GstEbur128Gating, 1);
+  gating->max_blocks = max_blocks;
+  gst_ebur128_gating_clear(gating);
+  return gating;
+}
+
+GstEbur128Gating *gst_ebur128_gating_new_histogram(void) {
+  GstEbur128Gating *gating = g_new0(GstEbur128Gating, 1);
+  gating->engine = GST_EBUR128_GATING_ENGINE_HISTOGRAM;
+  gating->bin_counts = g_new0(guint64, HISTOGRAM_BINS);
+  gating->bin_sums = g_new0(gdouble, HISTOGRAM_BINS);
+  return gating;
+}
+
+void gst_ebur128_gating_free(GstEbur128Gating *gating) {
+  g_free(gating->bin_counts);
+  g_free(gating->bin_sums);
+  g_free(gating->nodes);
+  g_free(gating);
+}
+
+void gst_ebur128_gating_clear(GstEbur128Gating *gating) {
+  if (gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    memset(gating->bin_counts, 0, HISTOGRAM_BINS * sizeof(guint64));
+    memset(gating->bin_sums, 0, HISTOGRAM_BINS * sizeof(gdouble));
+    gating->histogram_count = 0;
+    gating->histogram_sum = 0.0;
+    return;
+  }
+
+  guint32 capacity = INITIAL_CAPACITY;
+  if (gating->max_blocks > 0) {
+    capacity = MIN(capacity, gating->max_blocks);
+  }
+  gst_ebur128_gating_allocate(gating, capacity);
+
+  memset(&gating->nodes[0], 0, sizeof(GstEbur128GatingNode));
+  gating->inserted = 0;
+  gating->root = 0;
+  gating->random = 0x9e3779b9;
+}
+
+/**
+ * libebur128 trims its block-list when the history shrinks, so keep the newest blocks that fit into the new limit.
+ */
+void gst_ebur128_gating_set_max_blocks(GstEbur128Gating *gating, guint64 max_blocks) {
+  if (gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM || max_blocks == gating->max_blocks) {
+    return;
+  }
+
+  guint64 count = gst_ebur128_gating_get_count(gating);
+  guint64 keep = max_blocks > 0 ? MIN(count, max_blocks) : count;
+  gdouble *energies = g_new(gdouble, keep + 1);
+  for (guint64 i = 0; i < keep; i++) {
+    guint64 insertion = gating->inserted - keep + i;
+    energies[i] = gating->nodes[insertion % gating->capacity + 1].energy;
+  }
+
+  gating->max_blocks = max_blocks;
+  gst_ebur128_gating_clear(gating);
+  for (guint64 i = 0; i < keep; i++) {
+    gst_ebur128_gating_add(gating, energies[i]);
+  }
+
+  g_free(energies);
+}
+
+GstEbur128GatingEngine gst_ebur128_gating_get_engine(GstEbur128Gating *gating) { return gating->engine; }
+
+// same offset as the loudness of a gating-block, so the bins are aligned to LUFS
+static gint gst_ebur128_gating_bin(gdouble energy) {
+  gdouble loudness = 10.0 * log10(energy) - 0.691;
+  gdouble bin = floor((loudness - HISTOGRAM_MIN_LOUDNESS) / HISTOGRAM_BIN_WIDTH);
+  return (gint)CLAMP(bin, -1.0, (gdouble)HISTOGRAM_BINS - 1);
+}
+
+void gst_ebur128_gating_add(GstEbur128Gating *gating, gdouble energy) {
+  if (gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    // only blocks above the absolute gate are added, rounding at its edge still belongs to the first bin
+    gint bin = MAX(gst_ebur128_gating_bin(energy), 0);
+    gating->bin_counts[bin]++;
+    gating->bin_sums[bin] += energy;
+    gating->histogram_count++;
+    gating->histogram_sum += energy;
+    return;
+  }
+
+  guint64 count = gst_ebur128_gating_get_count(gating);
+
+  if (count == gating->capacity) {
+    if (gating->max_blocks > 0 && count == gating->max_blocks) {
+      // history is full, the slot of the new block holds the oldest one
+      gst_ebur128_gating_remove_node(gating, gating->inserted % gating->capacity + 1);
+    } else {
+      // nothing has been evicted yet, so growing keeps every block in its slot
+      guint64 capacity = (guint64)gating->capacity * 2;
+      if (gating->max_blocks > 0) {
+        capacity = MIN(capacity, gating->max_blocks);
+      }
+      gst_ebur128_gating_allocate(gating, MIN(capacity, G_MAXUINT32 - 1));
+    }
+  }
+
+  guint32 x = gating->inserted % gating->capacity + 1;
+  GstEbur128GatingNode *node = &gating->nodes[x];
+  node->energy = energy;
+  node->sum = energy;
+  node->size = 1;
+  node->left = node->right = 0;
+  node->priority = gst_ebur128_gating_next_priority(gating);
+
+  gst_ebur128_gating_insert_node(gating, x);
+  gating->inserted++;
+}
+
+/**
+ * Removes the blocks of other, which have all been added to gating as well, in O(bins). Empty bins are reset to 0, so
+ * rounding errors of the energy-sums do not pile up over many periods.
+ */
+void gst_ebur128_gating_subtract(GstEbur128Gating *gating, GstEbur128Gating *other) {
+  g_return_if_fail(gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM);
+  g_return_if_fail(other->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM);
+
+  if (other->histogram_count == 0) {
+    return;
+  }
+
+  for (guint bin = 0; bin < HISTOGRAM_BINS; bin++) {
+    if (other->bin_counts[bin] == 0) {
+      continue;
+    }
+
+    gating->bin_counts[bin] -= other->bin_counts[bin];
+    gating->bin_sums[bin] = gating->bin_counts[bin] > 0 ? gating->bin_sums[bin] - other->bin_sums[bin] : 0.0;
+  }
+
+  gating->histogram_count -= other->histogram_count;
+  gating->histogram_sum = gating->histogram_count > 0 ? gating->histogram_sum - other->histogram_sum : 0.0;
+}
+
+/**
+ * Adds the blocks of other to gating. Blocks kept exactly are added one by one in insertion order, so they can be added
+ * to either engine and a limited history keeps the newest of them. Bins can only be added to a histogram.
+ */
+gboolean gst_ebur128_gating_add_all(GstEbur128Gating *gating, GstEbur128Gating *other) {
+  if (other->engine == GST_EBUR128_GATING_ENGINE_EXACT) {
+    guint64 count = gst_ebur128_gating_get_count(other);
+    for (guint64 i = 0; i < count; i++) {
+      guint64 insertion = other->inserted - count + i;
+      gst_ebur128_gating_add(gating, other->nodes[insertion % other->capacity + 1].energy);
+    }
+    return TRUE;
+  }
+
+  if (gating->engine != GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    return FALSE;
+  }
+
+  for (guint bin = 0; bin < HISTOGRAM_BINS; bin++) {
+    gating->bin_counts[bin] += other->bin_counts[bin];
+    gating->bin_sums[bin] += other->bin_sums[bin];
+  }
+  gating->histogram_count += other->histogram_count;
+  gating->histogram_sum += other->histogram_sum;
+  return TRUE;
+}
+
+guint64 gst_ebur128_gating_get_count(GstEbur128Gating *gating) {
+  if (gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    return gating->histogram_count;
+  }
+  return gating->nodes[gating->root].size;
+}
+
+gdouble gst_ebur128_gating_get_sum(GstEbur128Gating *gating) {
+  if (gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    return gating->histogram_sum;
+  }
+  return gating->nodes[gating->root].sum;
+}
+
+// every bin above the one of the threshold, and that one if the mean of its blocks is not below the threshold
+static void gst_ebur128_gating_histogram_sum_above(GstEbur128Gating *gating, gdouble threshold, guint64 *count,
+                                                   gdouble *sum) {
+  gint first = gst_ebur128_gating_bin(threshold);
+  if (first >= 0 && gating->bin_counts[first] > 0 &&
+      gating->bin_sums[first] / (gdouble)gating->bin_counts[first] < threshold) {
+    first++;
+  }
+
+  for (gint bin = MAX(first, 0); bin < HISTOGRAM_BINS; bin++) {
+    *count += gating->bin_counts[bin];
+    *sum += gating->bin_sums[bin];
+  }
+}
+
+void gst_ebur128_gating_sum_above(GstEbur128Gating *gating, gdouble threshold, guint64 *count, gdouble *sum) {
+  *count = 0;
+  *sum = 0.0;
+
+  if (gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    gst_ebur128_gating_histogram_sum_above(gating, threshold, count, sum);
+    return;
+  }
+
+  guint32 t = gating->root;
+  while (t != 0) {
+    GstEbur128GatingNode *node = &gating->nodes[t];
+    if (node->energy >= threshold) {
+      *count += 1 + gating->nodes[node->right].size;
+      *sum += node->energy + gating->nodes[node->right].sum;
+      t = node->left;
+    } else {
+      t = node->right;
+    }
+  }
+}
+
+gdouble gst_ebur128_gating_nth(GstEbur128Gating *gating, guint64 index) {
+  if (gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    for (guint bin = 0; bin < HISTOGRAM_BINS; bin++) {
+      if (index < gating->bin_counts[bin]) {
+        return gating->bin_sums[bin] / (gdouble)gating->bin_counts[bin];
+      }
+      index -= gating->bin_counts[bin];
+    }
+    return 0.0;
+  }
+
+  guint32 t = gating->root;
+  while (t != 0) {
+    GstEbur128GatingNode *node = &gating->nodes[t];
+    guint32 left_size = gating->nodes[node->left].size;
+    if (index < left_size) {
+      t = node->left;
+    } else if (index == left_size) {
+      return node->energy;
+    } else {
+      index -= left_size + 1;
+      t = node->right;
+    }
+  }
+
+  return 0.0;
+}
+
+/**
+ * Writes the engine and the block-count (u32, u64), followed by the energy of every block in insertion order (double)
+ * or, with the histogram-engine, the number of used bins (u32) and index, block-count and energy-sum of each of them
+ * (u32, u64, double).
+ */
+void gst_ebur128_gating_save(GstEbur128Gating *gating, GByteArray *bytes) {
+  guint64 count = gst_ebur128_gating_get_count(gating);
+  gst_ebur128_checkpoint_put_u32(bytes, gating->engine);
+  gst_ebur128_checkpoint_put_u64(bytes, count);
+
+  if (gating->engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    guint32 used = 0;
+    for (guint bin = 0; bin < HISTOGRAM_BINS; bin++) {
+      used += gating->bin_counts[bin] > 0;
+    }
+
+    gst_ebur128_checkpoint_put_u32(bytes, used);
+    for (guint bin = 0; bin < HISTOGRAM_BINS; bin++) {
+      if (gating->bin_counts[bin] > 0) {
+        gst_ebur128_checkpoint_put_u32(bytes, bin);
+        gst_ebur128_checkpoint_put_u64(bytes, gating->bin_counts[bin]);
+        gst_ebur128_checkpoint_put_double(bytes, gating->bin_sums[bin]);
+      }
+    }
+    return;
+  }
+
+  for (guint64 i = 0; i < count; i++) {
+    guint64 insertion = gating->inserted - count + i;
+    gst_ebur128_checkpoint_put_double(bytes, gating->nodes[insertion % gating->capacity + 1].energy);
+  }
+}
+
+/**
+ * Replaces the blocks of gating with the saved ones. Blocks saved by the exact engine are added one by one, so they can
+ * be loaded into either engine and a limited history keeps the newest of them. Bins can only be loaded into a
+ * histogram, as the blocks they summed are gone.
+ */
+gboolean gst_ebur128_gating_load(GstEbur128Gating *gating, GstEbur128CheckpointReader *reader) {
+  GstEbur128GatingEngine engine = gst_ebur128_checkpoint_get_u32(reader);
+  guint64 count = gst_ebur128_checkpoint_get_u64(reader);
+  gst_ebur128_gating_clear(gating);
+
+  if (engine == GST_EBUR128_GATING_ENGINE_EXACT) {
+    // a corrupt count must not run past the data
+    if (count > gst_ebur128_checkpoint_reader_remaining(reader) / sizeof(gdouble)) {
+      return FALSE;
+    }
+    for (guint64 i = 0; i < count; i++) {
+      gst_ebur128_gating_add(gating, gst_ebur128_checkpoint_get_double(reader));
+    }
+    return !reader->truncated;
+  }
+
+  if (engine != GST_EBUR128_GATING_ENGINE_HISTOGRAM || gating->engine != GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    return FALSE;
+  }
+
+  guint32 used = gst_ebur128_checkpoint_get_u32(reader);
+  for (guint32 i = 0; i < used && !reader->truncated; i++) {
+    guint32 bin = gst_ebur128_checkpoint_get_u32(reader);
+    guint64 bin_count = gst_ebur128_checkpoint_get_u64(reader);
+    gdouble bin_sum = gst_ebur128_checkpoint_get_double(reader);
+    if (bin >= HISTOGRAM_BINS) {
+      return FALSE;
+    }
+
+    gating->bin_counts[bin] += bin_count;
+    gating->bin_sums[bin] += bin_sum;
+    gating->histogram_count += bin_count;
+    gating->histogram_sum += bin_sum;
+  }
+  return !reader->truncated && gating->histogram_count == count;
+}
@@ -0,0 +1,63 @@
+#ifndef __GST_EBUR128GATING_H__
+#define __GST_EBUR128GATING_H__
+
+#include "gstebur128checkpoint.h"
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  /**
+   * every block is kept, the results are those of libebur128
+   */
+  GST_EBUR128_GATING_ENGINE_EXACT,
+
+  /**
+   * blocks are counted in 0.01 LU bins, memory is constant
+   */
+  GST_EBUR128_GATING_ENGINE_HISTOGRAM
+} GstEbur128GatingEngine;
+
+/**
+ * Ordered multiset of gating-block energies.
+ *
+ * Blocks are kept in a treap that is augmented with the size and the energy-sum of each subtree, so the relative gate
+ * of the integrated loudness (sum and count of all blocks above a threshold) and percentile lookups are answered in
+ * O(log n) without re-walking or sorting the history. Nodes live in a ring in insertion order, so a limited history
+ * evicts its oldest block in O(log n) as well and memory is bounded by the configured number of blocks.
+ *
+ * The results are exact, not approximated by bins.
+ *
+ * A set created with gst_ebur128_gating_new_histogram only counts the blocks and sums their energy in bins of 0.01 LU
+ * from -70 to +10 LUFS, louder blocks share the last bin. It takes 125 KiB however long the stream runs, queries walk
+ * the bins in O(bins) and a limit on the blocks is ignored, every block counts. As the energy of every bin is summed
+ * exactly, only the bin the relative gate falls into is approximated: its blocks are all counted when their mean is
+ * above the gate and all dropped otherwise, where libebur128 would split them. The integrated loudness only differs by
+ * the blocks within 0.01 LU of the gate. Blocks looked up by rank return the mean of their bin, so the loudness-range
+ * is within 0.02 LU of the exact one.
+ */
+typedef struct _GstEbur128Gating GstEbur128Gating;
+
+GstEbur128Gating *gst_ebur128_gating_new(guint64 max_blocks);
+GstEbur128Gating *gst_ebur128_gating_new_histogram(void);
+void gst_ebur128_gating_free(GstEbur128Gating *gating);
+void gst_ebur128_gating_clear(GstEbur128Gating *gating);
+GstEbur128GatingEngine gst_ebur128_gating_get_engine(GstEbur128Gating *gating);
+
+void gst_ebur128_gating_set_max_blocks(GstEbur128Gating *gating, guint64 max_blocks);
+
+void gst_ebur128_gating_add(GstEbur128Gating *gating, gdouble energy);
+gboolean gst_ebur128_gating_add_all(GstEbur128Gating *gating, GstEbur128Gating *other);
+void gst_ebur128_gating_subtract(GstEbur128Gating *gating, GstEbur128Gating *other);
+
+guint64 gst_ebur128_gating_get_count(GstEbur128Gating *gating);
+gdouble gst_ebur128_gating_get_sum(GstEbur128Gating *gating);
+void gst_ebur128_gating_sum_above(GstEbur128Gating *gating, gdouble threshold, guint64 *count, gdouble *sum);
+gdouble gst_ebur128_gating_nth(GstEbur128Gating *gating, guint64 index);
+
+void gst_ebur128_gating_save(GstEbur128Gating *gating, GByteArray *bytes);
+gboolean gst_ebur128_gating_load(GstEbur128Gating *gating, GstEbur128CheckpointReader *reader);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128GATING_H__
@@ -25,14 +25,18 @@
 
 #include "gstebur128graphelement.h"
 #include "gstebur128graphrender.h"
+#include "gstebur128meta.h"
 #include "gstebur128shared.h"
 #include <math.h>
+#include <string.h>
 
 GST_DEBUG_CATEGORY_STATIC(gst_ebur128graph_debug);
 #define GST_CAT_DEFAULT gst_ebur128graph_debug
 
 /* Filter signals and args */
-enum { LAST_SIGNAL };
+enum { SIGNAL_GET_LATEST, LAST_SIGNAL };
+
+static guint gst_ebur128graph_signals[LAST_SIGNAL] = {0};
 
 enum {
   PROP_0,
@@ -68,7 +72,9 @@ enum {
   PROP_PEAK_GAUGE,
 
   PROP_PEAK_GAUGE_LOWER_LIMIT,
-  PROP_PEAK_GAUGE_UPPER_LIMIT
+  PROP_PEAK_GAUGE_UPPER_LIMIT,
+
+  PROP_GATING_ENGINE
 };
 
 #define DEFAULT_COLOR_BACKGROUND 0xFF333333
@@ -104,6 +110,11 @@ enum {
 #define DEFAULT_PEAK_GAUGE_LOWER_LIMIT -20.0
 #define DEFAULT_PEAK_GAUGE_UPPER_LIMIT -2.0
 
+// the peak-gauge draws no bar at all below -60 dBTP
+#define PEAK_GAUGE_FLOOR 0.001
+
+#define DEFAULT_GATING_ENGINE GST_EBUR128_GATING_ENGINE_EXACT
+
 #define GST_TYPE_EBUR128GRAPH_SCALE_MODE (gst_ebur128graph_scale_mode_get_type())
 static GType gst_ebur128graph_scale_mode_get_type(void) {
   static GType ebur128graph_scale_mode = 0;
@@ -129,16 +140,19 @@ static GType gst_ebur128graph_measurement_get_type(void) {
 }
 
 #define SUPPORTED_AUDIO_FORMATS                                                                                        \
-  "{ " GST_AUDIO_NE(S16) ", " GST_AUDIO_NE(S32) "," GST_AUDIO_NE(F32) ", " GST_AUDIO_NE(F64) " }"
+  "{ " GST_AUDIO_NE(S16) ", " GST_AUDIO_NE(S32) "," GST_AUDIO_NE(F32) ", " GST_AUDIO_NE(F64) ", "                      \
+  GST_AUDIO_NE(S24) ", " GST_AUDIO_NE(S24_32) ", U8, "                                                                 \
+  GST_AUDIO_OE(S16) ", " GST_AUDIO_OE(S32) ", " GST_AUDIO_OE(F32) ", " GST_AUDIO_OE(F64) ", "                          \
+  GST_AUDIO_OE(S24) ", " GST_AUDIO_OE(S24_32) " }"
 
-#define SUPPORTED_AUDIO_CHANNELS "(int) {1, 2, 5 }"
+#define SUPPORTED_AUDIO_CHANNELS "(int) [ 1, MAX ]"
 
 #define SUPPORTED_AUDIO_CAPS_STRING                                                                                    \
   "audio/x-raw, "                                                                                                      \
   "format = (string) " SUPPORTED_AUDIO_FORMATS ", "                                                                    \
   "rate = " GST_AUDIO_RATE_RANGE ", "                                                                                  \
   "channels = " SUPPORTED_AUDIO_CHANNELS ", "                                                                          \
-  "layout = (string) interleaved "
+  "layout = (string) { interleaved, non-interleaved } "
 
 #define SUPPORTED_VIDEO_CAPS_STRING GST_VIDEO_CAPS_MAKE("{ BGRx, BGRA }")
 #define PREFERRED_VIDEO_WIDTH 720
@@ -158,10 +172,13 @@ G_DEFINE_TYPE(GstEbur128Graph, gst_ebur128graph, GST_TYPE_BASE_TRANSFORM);
 /* forward declarations */
 static void gst_ebur128graph_init_libebur128(GstEbur128Graph *graph);
 static void gst_ebur128graph_destroy_libebur128(GstEbur128Graph *graph);
+static void gst_ebur128graph_reinit_libebur128(GstEbur128Graph *graph);
 static void gst_ebur128graph_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec);
 static void gst_ebur128graph_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
 static void gst_ebur128graph_finalize(GObject *object);
 static gboolean gst_ebur128graph_take_measurement(GstEbur128Graph *graph);
+static void gst_ebur128graph_publish_latest(GstEbur128Graph *graph);
+static gboolean gst_ebur128graph_get_latest(GstEbur128Graph *graph, gpointer latest);
 
 static gboolean gst_ebur128graph_setup(GstEbur128Graph *graph);
 static void gst_ebur128graph_destroy_cairo(GstEbur128Graph *graph);
@@ -173,6 +190,7 @@ static GstCaps *gst_ebur128graph_transform_caps(GstBaseTransform *trans, GstPadD
 static GstCaps *gst_ebur128graph_fixate_caps(GstBaseTransform *trans, GstPadDirection direction, GstCaps *caps,
                                              GstCaps *othercaps);
 static GstFlowReturn gst_ebur128graph_dummy_transform(GstBaseTransform *trans, GstBuffer *inbuf, GstBuffer *outbuf);
+static gboolean gst_ebur128graph_start(GstBaseTransform *trans);
 static gboolean gst_ebur128graph_set_caps(GstBaseTransform *trans, GstCaps *incaps, GstCaps *outcaps);
 static gboolean gst_ebur128graph_transform_size(GstBaseTransform *trans, GstPadDirection direction, GstCaps *caps,
                                                 gsize size, GstCaps *othercaps, gsize *othersize);
@@ -199,6 +217,7 @@ static void gst_ebur128graph_class_init(GstEbur128GraphClass *klass) {
   transform_class->transform = GST_DEBUG_FUNCPTR(
       gst_ebur128graph_dummy_transform); // required to force base_transform out of passthrough mode, though it is never
                                          // actually called because we implement out orn generate_output vmethod
+  transform_class->start = GST_DEBUG_FUNCPTR(gst_ebur128graph_start);
   transform_class->set_caps = GST_DEBUG_FUNCPTR(gst_ebur128graph_set_caps);
   transform_class->transform_size = GST_DEBUG_FUNCPTR(gst_ebur128graph_transform_size);
   transform_class->generate_output = GST_DEBUG_FUNCPTR(gst_ebur128graph_generate_output);
@@ -341,8 +360,10 @@ static void gst_ebur128graph_class_init(GstEbur128GraphClass *klass) {
 
   g_object_class_install_property(
       gobject_class, PROP_PEAK_GAUGE,
-      g_param_spec_boolean("peak-gauge", "True-Peak Gauge", "Enable True-Peak Gauge", DEFAULT_PEAK_GAUGE,
-                           G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+      g_param_spec_boolean("peak-gauge", "True-Peak Gauge",
+                           "Enable True-Peak Gauge. Without it only the True-Peak since the start is measured "
+                           "exactly, and quiet passages that can not raise it skip the oversampler.",
+                           DEFAULT_PEAK_GAUGE, G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property(
       gobject_class, PROP_PEAK_GAUGE_LOWER_LIMIT,
@@ -358,6 +379,26 @@ static void gst_ebur128graph_class_init(GstEbur128GraphClass *klass) {
                           /* MIN */ -60.0, /* MAX */ -0.0, DEFAULT_PEAK_GAUGE_UPPER_LIMIT,
                           G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(
+      gobject_class, PROP_GATING_ENGINE,
+      g_param_spec_enum("gating-engine", "Gating Engine",
+                        "How the History for Global Loudness and Loudness Range is kept, see the ebur128 Element. "
+                        "Changing it from exact to histogram carries both over, the other way round restarts them.",
+                        GST_TYPE_EBUR128_GATING_ENGINE, DEFAULT_GATING_ENGINE,
+                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstEbur128Graph::get-latest:
+   * @latest: (type gpointer): GstEbur128Latest to copy the values into
+   *
+   * Copies the Measurements the last Video-Frame is based on, without waiting for the streaming-thread. Returns FALSE
+   * as long as no Measurement has been taken. See gstebur128latest.h for the Layout.
+   */
+  gst_ebur128graph_signals[SIGNAL_GET_LATEST] =
+      g_signal_new_class_handler("get-latest", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+                                 G_CALLBACK(gst_ebur128graph_get_latest), NULL, NULL, NULL, G_TYPE_BOOLEAN, 1,
+                                 G_TYPE_POINTER);
+
   gst_element_class_add_static_pad_template(element_class, &sink_template_factory);
   gst_element_class_add_static_pad_template(element_class, &src_template_factory);
 
@@ -459,13 +500,20 @@ static GstFlowReturn gst_ebur128graph_dummy_transform(GstBaseTransform *trans, G
   return GST_FLOW_NOT_SUPPORTED;
 }
 
+// renegotiation continues the measurements, a new stream starts them over
+static gboolean gst_ebur128graph_start(GstBaseTransform *trans) {
+  GstEbur128Graph *graph = GST_EBUR128GRAPH(trans);
+  gst_ebur128graph_destroy_libebur128(graph);
+  return TRUE;
+}
+
 static gboolean gst_ebur128graph_set_caps(GstBaseTransform *trans, GstCaps *incaps, GstCaps *outcaps) {
   GstEbur128Graph *graph = GST_EBUR128GRAPH(trans);
   GST_INFO_OBJECT(graph, "gst_ebur128graph_set_caps, incaps=%" GST_PTR_FORMAT " outcaps=%" GST_PTR_FORMAT, incaps,
                   outcaps);
 
-  /* store audio-info */
-  if (!gst_audio_info_from_caps(&graph->audio_info, incaps)) {
+  GstAudioInfo audio_info;
+  if (!gst_audio_info_from_caps(&audio_info, incaps)) {
     GST_ERROR_OBJECT(graph, "Unhandled Input-Caps: %" GST_PTR_FORMAT, incaps);
     return FALSE;
   }
@@ -476,6 +524,22 @@ static gboolean gst_ebur128graph_set_caps(GstBaseTransform *trans, GstCaps *inca
     return FALSE;
   }
 
+  /* a new sample-format is analyzed by the running state, a new rate or channel-layout needs a new one, which continues
+   * the measurements of the old one */
+  gboolean same_layout = graph->state != NULL && gst_ebur128_same_layout(&graph->audio_info, &audio_info);
+  graph->audio_info = audio_info;
+  if (!same_layout) {
+    GstEbur128State *previous = g_steal_pointer(&graph->state);
+    gst_ebur128graph_init_libebur128(graph);
+
+    if (previous != NULL) {
+      if (!gst_ebur128_state_carry_over(graph->state, previous)) {
+        GST_INFO_OBJECT(graph, "Global Loudness and Range start over: can not continue histograms with exact gating");
+      }
+      gst_ebur128_state_destroy(&previous);
+    }
+  }
+
   gst_ebur128graph_setup(graph);
 
   return TRUE;
@@ -491,24 +555,24 @@ static GstFlowReturn gst_ebur128graph_generate_output(GstBaseTransform *trans, G
   GstBuffer *inbuf = trans->queued_buf;
   GST_DEBUG_OBJECT(graph, "generate_output called with inbuf=%p", inbuf);
 
-  GstAudioFormat format = GST_AUDIO_INFO_FORMAT(&graph->audio_info);
-  const gint bytes_per_frame = GST_AUDIO_INFO_BPF(&graph->audio_info);
-
   // if buffer is not mapped yet, map it and calculate total_frames & remaining_frames
   if (!graph->input_buffer_state.is_mapped) {
     GST_DEBUG_OBJECT(graph, "inbuf is not mapped yet, mapping");
-    gst_buffer_map(inbuf, &graph->input_buffer_state.map_info, GST_MAP_READ);
+    if (!gst_audio_buffer_map(&graph->input_buffer_state.audio_buffer, &graph->audio_info, inbuf, GST_MAP_READ)) {
+      GST_ERROR_OBJECT(graph, "Could not map inbuf");
+      return GST_FLOW_ERROR;
+    }
     graph->input_buffer_state.is_mapped = TRUE;
 
-    graph->input_buffer_state.read_ptr = graph->input_buffer_state.map_info.data;
+    graph->input_buffer_state.read_offset = 0;
     graph->input_buffer_state.total_frames = graph->input_buffer_state.remaining_frames =
-        graph->input_buffer_state.map_info.size / bytes_per_frame;
+        graph->input_buffer_state.audio_buffer.n_samples;
 
-    GST_DEBUG_OBJECT(graph, "mapped inbuf (%ld bytes) to read_ptr=%p", graph->input_buffer_state.map_info.size,
-                     graph->input_buffer_state.read_ptr);
+    GST_DEBUG_OBJECT(graph, "mapped inbuf (%ld bytes, %d frames)", gst_buffer_get_size(inbuf),
+                     graph->input_buffer_state.total_frames);
   } else {
-    GST_DEBUG_OBJECT(graph, "continuing to work on inbuf %p (read_ptr is at %p)", inbuf,
-                     graph->input_buffer_state.read_ptr);
+    GST_DEBUG_OBJECT(graph, "continuing to work on inbuf %p (read_offset is at %d)", inbuf,
+                     graph->input_buffer_state.read_offset);
   }
 
   while (graph->input_buffer_state.remaining_frames > 0) {
@@ -529,10 +593,23 @@ static GstFlowReturn gst_ebur128graph_generate_output(GstBaseTransform *trans, G
                      graph->input_buffer_state.remaining_frames, frames_to_process,
                      graph->input_buffer_state.total_frames);
 
-    gst_ebur128_add_frames(graph->state, format, graph->input_buffer_state.read_ptr, frames_to_process);
+    // a changed engine is picked up here, in the streaming-thread that owns the state
+    if (graph->properties.gating_engine != graph->state->gating_engine) {
+      GST_LOG_OBJECT(graph, "Gating-Engine has changed from %d to %d, Re-Initializing libebur128 state",
+                     graph->state->gating_engine, graph->properties.gating_engine);
+      gst_ebur128graph_reinit_libebur128(graph);
+    }
+
+    // only the peak-gauge needs the true-peak of every chunk, and only where it draws a bar. Chunks below it and below
+    // the true-peak since the start skip the oversampler
+    gdouble floor = graph->properties.peak_gauge ? PEAK_GAUGE_FLOOR : G_MAXDOUBLE;
+    gst_ebur128_state_set_prev_true_peak_floor(graph->state, floor);
+
+    gst_ebur128_add_frames(graph->state, &graph->input_buffer_state.audio_buffer,
+                           graph->input_buffer_state.read_offset, frames_to_process);
 
     graph->input_buffer_state.remaining_frames -= frames_to_process;
-    graph->input_buffer_state.read_ptr += frames_to_process * bytes_per_frame;
+    graph->input_buffer_state.read_offset += frames_to_process;
     graph->frames_since_last_video_frame += frames_to_process;
     graph->frames_since_last_measurement += frames_to_process;
     graph->frames_processed += frames_to_process;
@@ -556,10 +633,10 @@ static GstFlowReturn gst_ebur128graph_generate_output(GstBaseTransform *trans, G
 
   if (graph->input_buffer_state.remaining_frames == 0) {
     GST_DEBUG_OBJECT(graph, "inbuf consumed completely, unmapping");
-    gst_buffer_unmap(inbuf, &graph->input_buffer_state.map_info);
+    gst_audio_buffer_unmap(&graph->input_buffer_state.audio_buffer);
     graph->input_buffer_state.is_mapped = FALSE;
 
-    graph->input_buffer_state.read_ptr = NULL;
+    graph->input_buffer_state.read_offset = 0;
     graph->input_buffer_state.total_frames = graph->input_buffer_state.remaining_frames = 0;
   }
 
@@ -667,12 +744,16 @@ static void gst_ebur128graph_init(GstEbur128Graph *graph) {
   graph->properties.peak_gauge_lower_limit = DEFAULT_PEAK_GAUGE_LOWER_LIMIT;
   graph->properties.peak_gauge_upper_limit = DEFAULT_PEAK_GAUGE_UPPER_LIMIT;
 
+  graph->properties.gating_engine = DEFAULT_GATING_ENGINE;
+
   // measurements
   graph->measurements.momentary = 0;
   graph->measurements.short_term = 0;
   graph->measurements.global = 0;
   graph->measurements.range = 0;
   graph->measurements.history = NULL;
+
+  gst_ebur128_latest_cell_init(&graph->latest);
 }
 
 static void gst_ebur128graph_finalize(GObject *object) {
@@ -689,21 +770,37 @@ static void gst_ebur128graph_init_libebur128(GstEbur128Graph *graph) {
   gint channels = GST_AUDIO_INFO_CHANNELS(&graph->audio_info);
   gint mode = EBUR128_MODE_M | EBUR128_MODE_S | EBUR128_MODE_I | EBUR128_MODE_LRA | EBUR128_MODE_TRUE_PEAK;
 
-  graph->state = ebur128_init(channels, rate, mode);
+  graph->state = gst_ebur128_state_new(channels, rate, mode);
+  gst_ebur128_set_channel_map(graph->state, &graph->audio_info);
+  gst_ebur128_state_set_gating_engine(graph->state, graph->properties.gating_engine);
 
   GST_INFO_OBJECT(graph,
                   "Initializing libebur128: "
-                  "rate=%d channels=%d mode=0x%x",
-                  rate, channels, mode);
+                  "rate=%d channels=%d mode=0x%x kernel=%s",
+                  rate, channels, mode, gst_ebur128_kweighting_get_kernel_name(graph->state->kweighting));
 }
 
 static void gst_ebur128graph_destroy_libebur128(GstEbur128Graph *graph) {
   if (graph->state != NULL) {
     GST_INFO_OBJECT(graph, "Destroying libebur128 State");
-    ebur128_destroy(&graph->state);
+    gst_ebur128_state_destroy(&graph->state);
   }
 }
 
+// resumes from a checkpoint of the old state like the ebur128 Element does, which fails from histogram to exact
+static void gst_ebur128graph_reinit_libebur128(GstEbur128Graph *graph) {
+  GBytes *checkpoint = gst_ebur128_state_save(graph->state);
+  gst_ebur128graph_destroy_libebur128(graph);
+  gst_ebur128graph_init_libebur128(graph);
+
+  GError *error = NULL;
+  if (!gst_ebur128_state_restore(graph->state, checkpoint, &error)) {
+    GST_INFO_OBJECT(graph, "Global Loudness and Range start over: %s", error->message);
+    g_error_free(error);
+  }
+  g_bytes_unref(checkpoint);
+}
+
 static void gst_ebur128graph_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec) {
   GstEbur128Graph *graph = GST_EBUR128GRAPH(object);
 
@@ -783,6 +880,9 @@ static void gst_ebur128graph_set_property(GObject *object, guint prop_id, const
   case PROP_PEAK_GAUGE_UPPER_LIMIT:
     graph->properties.peak_gauge_upper_limit = g_value_get_double(value);
     break;
+  case PROP_GATING_ENGINE:
+    graph->properties.gating_engine = g_value_get_enum(value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
     break;
@@ -868,6 +968,9 @@ static void gst_ebur128graph_get_property(GObject *object, guint prop_id, GValue
   case PROP_PEAK_GAUGE_UPPER_LIMIT:
     g_value_set_double(value, graph->properties.peak_gauge_upper_limit);
     break;
+  case PROP_GATING_ENGINE:
+    g_value_set_enum(value, graph->properties.gating_engine);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
     break;
@@ -943,12 +1046,8 @@ static void setup_measurement_array(gdouble **ptr, guint num_items) {
 }
 
 static gboolean gst_ebur128graph_setup(GstEbur128Graph *graph) {
-  // cleanup existing state
-  gst_ebur128graph_destroy_libebur128(graph);
+  // cleanup existing surfaces, the libebur128 state is set up by set_caps
   gst_ebur128graph_destroy_cairo(graph);
-
-  // initialize libraries
-  gst_ebur128graph_init_libebur128(graph);
   gst_ebur128graph_init_cairo(graph);
 
   // re-calculate all positions
@@ -1092,17 +1191,19 @@ static gboolean gst_ebur128graph_take_measurement(GstEbur128Graph *graph) {
   double global;     // integrated loudness in LUFS
 
   if (!gst_ebur128_validate_lib_return("ebur128_loudness_momentary",
-                                       ebur128_loudness_momentary(graph->state, &momentary))) {
+                                       gst_ebur128_state_loudness_momentary(graph->state, &momentary))) {
     return FALSE;
   }
   if (!gst_ebur128_validate_lib_return("ebur128_loudness_shortterm",
-                                       ebur128_loudness_shortterm(graph->state, &short_term))) {
+                                       gst_ebur128_state_loudness_shortterm(graph->state, &short_term))) {
     return FALSE;
   }
-  if (!gst_ebur128_validate_lib_return("ebur128_loudness_range", ebur128_loudness_range(graph->state, &range))) {
+  if (!gst_ebur128_validate_lib_return("ebur128_loudness_range",
+                                       gst_ebur128_state_loudness_range(graph->state, &range))) {
     return FALSE;
   }
-  if (!gst_ebur128_validate_lib_return("ebur128_loudness_global", ebur128_loudness_global(graph->state, &global))) {
+  if (!gst_ebur128_validate_lib_return("ebur128_loudness_global",
+                                       gst_ebur128_state_loudness_global(graph->state, &global))) {
     return FALSE;
   }
   gdouble max_true_peak = 0;
@@ -1111,15 +1212,15 @@ static gboolean gst_ebur128graph_take_measurement(GstEbur128Graph *graph) {
     // maximum true peak in float format (1.0 is 0 dBTP)
     // The equation to convert to dBTP is: 20 * log10(out)
     channel_value = 0;
-    if (!gst_ebur128_validate_lib_return("ebur128_true_peak",
-                                         ebur128_prev_true_peak(graph->state, channel_index, &channel_value))) {
+    if (!gst_ebur128_validate_lib_return(
+            "ebur128_true_peak", gst_ebur128_state_prev_true_peak(graph->state, channel_index, &channel_value))) {
       return FALSE;
     }
     graph->measurements.peak_channel[channel_index] = 20 * log10(channel_value);
 
     channel_value = 0;
     if (!gst_ebur128_validate_lib_return("ebur128_true_peak",
-                                         ebur128_true_peak(graph->state, channel_index, &channel_value))) {
+                                         gst_ebur128_state_true_peak(graph->state, channel_index, &channel_value))) {
       return FALSE;
     }
     max_true_peak += channel_value;
@@ -1132,6 +1233,7 @@ static gboolean gst_ebur128graph_take_measurement(GstEbur128Graph *graph) {
   graph->measurements.range = range;
   graph->measurements.global = global;
   graph->measurements.max_true_peak = max_true_peak;
+  gst_ebur128graph_publish_latest(graph);
 
   double measurement = 0;
   switch (graph->properties.measurement) {
@@ -1156,3 +1258,40 @@ static gboolean gst_ebur128graph_take_measurement(GstEbur128Graph *graph) {
 
   return TRUE;
 }
+
+// copies the measurements just taken, with the all-time peaks the true-peak gauge is based on, for get-latest
+static void gst_ebur128graph_publish_latest(GstEbur128Graph *graph) {
+  GstBaseTransform *trans = GST_BASE_TRANSFORM(graph);
+  GstEbur128Latest latest;
+  memset(&latest, 0, sizeof(GstEbur128Latest));
+
+  latest.flags = GST_EBUR128_META_MOMENTARY | GST_EBUR128_META_SHORTTERM | GST_EBUR128_META_GLOBAL |
+                 GST_EBUR128_META_RANGE | GST_EBUR128_META_SAMPLE_PEAK | GST_EBUR128_META_TRUE_PEAK;
+  latest.channels = graph->measurements.peak_num_channels;
+  latest.momentary = graph->measurements.momentary;
+  latest.shortterm = graph->measurements.short_term;
+  latest.global = graph->measurements.global;
+  latest.range = graph->measurements.range;
+
+  // measurements are taken while the queued buffer is consumed, up to its read-offset
+  latest.timestamp = latest.running_time = GST_CLOCK_TIME_NONE;
+  if (trans->queued_buf != NULL && GST_BUFFER_PTS_IS_VALID(trans->queued_buf)) {
+    latest.timestamp = GST_BUFFER_PTS(trans->queued_buf) +
+                       GST_FRAMES_TO_CLOCK_TIME(graph->input_buffer_state.read_offset,
+                                                GST_AUDIO_INFO_RATE(&graph->audio_info));
+    latest.running_time = gst_segment_to_running_time(&trans->segment, GST_FORMAT_TIME, latest.timestamp);
+  }
+
+  for (guint channel = 0; channel < MIN(latest.channels, GST_EBUR128_LATEST_MAX_CHANNELS); channel++) {
+    gst_ebur128_state_sample_peak(graph->state, channel, &latest.sample_peak[channel]);
+    gst_ebur128_state_true_peak(graph->state, channel, &latest.true_peak[channel]);
+  }
+
+  gst_ebur128_latest_publish(&graph->latest, &latest);
+}
+
+// handler of the get-latest action-signal, may be called from any thread
+static gboolean gst_ebur128graph_get_latest(GstEbur128Graph *graph, gpointer latest) {
+  g_return_val_if_fail(latest != NULL, FALSE);
+  return gst_ebur128_latest_read(&graph->latest, latest);
+}
@@ -1,8 +1,9 @@
 #ifndef __GST_EBUR128GRAPH_H__
 #define __GST_EBUR128GRAPH_H__
 
+#include "gstebur128latest.h"
+#include "gstebur128state.h"
 #include <cairo.h>
-#include <ebur128.h>
 #include <gst/audio/audio.h>
 #include <gst/gst.h>
 #include <gst/video/video.h>
@@ -93,6 +94,9 @@ struct _GstEbur128Properties {
   gdouble peak_gauge_lower_limit;
   gdouble peak_gauge_upper_limit;
 
+  // gating
+  GstEbur128GatingEngine gating_engine;
+
   // font
   gdouble font_size_header;
   gdouble font_size_scale;
@@ -118,9 +122,9 @@ struct _GstEbur128Measurements {
 typedef struct _GstEbur128InputBufferState GstEbur128InputBufferState;
 struct _GstEbur128InputBufferState {
   gboolean is_mapped;
-  GstMapInfo map_info;
+  GstAudioBuffer audio_buffer;
 
-  guint8 *read_ptr;
+  guint read_offset;
   guint total_frames;
   guint remaining_frames;
 };
@@ -132,12 +136,15 @@ struct _GstEbur128Graph {
   GstEbur128Properties properties;
   GstEbur128Measurements measurements;
 
+  // measurements of the last interval, for the get-latest signal
+  GstEbur128LatestCell latest;
+
   cairo_surface_t *background_image;
   cairo_t *background_context;
 
   GstPad *sinkpad, *srcpad;
 
-  ebur128_state *state;
+  GstEbur128State *state;
   GstAudioInfo audio_info;
   GstVideoInfo video_info;
 
@@ -0,0 +1,117 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128history.h"
+
+/**
+ * Prefix-sums are kept as unevaluated sums of two doubles, the rounding-error of every addition is carried in the low
+ * part. Without it, a quiet window next to loud ones would lose most of its digits when the two prefix-sums around it
+ * are subtracted.
+ */
+typedef struct _GstEbur128HistorySum GstEbur128HistorySum;
+struct _GstEbur128HistorySum {
+  gdouble high;
+  gdouble low;
+};
+
+struct _GstEbur128History {
+  // prefix-sums after the last capacity + 1 pushes, the one after push i lives in prefix[i % (capacity + 1)]
+  GstEbur128HistorySum *prefix;
+  guint capacity;
+
+  guint64 pushed;
+};
+
+// error-free transformation of a + b (Knuth's TwoSum)
+static GstEbur128HistorySum gst_ebur128_history_add(GstEbur128HistorySum a, gdouble b) {
+  GstEbur128HistorySum result;
+  result.high = a.high + b;
+  gdouble b_virtual = result.high - a.high;
+  gdouble error = (a.high - (result.high - b_virtual)) + (b - b_virtual);
+  result.low = a.low + error;
+  return result;
+}
+
+static GstEbur128HistorySum gst_ebur128_history_rebase(GstEbur128HistorySum sum, GstEbur128HistorySum origin) {
+  GstEbur128HistorySum rebased = {.high = sum.high, .low = sum.low - origin.low};
+  return gst_ebur128_history_add(rebased, -origin.high);
+}
+
+static gdouble gst_ebur128_history_difference(GstEbur128HistorySum a, GstEbur128HistorySum b) {
+  return (a.high - b.high) + (a.low - b.low);
+}
+
+GstEbur128History *gst_ebur128_history_new(guint capacity) {
+  GstEbur128History *history = g_new0(GstEbur128History, 1);
+  gst_ebur128_history_set_capacity(history, capacity);
+  return history;
+}
+
+void gst_ebur128_history_free(GstEbur128History *history) {
+  g_free(history->prefix);
+  g_free(history);
+}
+
+void gst_ebur128_history_clear(GstEbur128History *history) {
+  history->prefix[0].high = history->prefix[0].low = 0.0;
+  history->pushed = 0;
+}
+
+guint gst_ebur128_history_get_capacity(GstEbur128History *history) { return history->capacity; }
+
+/**
+ * Keeps the newest blocks that still fit, so a window that is changed while running does not start over.
+ */
+void gst_ebur128_history_set_capacity(GstEbur128History *history, guint capacity) {
+  capacity = MAX(capacity, 1);
+  if (capacity == history->capacity) {
+    return;
+  }
+
+  guint keep = 0;
+  GstEbur128HistorySum *prefix = g_new0(GstEbur128HistorySum, (gsize)capacity + 1);
+  if (history->prefix != NULL) {
+    const guint size = history->capacity + 1;
+    keep = MIN(gst_ebur128_history_get_count(history), capacity);
+
+    GstEbur128HistorySum origin = history->prefix[(history->pushed - keep) % size];
+    for (guint i = 0; i <= keep; i++) {
+      prefix[i] = gst_ebur128_history_rebase(history->prefix[(history->pushed - keep + i) % size], origin);
+    }
+  }
+
+  g_free(history->prefix);
+  history->prefix = prefix;
+  history->capacity = capacity;
+  history->pushed = keep;
+}
+
+void gst_ebur128_history_push(GstEbur128History *history, gdouble energy) {
+  const guint size = history->capacity + 1;
+  GstEbur128HistorySum last = history->prefix[history->pushed % size];
+  history->pushed++;
+  history->prefix[history->pushed % size] = gst_ebur128_history_add(last, energy);
+
+  // once per revolution, move the origin to the oldest prefix-sum still needed
+  if (history->pushed % history->capacity == 0) {
+    GstEbur128HistorySum origin = history->prefix[(history->pushed - history->capacity) % size];
+    for (guint i = 0; i < size; i++) {
+      history->prefix[i] = gst_ebur128_history_rebase(history->prefix[i], origin);
+    }
+  }
+}
+
+guint gst_ebur128_history_get_count(GstEbur128History *history) {
+  return (guint)MIN(history->pushed, (guint64)history->capacity);
+}
+
+/**
+ * Sum over the num_blocks newest blocks, or over all of them if fewer have been pushed.
+ */
+gdouble gst_ebur128_history_sum(GstEbur128History *history, guint num_blocks) {
+  const guint size = history->capacity + 1;
+  num_blocks = MIN(num_blocks, gst_ebur128_history_get_count(history));
+  return gst_ebur128_history_difference(history->prefix[history->pushed % size],
+                                        history->prefix[(history->pushed - num_blocks) % size]);
+}
@@ -0,0 +1,32 @@
+#ifndef __GST_EBUR128HISTORY_H__
+#define __GST_EBUR128HISTORY_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * History of 100ms sub-block energies for windowed loudness.
+ *
+ * Instead of the raw samples libebur128 keeps for its window, only one running prefix-sum per sub-block is stored in a
+ * ring, so memory is O(window / 100ms) and the energy of any window up to the capacity is the difference of two ring
+ * entries. Pushing a block is O(1); the prefix-sums are rebased onto the oldest entry once per revolution of the ring,
+ * which keeps them from growing without bound and losing precision.
+ */
+typedef struct _GstEbur128History GstEbur128History;
+
+GstEbur128History *gst_ebur128_history_new(guint capacity);
+void gst_ebur128_history_free(GstEbur128History *history);
+void gst_ebur128_history_clear(GstEbur128History *history);
+
+guint gst_ebur128_history_get_capacity(GstEbur128History *history);
+void gst_ebur128_history_set_capacity(GstEbur128History *history, guint capacity);
+
+void gst_ebur128_history_push(GstEbur128History *history, gdouble energy);
+
+guint gst_ebur128_history_get_count(GstEbur128History *history);
+gdouble gst_ebur128_history_sum(GstEbur128History *history, guint num_blocks);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128HISTORY_H__
@@ -0,0 +1,460 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128kweighting.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GST_EBUR128_KWEIGHTING_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*GstEbur128KWeightingFunc)(GstEbur128KWeighting *kweighting, const gdouble *input, guint num_frames);
+
+struct _GstEbur128KWeighting {
+  guint channels;
+  guint stride;
+  const gchar *kernel_name;
+  GstEbur128KWeightingFunc func;
+
+  // combined 4th-order coefficients of the high-shelf and the high-pass stage, a[0] is always 1.0
+  gdouble a[5];
+  gdouble b[5];
+
+  // look-ahead coefficients of the blocked kernel, see gst_ebur128_kweighting_calculate_block_coefficients()
+  gdouble block_state[4][8];
+  gdouble block_input[8][8];
+
+  // filter-state, v[k * stride + c] holds v_(k+1) of channel c
+  gdouble *v;
+
+  // running sums of squared filter-output and per-channel weights, both stride entries long
+  gdouble *sum;
+  gdouble *weight;
+};
+
+/**
+ * Coefficients as derived by libebur128, so both produce the same energies for the same input.
+ */
+static void gst_ebur128_kweighting_calculate_coefficients(GstEbur128KWeighting *kweighting, guint rate) {
+  gdouble f0 = 1681.974450955533;
+  gdouble G = 3.999843853973347;
+  gdouble Q = 0.7071752369554196;
+
+  gdouble K = tan(G_PI * f0 / (gdouble)rate);
+  gdouble Vh = pow(10.0, G / 20.0);
+  gdouble Vb = pow(Vh, 0.4996667741545416);
+
+  gdouble pb[3] = {0.0, 0.0, 0.0};
+  gdouble pa[3] = {1.0, 0.0, 0.0};
+  gdouble rb[3] = {1.0, -2.0, 1.0};
+  gdouble ra[3] = {1.0, 0.0, 0.0};
+
+  gdouble a0 = 1.0 + K / Q + K * K;
+  pb[0] = (Vh + Vb * K / Q + K * K) / a0;
+  pb[1] = 2.0 * (K * K - Vh) / a0;
+  pb[2] = (Vh - Vb * K / Q + K * K) / a0;
+  pa[1] = 2.0 * (K * K - 1.0) / a0;
+  pa[2] = (1.0 - K / Q + K * K) / a0;
+
+  f0 = 38.13547087602444;
+  Q = 0.5003270373238773;
+  K = tan(G_PI * f0 / (gdouble)rate);
+
+  ra[1] = 2.0 * (K * K - 1.0) / (1.0 + K / Q + K * K);
+  ra[2] = (1.0 - K / Q + K * K) / (1.0 + K / Q + K * K);
+
+  kweighting->b[0] = pb[0] * rb[0];
+  kweighting->b[1] = pb[0] * rb[1] + pb[1] * rb[0];
+  kweighting->b[2] = pb[0] * rb[2] + pb[1] * rb[1] + pb[2] * rb[0];
+  kweighting->b[3] = pb[1] * rb[2] + pb[2] * rb[1];
+  kweighting->b[4] = pb[2] * rb[2];
+
+  kweighting->a[0] = pa[0] * ra[0];
+  kweighting->a[1] = pa[0] * ra[1] + pa[1] * ra[0];
+  kweighting->a[2] = pa[0] * ra[2] + pa[1] * ra[1] + pa[2] * ra[0];
+  kweighting->a[3] = pa[1] * ra[2] + pa[2] * ra[1];
+  kweighting->a[4] = pa[2] * ra[2];
+}
+
+/**
+ * The Filter unrolled by eight frames: v0 of frame f + i is written as a combination of the four v0 values preceding
+ * frame f and the input of frames f to f + i. A blocked kernel only crosses the loop-carried dependency once per eight
+ * frames this way.
+ *
+ * block_state[k][i] is the factor of v0 of frame f - 4 + k, block_input[m][i] the one of the input of frame f + m.
+ */
+static void gst_ebur128_kweighting_calculate_block_coefficients(GstEbur128KWeighting *kweighting) {
+  const gdouble *a = kweighting->a;
+
+  // index 4 + i holds v0 of frame f + i, run the recursion once per unit-state and once per unit-input
+  for (guint k = 0; k < 12; k++) {
+    gdouble w[12] = {0.0};
+    if (k < 4) {
+      w[k] = 1.0;
+    }
+
+    for (guint i = 0; i < 8; i++) {
+      w[4 + i] = (k == 4 + i ? 1.0 : 0.0) - a[4] * w[i] - a[3] * w[i + 1] - a[2] * w[i + 2] - a[1] * w[i + 3];
+    }
+
+    for (guint i = 0; i < 8; i++) {
+      if (k < 4) {
+        kweighting->block_state[k][i] = w[4 + i];
+      } else {
+        kweighting->block_input[k - 4][i] = w[4 + i];
+      }
+    }
+  }
+}
+
+/**
+ * Reference-Implementation for a single channel, also used for the frames left over by the blocked kernel.
+ *
+ * The feedback-terms are summed oldest-first so that only the v1 term sits on the loop-carried dependency chain. This
+ * shortens the critical path from five to two dependent operations per frame compared to libebur128's ordering.
+ *
+ * Neither this nor the blocked kernel reproduce libebur128's rounding. Measured with noise and sines from 20 Hz to
+ * 10 kHz, sub-block energies of all kernels stay within 1e-8 relative of libebur128's at 48 kHz and within 2e-6 at
+ * 192 kHz, less than 1e-5 LU. The worst case is a 20 Hz sine that is mostly removed by the high-pass stage.
+ */
+static void gst_ebur128_kweighting_process_channel(GstEbur128KWeighting *kweighting, const gdouble *input,
+                                                   guint num_frames, guint channel) {
+  const gdouble *a = kweighting->a;
+  const gdouble *b = kweighting->b;
+  const guint stride = kweighting->stride;
+
+  gdouble v1 = kweighting->v[0 * stride + channel];
+  gdouble v2 = kweighting->v[1 * stride + channel];
+  gdouble v3 = kweighting->v[2 * stride + channel];
+  gdouble v4 = kweighting->v[3 * stride + channel];
+  gdouble sum = kweighting->sum[channel];
+
+  for (guint frame = 0; frame < num_frames; frame++) {
+    gdouble v0 = input[frame * stride + channel] - a[4] * v4 - a[3] * v3 - a[2] * v2 - a[1] * v1;
+    gdouble y = b[4] * v4 + b[3] * v3 + b[2] * v2 + b[1] * v1 + b[0] * v0;
+
+    v4 = v3;
+    v3 = v2;
+    v2 = v1;
+    v1 = v0;
+
+    sum += y * y;
+  }
+
+  kweighting->v[0 * stride + channel] = v1;
+  kweighting->v[1 * stride + channel] = v2;
+  kweighting->v[2 * stride + channel] = v3;
+  kweighting->v[3 * stride + channel] = v4;
+  kweighting->sum[channel] = sum;
+}
+
+/**
+ * Reference-Implementation, one channel after the other.
+ */
+static void gst_ebur128_kweighting_process_scalar(GstEbur128KWeighting *kweighting, const gdouble *input,
+                                                  guint num_frames) {
+  for (guint channel = 0; channel < kweighting->channels; channel++) {
+    gst_ebur128_kweighting_process_channel(kweighting, input, num_frames, channel);
+  }
+}
+
+#ifdef GST_EBUR128_KWEIGHTING_X86
+/**
+ * Two channels per __m128d, same operation-order as the scalar Implementation.
+ */
+__attribute__((target("sse2"))) static void
+gst_ebur128_kweighting_process_sse2(GstEbur128KWeighting *kweighting, const gdouble *input, guint num_frames) {
+  const __m128d a1 = _mm_set1_pd(kweighting->a[1]), a2 = _mm_set1_pd(kweighting->a[2]),
+                a3 = _mm_set1_pd(kweighting->a[3]), a4 = _mm_set1_pd(kweighting->a[4]);
+  const __m128d b0 = _mm_set1_pd(kweighting->b[0]), b1 = _mm_set1_pd(kweighting->b[1]),
+                b2 = _mm_set1_pd(kweighting->b[2]), b3 = _mm_set1_pd(kweighting->b[3]),
+                b4 = _mm_set1_pd(kweighting->b[4]);
+  const guint stride = kweighting->stride;
+
+  for (guint lane = 0; lane < stride; lane += 2) {
+    __m128d v1 = _mm_loadu_pd(&kweighting->v[0 * stride + lane]);
+    __m128d v2 = _mm_loadu_pd(&kweighting->v[1 * stride + lane]);
+    __m128d v3 = _mm_loadu_pd(&kweighting->v[2 * stride + lane]);
+    __m128d v4 = _mm_loadu_pd(&kweighting->v[3 * stride + lane]);
+    __m128d sum = _mm_loadu_pd(&kweighting->sum[lane]);
+
+    const gdouble *in = input + lane;
+    for (guint frame = 0; frame < num_frames; frame++, in += stride) {
+      __m128d v0 = _mm_sub_pd(_mm_loadu_pd(in), _mm_mul_pd(a4, v4));
+      v0 = _mm_sub_pd(v0, _mm_mul_pd(a3, v3));
+      v0 = _mm_sub_pd(v0, _mm_mul_pd(a2, v2));
+      v0 = _mm_sub_pd(v0, _mm_mul_pd(a1, v1));
+
+      __m128d y = _mm_add_pd(_mm_mul_pd(b4, v4), _mm_mul_pd(b3, v3));
+      y = _mm_add_pd(y, _mm_mul_pd(b2, v2));
+      y = _mm_add_pd(y, _mm_mul_pd(b1, v1));
+      y = _mm_add_pd(y, _mm_mul_pd(b0, v0));
+
+      v4 = v3;
+      v3 = v2;
+      v2 = v1;
+      v1 = v0;
+
+      sum = _mm_add_pd(sum, _mm_mul_pd(y, y));
+    }
+
+    _mm_storeu_pd(&kweighting->v[0 * stride + lane], v1);
+    _mm_storeu_pd(&kweighting->v[1 * stride + lane], v2);
+    _mm_storeu_pd(&kweighting->v[2 * stride + lane], v3);
+    _mm_storeu_pd(&kweighting->v[3 * stride + lane], v4);
+    _mm_storeu_pd(&kweighting->sum[lane], sum);
+  }
+}
+
+/**
+ * Four channels per __m256d, same operation-order as the scalar Implementation.
+ */
+__attribute__((target("avx2"))) static void
+gst_ebur128_kweighting_process_avx2(GstEbur128KWeighting *kweighting, const gdouble *input, guint num_frames) {
+  const __m256d a1 = _mm256_set1_pd(kweighting->a[1]), a2 = _mm256_set1_pd(kweighting->a[2]),
+                a3 = _mm256_set1_pd(kweighting->a[3]), a4 = _mm256_set1_pd(kweighting->a[4]);
+  const __m256d b0 = _mm256_set1_pd(kweighting->b[0]), b1 = _mm256_set1_pd(kweighting->b[1]),
+                b2 = _mm256_set1_pd(kweighting->b[2]), b3 = _mm256_set1_pd(kweighting->b[3]),
+                b4 = _mm256_set1_pd(kweighting->b[4]);
+  const guint stride = kweighting->stride;
+
+  for (guint lane = 0; lane < stride; lane += 4) {
+    __m256d v1 = _mm256_loadu_pd(&kweighting->v[0 * stride + lane]);
+    __m256d v2 = _mm256_loadu_pd(&kweighting->v[1 * stride + lane]);
+    __m256d v3 = _mm256_loadu_pd(&kweighting->v[2 * stride + lane]);
+    __m256d v4 = _mm256_loadu_pd(&kweighting->v[3 * stride + lane]);
+    __m256d sum = _mm256_loadu_pd(&kweighting->sum[lane]);
+
+    const gdouble *in = input + lane;
+    for (guint frame = 0; frame < num_frames; frame++, in += stride) {
+      __m256d v0 = _mm256_sub_pd(_mm256_loadu_pd(in), _mm256_mul_pd(a4, v4));
+      v0 = _mm256_sub_pd(v0, _mm256_mul_pd(a3, v3));
+      v0 = _mm256_sub_pd(v0, _mm256_mul_pd(a2, v2));
+      v0 = _mm256_sub_pd(v0, _mm256_mul_pd(a1, v1));
+
+      __m256d y = _mm256_add_pd(_mm256_mul_pd(b4, v4), _mm256_mul_pd(b3, v3));
+      y = _mm256_add_pd(y, _mm256_mul_pd(b2, v2));
+      y = _mm256_add_pd(y, _mm256_mul_pd(b1, v1));
+      y = _mm256_add_pd(y, _mm256_mul_pd(b0, v0));
+
+      v4 = v3;
+      v3 = v2;
+      v2 = v1;
+      v1 = v0;
+
+      sum = _mm256_add_pd(sum, _mm256_mul_pd(y, y));
+    }
+
+    _mm256_storeu_pd(&kweighting->v[0 * stride + lane], v1);
+    _mm256_storeu_pd(&kweighting->v[1 * stride + lane], v2);
+    _mm256_storeu_pd(&kweighting->v[2 * stride + lane], v3);
+    _mm256_storeu_pd(&kweighting->v[3 * stride + lane], v4);
+    _mm256_storeu_pd(&kweighting->sum[lane], sum);
+  }
+}
+
+/**
+ * Output of the four frames in w0, computed from the shifted blocks like in the scalar Implementation.
+ * Lane i of w holds v0 of frame f + i - 4, the one of w0 v0 of frame f + i.
+ */
+__attribute__((target("avx2,fma"))) static inline __m256d gst_ebur128_kweighting_block_output(const __m256d *b,
+                                                                                             __m256d w, __m256d w0) {
+  __m256d w2 = _mm256_permute2f128_pd(w, w0, 0x21);
+  __m256d w1 = _mm256_shuffle_pd(w2, w0, 0x5);
+  __m256d w3 = _mm256_shuffle_pd(w, w2, 0x5);
+
+  __m256d y = _mm256_fmadd_pd(b[3], w3, _mm256_mul_pd(b[4], w));
+  y = _mm256_fmadd_pd(b[2], w2, y);
+  y = _mm256_fmadd_pd(b[1], w1, y);
+  return _mm256_fmadd_pd(b[0], w0, y);
+}
+
+/**
+ * Eight frames of one channel per pair of __m256d. Both halves are computed from the last four v0 values of the
+ * previous block with the look-ahead coefficients, summed as a tree, so the loop-carried chain is a broadcast, a
+ * multiplication and two additions per eight frames instead of a multiplication and a subtraction per frame.
+ */
+__attribute__((target("avx2,fma"))) static inline __m256d
+gst_ebur128_kweighting_block_step(const __m256d p[2][4], const __m256d x[2][8], const __m256d *b, const gdouble *in,
+                                  guint stride, __m256d w, __m256d *sum) {
+  // contribution of the input, off the loop-carried chain, the first half only depends on its own four frames
+  __m256d x0 = _mm256_broadcast_sd(in);
+  __m256d u0 = _mm256_mul_pd(x[0][0], x0);
+  __m256d u1 = _mm256_mul_pd(x[1][0], x0);
+  for (guint m = 1; m < 8; m++) {
+    __m256d xm = _mm256_broadcast_sd(in + m * stride);
+    if (m < 4) {
+      u0 = _mm256_fmadd_pd(x[0][m], xm, u0);
+    }
+    u1 = _mm256_fmadd_pd(x[1][m], xm, u1);
+  }
+
+  __m256d v4 = _mm256_permute4x64_pd(w, 0x00), v3 = _mm256_permute4x64_pd(w, 0x55),
+          v2 = _mm256_permute4x64_pd(w, 0xaa), v1 = _mm256_permute4x64_pd(w, 0xff);
+
+  __m256d w0 = _mm256_add_pd(_mm256_fmadd_pd(p[0][0], v4, _mm256_mul_pd(p[0][1], v3)),
+                             _mm256_fmadd_pd(p[0][2], v2, _mm256_fmadd_pd(p[0][3], v1, u0)));
+  __m256d w1 = _mm256_add_pd(_mm256_fmadd_pd(p[1][0], v4, _mm256_mul_pd(p[1][1], v3)),
+                             _mm256_fmadd_pd(p[1][2], v2, _mm256_fmadd_pd(p[1][3], v1, u1)));
+
+  __m256d y0 = gst_ebur128_kweighting_block_output(b, w, w0);
+  __m256d y1 = gst_ebur128_kweighting_block_output(b, w0, w1);
+  *sum = _mm256_fmadd_pd(y1, y1, _mm256_fmadd_pd(y0, y0, *sum));
+
+  return w1;
+}
+
+/**
+ * Blocks of eight frames for mono and stereo, where channel-lanes would stay empty. Stereo runs both channels in the
+ * same loop, so two independent chains are in flight. Frames that do not fill a block go through the scalar
+ * Implementation.
+ */
+__attribute__((target("avx2,fma"))) static void
+gst_ebur128_kweighting_process_avx2_blocked(GstEbur128KWeighting *kweighting, const gdouble *input, guint num_frames) {
+  __m256d p[2][4], x[2][8], b[5];
+  for (guint half = 0; half < 2; half++) {
+    for (guint k = 0; k < 4; k++) {
+      p[half][k] = _mm256_loadu_pd(&kweighting->block_state[k][4 * half]);
+    }
+    for (guint m = 0; m < 8; m++) {
+      x[half][m] = _mm256_loadu_pd(&kweighting->block_input[m][4 * half]);
+    }
+  }
+  for (guint k = 0; k < 5; k++) {
+    b[k] = _mm256_set1_pd(kweighting->b[k]);
+  }
+
+  const guint stride = kweighting->stride;
+  const guint channels = MIN(kweighting->channels, 2);
+  const guint num_blocks = num_frames / 8;
+
+  // lane i holds v0 of frame f + i - 4
+  __m256d w[2], sum[2];
+  for (guint channel = 0; channel < channels; channel++) {
+    w[channel] = _mm256_set_pd(kweighting->v[0 * stride + channel], kweighting->v[1 * stride + channel],
+                               kweighting->v[2 * stride + channel], kweighting->v[3 * stride + channel]);
+    sum[channel] = _mm256_setzero_pd();
+  }
+
+  const gdouble *in = input;
+  if (channels == 2) {
+    for (guint block = 0; block < num_blocks; block++, in += 8 * stride) {
+      w[0] = gst_ebur128_kweighting_block_step(p, x, b, in, stride, w[0], &sum[0]);
+      w[1] = gst_ebur128_kweighting_block_step(p, x, b, in + 1, stride, w[1], &sum[1]);
+    }
+  } else {
+    for (guint block = 0; block < num_blocks; block++, in += 8 * stride) {
+      w[0] = gst_ebur128_kweighting_block_step(p, x, b, in, stride, w[0], &sum[0]);
+    }
+  }
+
+  for (guint channel = 0; channel < channels; channel++) {
+    gdouble lanes[4];
+    _mm256_storeu_pd(lanes, w[channel]);
+    kweighting->v[0 * stride + channel] = lanes[3];
+    kweighting->v[1 * stride + channel] = lanes[2];
+    kweighting->v[2 * stride + channel] = lanes[1];
+    kweighting->v[3 * stride + channel] = lanes[0];
+
+    _mm256_storeu_pd(lanes, sum[channel]);
+    kweighting->sum[channel] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    gst_ebur128_kweighting_process_channel(kweighting, in, num_frames % 8, channel);
+  }
+}
+#endif
+
+static void gst_ebur128_kweighting_select_kernel(GstEbur128KWeighting *kweighting) {
+  kweighting->stride = kweighting->channels;
+  kweighting->kernel_name = "scalar";
+  kweighting->func = gst_ebur128_kweighting_process_scalar;
+
+#ifdef GST_EBUR128_KWEIGHTING_X86
+  __builtin_cpu_init();
+
+  // mono and stereo would leave channel-lanes empty and are blocked over frames instead, everything wider profits from
+  // channel-lanes
+  if (kweighting->channels <= 2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    kweighting->kernel_name = "avx2-blocked";
+    kweighting->func = gst_ebur128_kweighting_process_avx2_blocked;
+  } else if (kweighting->channels > 2 && __builtin_cpu_supports("avx2")) {
+    kweighting->stride = (kweighting->channels + 3) & ~3u;
+    kweighting->kernel_name = "avx2";
+    kweighting->func = gst_ebur128_kweighting_process_avx2;
+  } else if (kweighting->channels > 1 && __builtin_cpu_supports("sse2")) {
+    kweighting->stride = (kweighting->channels + 1) & ~1u;
+    kweighting->kernel_name = "sse2";
+    kweighting->func = gst_ebur128_kweighting_process_sse2;
+  }
+#endif
+}
+
+GstEbur128KWeighting *gst_ebur128_kweighting_new(guint channels, guint rate) {
+  GstEbur128KWeighting *kweighting = g_new0(GstEbur128KWeighting, 1);
+  kweighting->channels = channels;
+
+  gst_ebur128_kweighting_select_kernel(kweighting);
+  gst_ebur128_kweighting_calculate_coefficients(kweighting, rate);
+  gst_ebur128_kweighting_calculate_block_coefficients(kweighting);
+
+  kweighting->v = g_new0(gdouble, 4 * kweighting->stride);
+  kweighting->sum = g_new0(gdouble, kweighting->stride);
+  kweighting->weight = g_new0(gdouble, kweighting->stride);
+  for (guint channel = 0; channel < channels; channel++) {
+    kweighting->weight[channel] = 1.0;
+  }
+
+  return kweighting;
+}
+
+void gst_ebur128_kweighting_free(GstEbur128KWeighting *kweighting) {
+  g_free(kweighting->v);
+  g_free(kweighting->sum);
+  g_free(kweighting->weight);
+  g_free(kweighting);
+}
+
+void gst_ebur128_kweighting_reset(GstEbur128KWeighting *kweighting) {
+  memset(kweighting->v, 0, 4 * kweighting->stride * sizeof(gdouble));
+  memset(kweighting->sum, 0, kweighting->stride * sizeof(gdouble));
+}
+
+guint gst_ebur128_kweighting_get_stride(GstEbur128KWeighting *kweighting) { return kweighting->stride; }
+
+const gchar *gst_ebur128_kweighting_get_kernel_name(GstEbur128KWeighting *kweighting) {
+  return kweighting->kernel_name;
+}
+
+void gst_ebur128_kweighting_set_channel_weight(GstEbur128KWeighting *kweighting, guint channel, gdouble weight) {
+  g_return_if_fail(channel < kweighting->channels);
+  kweighting->weight[channel] = weight;
+}
+
+void gst_ebur128_kweighting_process(GstEbur128KWeighting *kweighting, const gdouble *input, guint num_frames) {
+  kweighting->func(kweighting, input, num_frames);
+
+  // flush denormals out of the feedback-path, like libebur128 does after each call
+  for (guint i = 0; i < 4 * kweighting->stride; i++) {
+    if (fabs(kweighting->v[i]) < DBL_MIN) {
+      kweighting->v[i] = 0.0;
+    }
+  }
+}
+
+gdouble gst_ebur128_kweighting_peek_energy(GstEbur128KWeighting *kweighting) {
+  gdouble energy = 0.0;
+  for (guint channel = 0; channel < kweighting->channels; channel++) {
+    energy += kweighting->sum[channel] * kweighting->weight[channel];
+  }
+  return energy;
+}
+
+gdouble gst_ebur128_kweighting_take_energy(GstEbur128KWeighting *kweighting) {
+  gdouble energy = gst_ebur128_kweighting_peek_energy(kweighting);
+  memset(kweighting->sum, 0, kweighting->stride * sizeof(gdouble));
+  return energy;
+}
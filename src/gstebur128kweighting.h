@@ -0,0 +1,37 @@
+#ifndef __GST_EBUR128KWEIGHTING_H__
+#define __GST_EBUR128KWEIGHTING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * K-Weighting Pre-Filter (ITU-R BS.1770) and Mean-Square accumulator.
+ *
+ * The Filter operates on blocks of doubles where channel c of frame f is found at input[f * stride + c]. Channels are
+ * processed side by side in SIMD-Lanes, so stride is the channel count rounded up to the lane-width of the kernel that
+ * was selected for the running CPU. Mono and stereo are processed in blocks of frames instead and are not padded.
+ * Padding-Lanes are expected to be zero.
+ *
+ * The squared Filter-Output is summed per Channel until the sums are taken by the caller, usually once per 100ms
+ * sub-block.
+ */
+typedef struct _GstEbur128KWeighting GstEbur128KWeighting;
+
+GstEbur128KWeighting *gst_ebur128_kweighting_new(guint channels, guint rate);
+void gst_ebur128_kweighting_free(GstEbur128KWeighting *kweighting);
+void gst_ebur128_kweighting_reset(GstEbur128KWeighting *kweighting);
+
+guint gst_ebur128_kweighting_get_stride(GstEbur128KWeighting *kweighting);
+const gchar *gst_ebur128_kweighting_get_kernel_name(GstEbur128KWeighting *kweighting);
+
+void gst_ebur128_kweighting_set_channel_weight(GstEbur128KWeighting *kweighting, guint channel, gdouble weight);
+
+void gst_ebur128_kweighting_process(GstEbur128KWeighting *kweighting, const gdouble *input, guint num_frames);
+
+gdouble gst_ebur128_kweighting_peek_energy(GstEbur128KWeighting *kweighting);
+gdouble gst_ebur128_kweighting_take_energy(GstEbur128KWeighting *kweighting);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128KWEIGHTING_H__
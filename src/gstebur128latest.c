@@ -0,0 +1,45 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128latest.h"
+#include "gstebur128fence.h"
+#include <string.h>
+
+void gst_ebur128_latest_cell_init(GstEbur128LatestCell *cell) {
+  memset(cell, 0, sizeof(GstEbur128LatestCell));
+}
+
+void gst_ebur128_latest_publish(GstEbur128LatestCell *cell, const GstEbur128Latest *values) {
+  // only this thread writes the sequence, so it is odd exactly while the values are being written
+  guint sequence = (guint)g_atomic_int_get(&cell->sequence) | 1;
+  g_atomic_int_set(&cell->sequence, (gint)sequence);
+  gst_ebur128_fence();
+
+  memcpy(&cell->values, values, sizeof(GstEbur128Latest));
+
+  // 0 means nothing has been published yet, so it is skipped when the sequence wraps around
+  sequence = MAX(sequence + 1, 2);
+  gst_ebur128_fence();
+  g_atomic_int_set(&cell->sequence, (gint)sequence);
+}
+
+gboolean gst_ebur128_latest_read(GstEbur128LatestCell *cell, GstEbur128Latest *values) {
+  while (TRUE) {
+    gint before = g_atomic_int_get(&cell->sequence);
+    if (before == 0) {
+      return FALSE;
+    }
+    if (before & 1) {
+      continue;
+    }
+
+    gst_ebur128_fence();
+    memcpy(values, &cell->values, sizeof(GstEbur128Latest));
+    gst_ebur128_fence();
+
+    if (g_atomic_int_get(&cell->sequence) == before) {
+      return TRUE;
+    }
+  }
+}
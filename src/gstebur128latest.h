@@ -0,0 +1,60 @@
+#ifndef __GST_EBUR128LATEST_H__
+#define __GST_EBUR128LATEST_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// peaks of channels beyond this are not part of the latest values
+#define GST_EBUR128_LATEST_MAX_CHANNELS 32
+
+/**
+ * Latest Measurements of the ebur128 and ebur128graph Elements, read with their "get-latest" Action-Signal:
+ *
+ *   GstEbur128Latest latest;
+ *   gboolean valid;
+ *   g_signal_emit_by_name(element, "get-latest", &latest, &valid);
+ *
+ * The Signal only copies the values out of the Element and may be emitted from any thread at any rate, it never waits
+ * for and never blocks the streaming-thread. It returns FALSE until the first Measurement has been taken. Loudness is
+ * in LUFS (Range in LU) and Peaks are linear (1.0 is 0 dBFS), like in the Messages, with flags naming the
+ * Measurements that are set (GstEbur128MetaFlags). channels is the number of Channels of the Stream, Peaks are filled
+ * for at most GST_EBUR128_LATEST_MAX_CHANNELS of them.
+ */
+typedef struct _GstEbur128Latest GstEbur128Latest;
+struct _GstEbur128Latest {
+  guint32 flags;
+  guint32 channels;
+
+  guint64 timestamp;
+  guint64 running_time;
+
+  gdouble momentary;
+  gdouble shortterm;
+  gdouble global;
+  gdouble range;
+
+  gdouble sample_peak[GST_EBUR128_LATEST_MAX_CHANNELS];
+  gdouble true_peak[GST_EBUR128_LATEST_MAX_CHANNELS];
+};
+
+/**
+ * Seqlock around one GstEbur128Latest, written by a single thread and read by any number of others.
+ *
+ * The writer makes the sequence odd, copies the values and makes it even again, so it never waits. A reader copies the
+ * values between two reads of the sequence and retries if a write was in progress or happened in between, which only
+ * happens when it races one of the writes taking place once per interval.
+ */
+typedef struct _GstEbur128LatestCell GstEbur128LatestCell;
+struct _GstEbur128LatestCell {
+  gint sequence;
+  GstEbur128Latest values;
+};
+
+void gst_ebur128_latest_cell_init(GstEbur128LatestCell *cell);
+void gst_ebur128_latest_publish(GstEbur128LatestCell *cell, const GstEbur128Latest *values);
+gboolean gst_ebur128_latest_read(GstEbur128LatestCell *cell, GstEbur128Latest *values);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128LATEST_H__
@@ -0,0 +1,328 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128logger.h"
+#include "gstebur128archive.h"
+#include "gstebur128ring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+// records formatted into one write at most, so a writer that fell behind still syncs in between
+#define GST_EBUR128_LOGGER_MAX_BATCH 256
+
+// records compressed into one block of an archive, 100s worth of the default interval
+#define GST_EBUR128_LOGGER_ARCHIVE_BLOCK_RECORDS 1024
+
+// every item of the ring is the wall-clock time of the record, followed by the record
+#define GST_EBUR128_LOGGER_RECORD_OFFSET 8
+
+struct _GstEbur128Logger {
+  gchar *location;
+  gboolean append;
+  GstEbur128LogFormat format;
+  guint channels;
+  guint num_windows;
+  gint64 fsync_interval;
+
+  GstEbur128Ring *ring;
+  GThread *thread;
+  gsize item_size;
+  guint8 *item;
+
+  // set by the thread when it gave up, taken by the element
+  gpointer error;
+};
+
+static void gst_ebur128_logger_set_error(GstEbur128Logger *logger, const gchar *what) {
+  int errsv = errno;
+  gchar *error = g_strdup_printf("could not %s %s: %s", what, logger->location, g_strerror(errsv));
+  if (!g_atomic_pointer_compare_and_exchange(&logger->error, NULL, error)) {
+    g_free(error);
+  }
+}
+
+static void gst_ebur128_logger_take_gerror(GstEbur128Logger *logger, GError *gerror) {
+  if (!g_atomic_pointer_compare_and_exchange(&logger->error, NULL, gerror->message)) {
+    g_free(gerror->message);
+  }
+  gerror->message = NULL;
+  g_error_free(gerror);
+}
+
+static void gst_ebur128_logger_append_double(GString *out, gdouble value, gboolean json) {
+  if (json && !isfinite(value)) {
+    g_string_append(out, "null");
+    return;
+  }
+
+  gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+  g_string_append(out, g_ascii_formatd(buffer, sizeof(buffer), "%.6f", value));
+}
+
+static void gst_ebur128_logger_append_csv_header(GstEbur128Logger *logger, GString *out) {
+  g_string_append(out, "timestamp,running-time,stream-time,momentary,shortterm,global,range");
+  for (guint i = 0; i < logger->num_windows; i++) {
+    g_string_append_printf(out, ",window-%u", i);
+  }
+  for (guint channel = 0; channel < logger->channels; channel++) {
+    g_string_append_printf(out, ",sample-peak-%u", channel);
+  }
+  for (guint channel = 0; channel < logger->channels; channel++) {
+    g_string_append_printf(out, ",true-peak-%u", channel);
+  }
+  g_string_append_c(out, '\n');
+}
+
+// every row has all columns, the ones of measurements that are not enabled stay empty
+static void gst_ebur128_logger_append_csv_row(GString *out, const GstEbur128MeasurementRecord *record) {
+  g_string_append_printf(out, "%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT, record->timestamp,
+                         record->running_time, record->stream_time);
+
+  const gdouble loudness[] = {record->momentary, record->shortterm, record->global, record->range};
+  const guint32 loudness_flags[] = {GST_EBUR128_META_MOMENTARY, GST_EBUR128_META_SHORTTERM, GST_EBUR128_META_GLOBAL,
+                                    GST_EBUR128_META_RANGE};
+  for (guint i = 0; i < G_N_ELEMENTS(loudness); i++) {
+    g_string_append_c(out, ',');
+    if (record->flags & loudness_flags[i]) {
+      gst_ebur128_logger_append_double(out, loudness[i], FALSE);
+    }
+  }
+
+  const gdouble *windows = gst_ebur128_measurement_windows(record);
+  for (guint i = 0; i < record->num_windows; i++) {
+    g_string_append_c(out, ',');
+    gst_ebur128_logger_append_double(out, windows[i], FALSE);
+  }
+
+  const gdouble *peaks[] = {gst_ebur128_measurement_sample_peak(record), gst_ebur128_measurement_true_peak(record)};
+  const guint32 peak_flags[] = {GST_EBUR128_META_SAMPLE_PEAK, GST_EBUR128_META_TRUE_PEAK};
+  for (guint i = 0; i < G_N_ELEMENTS(peaks); i++) {
+    for (guint channel = 0; channel < record->channels; channel++) {
+      g_string_append_c(out, ',');
+      if (record->flags & peak_flags[i]) {
+        gst_ebur128_logger_append_double(out, peaks[i][channel], FALSE);
+      }
+    }
+  }
+  g_string_append_c(out, '\n');
+}
+
+static void gst_ebur128_logger_append_json_array(GString *out, const gchar *name, const gdouble *values, guint n) {
+  g_string_append_printf(out, ",\"%s\":[", name);
+  for (guint i = 0; i < n; i++) {
+    if (i > 0) {
+      g_string_append_c(out, ',');
+    }
+    gst_ebur128_logger_append_double(out, values[i], TRUE);
+  }
+  g_string_append_c(out, ']');
+}
+
+// only the enabled measurements, named like the fields of the message
+static void gst_ebur128_logger_append_json_row(GString *out, const GstEbur128MeasurementRecord *record) {
+  g_string_append_printf(out,
+                         "{\"timestamp\":%" G_GUINT64_FORMAT ",\"running-time\":%" G_GUINT64_FORMAT
+                         ",\"stream-time\":%" G_GUINT64_FORMAT,
+                         record->timestamp, record->running_time, record->stream_time);
+
+  const gchar *loudness_names[] = {"momentary", "shortterm", "global", "range"};
+  const gdouble loudness[] = {record->momentary, record->shortterm, record->global, record->range};
+  const guint32 loudness_flags[] = {GST_EBUR128_META_MOMENTARY, GST_EBUR128_META_SHORTTERM, GST_EBUR128_META_GLOBAL,
+                                    GST_EBUR128_META_RANGE};
+  for (guint i = 0; i < G_N_ELEMENTS(loudness); i++) {
+    if (record->flags & loudness_flags[i]) {
+      g_string_append_printf(out, ",\"%s\":", loudness_names[i]);
+      gst_ebur128_logger_append_double(out, loudness[i], TRUE);
+    }
+  }
+
+  if (record->num_windows > 0) {
+    gst_ebur128_logger_append_json_array(out, "windows", gst_ebur128_measurement_windows(record),
+                                         record->num_windows);
+  }
+  if (record->flags & GST_EBUR128_META_SAMPLE_PEAK) {
+    gst_ebur128_logger_append_json_array(out, "sample-peak", gst_ebur128_measurement_sample_peak(record),
+                                         record->channels);
+  }
+  if (record->flags & GST_EBUR128_META_TRUE_PEAK) {
+    gst_ebur128_logger_append_json_array(out, "true-peak", gst_ebur128_measurement_true_peak(record),
+                                         record->channels);
+  }
+  g_string_append(out, "}\n");
+}
+
+static gboolean gst_ebur128_logger_write(GstEbur128Logger *logger, int fd, GString *out) {
+  gsize written = 0;
+  while (written < out->len) {
+    gssize ret = write(fd, out->str + written, out->len - written);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      gst_ebur128_logger_set_error(logger, "write");
+      return FALSE;
+    }
+    written += ret;
+  }
+  g_string_truncate(out, 0);
+  return TRUE;
+}
+
+static void gst_ebur128_logger_write_archive(GstEbur128Logger *logger) {
+  GError *error = NULL;
+  GstEbur128ArchiveWriter *writer =
+      gst_ebur128_archive_writer_open(logger->location, GST_EBUR128_LOGGER_ARCHIVE_BLOCK_RECORDS, &error);
+  if (writer == NULL) {
+    gst_ebur128_logger_take_gerror(logger, error);
+    return;
+  }
+
+  guint8 *item = g_malloc(logger->item_size);
+  const GstEbur128MeasurementRecord *record = (gpointer)(item + GST_EBUR128_LOGGER_RECORD_OFFSET);
+
+  gint64 last_sync = g_get_monotonic_time();
+  gboolean success = TRUE;
+  while (success && gst_ebur128_ring_pop(logger->ring, item, TRUE)) {
+    gint64 time;
+    memcpy(&time, item, sizeof(time));
+    success = gst_ebur128_archive_writer_append(writer, time, record, &error);
+    gst_ebur128_ring_done(logger->ring);
+
+    // only completed blocks are synced, so this mostly finds nothing new to write
+    gint64 now = g_get_monotonic_time();
+    if (success && now - last_sync >= logger->fsync_interval) {
+      success = gst_ebur128_archive_writer_sync(writer, &error);
+      last_sync = now;
+    }
+  }
+
+  if (!gst_ebur128_archive_writer_close(writer, success ? &error : NULL)) {
+    success = FALSE;
+  }
+  if (!success) {
+    gst_ebur128_logger_take_gerror(logger, error);
+  }
+  g_free(item);
+}
+
+static gpointer gst_ebur128_logger_thread(gpointer user_data) {
+  GstEbur128Logger *logger = user_data;
+
+  if (logger->format == GST_EBUR128_LOG_FORMAT_ARCHIVE) {
+    gst_ebur128_logger_write_archive(logger);
+    gst_ebur128_ring_close(logger->ring);
+    return NULL;
+  }
+
+  int flags = O_WRONLY | O_CREAT | (logger->append ? O_APPEND : O_TRUNC);
+  int fd = g_open(logger->location, flags, 0644);
+  if (fd < 0) {
+    gst_ebur128_logger_set_error(logger, "open");
+    gst_ebur128_ring_close(logger->ring);
+    return NULL;
+  }
+
+  GString *out = g_string_sized_new(4096);
+  guint8 *item = g_malloc(logger->item_size);
+  const GstEbur128MeasurementRecord *record = (gpointer)(item + GST_EBUR128_LOGGER_RECORD_OFFSET);
+  if (logger->format == GST_EBUR128_LOG_FORMAT_CSV) {
+    gst_ebur128_logger_append_csv_header(logger, out);
+  }
+
+  gint64 last_sync = g_get_monotonic_time();
+  gboolean success = TRUE;
+  while (success && gst_ebur128_ring_pop(logger->ring, item, TRUE)) {
+    // everything queued in the meantime goes into the same write
+    guint batched = 0;
+    do {
+      if (logger->format == GST_EBUR128_LOG_FORMAT_CSV) {
+        gst_ebur128_logger_append_csv_row(out, record);
+      } else {
+        gst_ebur128_logger_append_json_row(out, record);
+      }
+      gst_ebur128_ring_done(logger->ring);
+    } while (++batched < GST_EBUR128_LOGGER_MAX_BATCH && gst_ebur128_ring_pop(logger->ring, item, FALSE));
+
+    success = gst_ebur128_logger_write(logger, fd, out);
+
+    gint64 now = g_get_monotonic_time();
+    if (success && now - last_sync >= logger->fsync_interval) {
+      g_fsync(fd);
+      last_sync = now;
+    }
+  }
+
+  if (success) {
+    gst_ebur128_logger_write(logger, fd, out);
+  }
+  g_fsync(fd);
+  close(fd);
+
+  // nothing is written any more, so the element stops queueing
+  gst_ebur128_ring_close(logger->ring);
+  g_string_free(out, TRUE);
+  g_free(item);
+  return NULL;
+}
+
+GstEbur128Logger *gst_ebur128_logger_new(const gchar *location, gboolean append, GstEbur128LogFormat format,
+                                         guint channels, guint num_windows, guint capacity,
+                                         GstClockTime fsync_interval) {
+  GstEbur128Logger *logger = g_new0(GstEbur128Logger, 1);
+  logger->location = g_strdup(location);
+  logger->append = append;
+  logger->format = format;
+  logger->channels = channels;
+  logger->num_windows = num_windows;
+  logger->fsync_interval = GST_CLOCK_TIME_IS_VALID(fsync_interval) ? GST_TIME_AS_USECONDS(fsync_interval) : G_MAXINT64;
+
+  logger->item_size = GST_EBUR128_LOGGER_RECORD_OFFSET + GST_EBUR128_MEASUREMENT_SIZE(channels, num_windows);
+  logger->item = g_malloc(logger->item_size);
+  logger->ring = gst_ebur128_ring_new(capacity, logger->item_size);
+  logger->thread = g_thread_new("ebur128-logger", gst_ebur128_logger_thread, logger);
+  return logger;
+}
+
+// writes everything that has been queued, syncs it to disk and closes the file
+void gst_ebur128_logger_free(GstEbur128Logger *logger) {
+  gst_ebur128_ring_close(logger->ring);
+  g_thread_join(logger->thread);
+
+  gst_ebur128_ring_free(logger->ring);
+  g_free(logger->item);
+  g_free(logger->error);
+  g_free(logger->location);
+  g_free(logger);
+}
+
+gboolean gst_ebur128_logger_matches(GstEbur128Logger *logger, const gchar *location, GstEbur128LogFormat format,
+                                    guint channels, guint num_windows) {
+  return g_strcmp0(logger->location, location) == 0 && logger->format == format && logger->channels == channels &&
+         logger->num_windows == num_windows;
+}
+
+// time is the wall-clock time of the record in nanoseconds since the UNIX-epoch, which only the archive stores
+gboolean gst_ebur128_logger_push(GstEbur128Logger *logger, const GstEbur128MeasurementRecord *record, gint64 time) {
+  memcpy(logger->item, &time, sizeof(time));
+  memcpy(logger->item + GST_EBUR128_LOGGER_RECORD_OFFSET, record, logger->item_size - GST_EBUR128_LOGGER_RECORD_OFFSET);
+  return gst_ebur128_ring_push(logger->ring, logger->item, FALSE);
+}
+
+// returns the reason the logger stopped writing, once, or NULL while it is fine
+gchar *gst_ebur128_logger_take_error(GstEbur128Logger *logger) {
+  gchar *error = g_atomic_pointer_get(&logger->error);
+  if (error != NULL && g_atomic_pointer_compare_and_exchange(&logger->error, error, NULL)) {
+    return error;
+  }
+  return NULL;
+}
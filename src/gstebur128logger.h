@@ -0,0 +1,48 @@
+#ifndef __GST_EBUR128LOGGER_H__
+#define __GST_EBUR128LOGGER_H__
+
+#include "gstebur128measurement.h"
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  /**
+   * one line per Record with a header-line naming the columns, which is repeated when they change
+   */
+  GST_EBUR128_LOG_FORMAT_CSV,
+
+  /**
+   * one JSON-Object per line, with the fields of the Message
+   */
+  GST_EBUR128_LOG_FORMAT_NDJSON,
+
+  /**
+   * compressed binary Archive indexed by wall-clock time, see gstebur128archive.h; an existing Archive is appended to
+   */
+  GST_EBUR128_LOG_FORMAT_ARCHIVE
+} GstEbur128LogFormat;
+
+/**
+ * Writes Measurement-Records into a File on its own Thread.
+ *
+ * Records are copied into a preallocated Ring, so pushing them never allocates, blocks or touches the Filesystem.
+ * The Thread opens the File, formats everything that has been queued since its last write into one write and syncs
+ * the File to Disk at most once per fsync_interval, and once more when the Logger is freed. Records that do not fit
+ * into the Ring are dropped and counted.
+ */
+typedef struct _GstEbur128Logger GstEbur128Logger;
+
+GstEbur128Logger *gst_ebur128_logger_new(const gchar *location, gboolean append, GstEbur128LogFormat format,
+                                         guint channels, guint num_windows, guint capacity,
+                                         GstClockTime fsync_interval);
+void gst_ebur128_logger_free(GstEbur128Logger *logger);
+gboolean gst_ebur128_logger_matches(GstEbur128Logger *logger, const gchar *location, GstEbur128LogFormat format,
+                                    guint channels, guint num_windows);
+
+gboolean gst_ebur128_logger_push(GstEbur128Logger *logger, const GstEbur128MeasurementRecord *record, gint64 time);
+gchar *gst_ebur128_logger_take_error(GstEbur128Logger *logger);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128LOGGER_H__
@@ -0,0 +1,50 @@
+#ifndef __GST_EBUR128MEASUREMENT_H__
+#define __GST_EBUR128MEASUREMENT_H__
+
+#include "gstebur128meta.h"
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define GST_EBUR128_MEASUREMENT_MEDIA_TYPE "application/x-ebur128-measurement"
+#define GST_EBUR128_MEASUREMENT_VERSION 1
+
+/**
+ * Record the ebur128 Element pushes on its meas_src Pad for every Message it would post, one per Buffer.
+ *
+ * Holds the same Measurements as the Message, in host byte-order, and is followed by num_windows window-loudnesses in
+ * the order of the window and windows Properties, then the Sample-Peak and the True-Peak of every Channel. The Caps
+ * carry version, channels and windows, so all Records of one Caps have the same size. Only the Measurements named in
+ * flags are set, all others are 0.
+ */
+typedef struct _GstEbur128MeasurementRecord GstEbur128MeasurementRecord;
+struct _GstEbur128MeasurementRecord {
+  guint32 version;
+
+  // GstEbur128MetaFlags
+  guint32 flags;
+  guint32 channels;
+  guint32 num_windows;
+
+  guint64 timestamp;
+  guint64 running_time;
+  guint64 stream_time;
+
+  gdouble momentary;
+  gdouble shortterm;
+  gdouble global;
+  gdouble range;
+
+  gdouble values[];
+};
+
+#define GST_EBUR128_MEASUREMENT_SIZE(channels, num_windows)                                                            \
+  (sizeof(GstEbur128MeasurementRecord) + ((gsize)(num_windows) + 2 * (gsize)(channels)) * sizeof(gdouble))
+
+#define gst_ebur128_measurement_windows(m) ((m)->values)
+#define gst_ebur128_measurement_sample_peak(m) ((m)->values + (m)->num_windows)
+#define gst_ebur128_measurement_true_peak(m) ((m)->values + (m)->num_windows + (m)->channels)
+
+G_END_DECLS
+
+#endif // __GST_EBUR128MEASUREMENT_H__
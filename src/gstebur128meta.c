@@ -0,0 +1,90 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128meta.h"
+#include <string.h>
+
+GType gst_ebur128_meta_api_get_type(void) {
+  static GType type = 0;
+  static const gchar *tags[] = {GST_META_TAG_AUDIO_STR, NULL};
+
+  if (g_once_init_enter(&type)) {
+    GType _type = gst_meta_api_type_register("GstEbur128MetaAPI", tags);
+    g_once_init_leave(&type, _type);
+  }
+  return type;
+}
+
+static gboolean gst_ebur128_meta_init(GstMeta *meta, gpointer params, GstBuffer *buffer) {
+  GstEbur128Meta *ebur128_meta = (GstEbur128Meta *)meta;
+
+  ebur128_meta->flags = 0;
+  ebur128_meta->momentary = 0.0;
+  ebur128_meta->shortterm = 0.0;
+  ebur128_meta->global = 0.0;
+  ebur128_meta->range = 0.0;
+  ebur128_meta->channels = 0;
+  ebur128_meta->sample_peak = NULL;
+  ebur128_meta->true_peak = NULL;
+
+  return TRUE;
+}
+
+// both peak-arrays share one allocation, owned by sample_peak
+static void gst_ebur128_meta_alloc_peaks(GstEbur128Meta *meta, guint channels) {
+  meta->channels = channels;
+  meta->sample_peak = g_new0(gdouble, 2 * (gsize)channels);
+  meta->true_peak = meta->sample_peak + channels;
+}
+
+static void gst_ebur128_meta_free(GstMeta *meta, GstBuffer *buffer) {
+  GstEbur128Meta *ebur128_meta = (GstEbur128Meta *)meta;
+  g_free(ebur128_meta->sample_peak);
+}
+
+// the measurements describe the audio and stay valid for copies of the buffer, but not for anything derived from it
+static gboolean gst_ebur128_meta_transform(GstBuffer *dest, GstMeta *meta, GstBuffer *buffer, GQuark type,
+                                           gpointer data) {
+  GstEbur128Meta *src = (GstEbur128Meta *)meta;
+
+  if (!GST_META_TRANSFORM_IS_COPY(type)) {
+    return FALSE;
+  }
+
+  GstMetaTransformCopy *copy = data;
+  if (copy->region) {
+    return FALSE;
+  }
+
+  GstEbur128Meta *dst = gst_buffer_add_ebur128_meta(dest, src->flags, src->channels);
+  dst->momentary = src->momentary;
+  dst->shortterm = src->shortterm;
+  dst->global = src->global;
+  dst->range = src->range;
+  memcpy(dst->sample_peak, src->sample_peak, 2 * (gsize)src->channels * sizeof(gdouble));
+
+  return TRUE;
+}
+
+const GstMetaInfo *gst_ebur128_meta_get_info(void) {
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter((GstMetaInfo **)&meta_info)) {
+    const GstMetaInfo *mi =
+        gst_meta_register(GST_EBUR128_META_API_TYPE, "GstEbur128Meta", sizeof(GstEbur128Meta), gst_ebur128_meta_init,
+                          gst_ebur128_meta_free, gst_ebur128_meta_transform);
+    g_once_init_leave((GstMetaInfo **)&meta_info, (GstMetaInfo *)mi);
+  }
+  return meta_info;
+}
+
+GstEbur128Meta *gst_buffer_add_ebur128_meta(GstBuffer *buffer, GstEbur128MetaFlags flags, guint channels) {
+  g_return_val_if_fail(GST_IS_BUFFER(buffer), NULL);
+
+  GstEbur128Meta *meta = (GstEbur128Meta *)gst_buffer_add_meta(buffer, GST_EBUR128_META_INFO, NULL);
+  meta->flags = flags;
+  gst_ebur128_meta_alloc_peaks(meta, channels);
+
+  return meta;
+}
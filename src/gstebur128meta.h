@@ -0,0 +1,54 @@
+#ifndef __GST_EBUR128META_H__
+#define __GST_EBUR128META_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_EBUR128_META_API_TYPE (gst_ebur128_meta_api_get_type())
+#define GST_EBUR128_META_INFO (gst_ebur128_meta_get_info())
+
+typedef enum {
+  GST_EBUR128_META_MOMENTARY = (1 << 0),
+  GST_EBUR128_META_SHORTTERM = (1 << 1),
+  GST_EBUR128_META_GLOBAL = (1 << 2),
+  GST_EBUR128_META_RANGE = (1 << 3),
+  GST_EBUR128_META_SAMPLE_PEAK = (1 << 4),
+  GST_EBUR128_META_TRUE_PEAK = (1 << 5)
+} GstEbur128MetaFlags;
+
+/**
+ * Loudness-Measurements of the ebur128 Element, attached to the Buffers it passes on.
+ *
+ * Loudness is measured up to the end of the Buffer, in LUFS (Range in LU), like the Message the Element would post at
+ * that point. Peaks are the largest absolute Samples of this Buffer by Channel (1.0 is 0 dBFS), so downstream can
+ * follow them without a Bus. Only the Measurements named in flags are set, all others are 0.
+ *
+ * The API is registered as "GstEbur128MetaAPI" when the Plugin is loaded. Code outside of the Plugin only needs this
+ * Header for the Layout and looks the API up with g_type_from_name.
+ */
+typedef struct _GstEbur128Meta GstEbur128Meta;
+struct _GstEbur128Meta {
+  GstMeta meta;
+
+  GstEbur128MetaFlags flags;
+  gdouble momentary;
+  gdouble shortterm;
+  gdouble global;
+  gdouble range;
+
+  guint channels;
+  gdouble *sample_peak;
+  gdouble *true_peak;
+};
+
+GType gst_ebur128_meta_api_get_type(void);
+const GstMetaInfo *gst_ebur128_meta_get_info(void);
+
+#define gst_buffer_get_ebur128_meta(b) ((GstEbur128Meta *)gst_buffer_get_meta((b), GST_EBUR128_META_API_TYPE))
+
+GstEbur128Meta *gst_buffer_add_ebur128_meta(GstBuffer *buffer, GstEbur128MetaFlags flags, guint channels);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128META_H__
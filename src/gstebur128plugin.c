@@ -1,5 +1,6 @@
 #include "gstebur128element.h"
 #include "gstebur128graphelement.h"
+#include "gstebur128meta.h"
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
@@ -13,6 +14,9 @@ static gboolean ebur128_plugin_init(GstPlugin *ebur128) {
   gboolean success = TRUE;
   success &= gst_element_register(ebur128, "ebur128", GST_RANK_NONE, GST_TYPE_EBUR128);
   success &= gst_element_register(ebur128, "ebur128graph", GST_RANK_NONE, GST_TYPE_EBUR128GRAPH);
+
+  // registered up front, so other plugins can look the meta up by name
+  success &= gst_ebur128_meta_get_info() != NULL;
   return success;
 }
 
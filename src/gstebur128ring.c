@@ -0,0 +1,167 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128ring.h"
+#include <string.h>
+
+struct _GstEbur128Ring {
+  // a power of two, so the free-running positions wrap around consistently
+  guint capacity;
+  gsize item_size;
+  guint8 *items;
+
+  // next item to pop, written by the consumer only, and next item to push, written by the producer only
+  guint head;
+  guint tail;
+
+  // items the consumer has finished with
+  guint done;
+  gint closed;
+  gint flushing;
+
+  // number of threads sleeping on cond, so the other side only takes the lock when it has to wake somebody
+  gint sleepers;
+  GMutex lock;
+  GCond cond;
+};
+
+typedef gboolean (*GstEbur128RingReadyFunc)(GstEbur128Ring *ring);
+
+static gboolean gst_ebur128_ring_has_space(GstEbur128Ring *ring) {
+  return (guint)g_atomic_int_get(&ring->tail) - (guint)g_atomic_int_get(&ring->head) < ring->capacity;
+}
+
+// a flushing ring no longer keeps the producer waiting for space
+static gboolean gst_ebur128_ring_can_push(GstEbur128Ring *ring) {
+  return gst_ebur128_ring_has_space(ring) || g_atomic_int_get(&ring->flushing);
+}
+
+static gboolean gst_ebur128_ring_has_items(GstEbur128Ring *ring) {
+  return g_atomic_int_get(&ring->tail) != g_atomic_int_get(&ring->head);
+}
+
+static gboolean gst_ebur128_ring_is_drained(GstEbur128Ring *ring) {
+  return g_atomic_int_get(&ring->done) == g_atomic_int_get(&ring->tail);
+}
+
+/**
+ * The sleeper registers itself before checking the condition a last time, and the waker publishes its change before
+ * checking for sleepers, so either the sleeper sees the change or the waker sees the sleeper and has to take the lock,
+ * which the sleeper only gives up inside g_cond_wait.
+ */
+static void gst_ebur128_ring_sleep(GstEbur128Ring *ring, GstEbur128RingReadyFunc ready) {
+  g_mutex_lock(&ring->lock);
+  g_atomic_int_inc(&ring->sleepers);
+  while (!ready(ring) && !g_atomic_int_get(&ring->closed)) {
+    g_cond_wait(&ring->cond, &ring->lock);
+  }
+  g_atomic_int_add(&ring->sleepers, -1);
+  g_mutex_unlock(&ring->lock);
+}
+
+static void gst_ebur128_ring_wake(GstEbur128Ring *ring) {
+  if (g_atomic_int_get(&ring->sleepers) > 0) {
+    g_mutex_lock(&ring->lock);
+    g_cond_broadcast(&ring->cond);
+    g_mutex_unlock(&ring->lock);
+  }
+}
+
+GstEbur128Ring *gst_ebur128_ring_new(guint capacity, gsize item_size) {
+  GstEbur128Ring *ring = g_new0(GstEbur128Ring, 1);
+  ring->capacity = 1;
+  while (ring->capacity < capacity && ring->capacity < G_MAXINT / 2) {
+    ring->capacity *= 2;
+  }
+  ring->item_size = item_size;
+  ring->items = g_malloc0_n(ring->capacity, item_size);
+
+  g_mutex_init(&ring->lock);
+  g_cond_init(&ring->cond);
+  return ring;
+}
+
+void gst_ebur128_ring_free(GstEbur128Ring *ring) {
+  g_mutex_clear(&ring->lock);
+  g_cond_clear(&ring->cond);
+  g_free(ring->items);
+  g_free(ring);
+}
+
+/**
+ * Copies item into the ring. When it is full this waits for the consumer if block is set and fails otherwise, as it
+ * does once the ring is closed or while it is flushing.
+ */
+gboolean gst_ebur128_ring_push(GstEbur128Ring *ring, gconstpointer item, gboolean block) {
+  while (!gst_ebur128_ring_can_push(ring)) {
+    if (!block || g_atomic_int_get(&ring->closed)) {
+      return FALSE;
+    }
+    gst_ebur128_ring_sleep(ring, gst_ebur128_ring_can_push);
+  }
+  if (g_atomic_int_get(&ring->closed) || g_atomic_int_get(&ring->flushing)) {
+    return FALSE;
+  }
+
+  guint tail = (guint)g_atomic_int_get(&ring->tail);
+  memcpy(ring->items + (tail & (ring->capacity - 1)) * ring->item_size, item, ring->item_size);
+  g_atomic_int_set(&ring->tail, tail + 1);
+
+  gst_ebur128_ring_wake(ring);
+  return TRUE;
+}
+
+/**
+ * Copies the oldest item out of the ring. When it is empty this waits for the producer if block is set and fails
+ * otherwise, as it does once the ring is closed and empty.
+ */
+gboolean gst_ebur128_ring_pop(GstEbur128Ring *ring, gpointer item, gboolean block) {
+  while (!gst_ebur128_ring_has_items(ring)) {
+    if (!block || g_atomic_int_get(&ring->closed)) {
+      return FALSE;
+    }
+    gst_ebur128_ring_sleep(ring, gst_ebur128_ring_has_items);
+  }
+
+  guint head = (guint)g_atomic_int_get(&ring->head);
+  memcpy(item, ring->items + (head & (ring->capacity - 1)) * ring->item_size, ring->item_size);
+  g_atomic_int_set(&ring->head, head + 1);
+
+  gst_ebur128_ring_wake(ring);
+  return TRUE;
+}
+
+void gst_ebur128_ring_done(GstEbur128Ring *ring) {
+  g_atomic_int_inc(&ring->done);
+  gst_ebur128_ring_wake(ring);
+}
+
+// waits until the consumer is done with every item pushed so far, must be called by the producer
+void gst_ebur128_ring_drain(GstEbur128Ring *ring) {
+  if (!gst_ebur128_ring_is_drained(ring)) {
+    gst_ebur128_ring_sleep(ring, gst_ebur128_ring_is_drained);
+  }
+}
+
+/**
+ * Makes pushing fail and wakes a producer waiting for space, may be called from any thread. The consumer keeps popping
+ * what is queued and checks gst_ebur128_ring_is_flushing to discard it instead of handling it.
+ */
+void gst_ebur128_ring_set_flushing(GstEbur128Ring *ring, gboolean flushing) {
+  g_mutex_lock(&ring->lock);
+  g_atomic_int_set(&ring->flushing, flushing);
+  g_cond_broadcast(&ring->cond);
+  g_mutex_unlock(&ring->lock);
+}
+
+gboolean gst_ebur128_ring_is_flushing(GstEbur128Ring *ring) {
+  return g_atomic_int_get(&ring->flushing);
+}
+
+void gst_ebur128_ring_close(GstEbur128Ring *ring) {
+  g_mutex_lock(&ring->lock);
+  g_atomic_int_set(&ring->closed, TRUE);
+  g_cond_broadcast(&ring->cond);
+  g_mutex_unlock(&ring->lock);
+}
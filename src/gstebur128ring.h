@@ -0,0 +1,38 @@
+#ifndef __GST_EBUR128RING_H__
+#define __GST_EBUR128RING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Bounded Single-Producer Single-Consumer Ring of fixed-size Items.
+ *
+ * Producer and Consumer only ever write their own position and publish it with an atomic store, so pushing and popping
+ * never take a lock. Only a side that has to wait for the other one, because the ring is full or empty, sleeps on a
+ * condition, and the other side only takes the lock to wake it up when somebody is actually sleeping.
+ *
+ * The Consumer reports every item it has finished with gst_ebur128_ring_done, which lets the Producer wait until
+ * everything it pushed so far has been handled. After gst_ebur128_ring_close pushing fails, popping drains what is
+ * left and then fails as well, and nobody waits any more.
+ *
+ * While the ring is flushing pushing fails as well, and the Consumer discards what it pops instead of handling it. The
+ * Producer drains the ring before it clears the flag again, so nothing queued before the flush is handled after it.
+ */
+typedef struct _GstEbur128Ring GstEbur128Ring;
+
+GstEbur128Ring *gst_ebur128_ring_new(guint capacity, gsize item_size);
+void gst_ebur128_ring_free(GstEbur128Ring *ring);
+
+gboolean gst_ebur128_ring_push(GstEbur128Ring *ring, gconstpointer item, gboolean block);
+gboolean gst_ebur128_ring_pop(GstEbur128Ring *ring, gpointer item, gboolean block);
+void gst_ebur128_ring_done(GstEbur128Ring *ring);
+
+void gst_ebur128_ring_drain(GstEbur128Ring *ring);
+void gst_ebur128_ring_set_flushing(GstEbur128Ring *ring, gboolean flushing);
+gboolean gst_ebur128_ring_is_flushing(GstEbur128Ring *ring);
+void gst_ebur128_ring_close(GstEbur128Ring *ring);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128RING_H__
@@ -5,6 +5,17 @@
 #include "gstebur128shared.h"
 #include <ebur128.h>
 
+GType gst_ebur128_gating_engine_get_type(void) {
+  static GType ebur128_gating_engine = 0;
+  static const GEnumValue gating_engines[] = {{GST_EBUR128_GATING_ENGINE_EXACT, "Exact", "exact"},
+                                              {GST_EBUR128_GATING_ENGINE_HISTOGRAM, "Histogram", "histogram"},
+                                              {0, NULL, NULL}};
+  if (!ebur128_gating_engine) {
+    ebur128_gating_engine = g_enum_register_static("GstEbur128GatingEngine", gating_engines);
+  }
+  return ebur128_gating_engine;
+}
+
 gboolean gst_ebur128_validate_lib_return(const char *invocation, const int return_value) {
   if (return_value != EBUR128_SUCCESS) {
     GST_ERROR("Error-Code %d from libebur128 call to %s", return_value, invocation);
@@ -14,37 +25,236 @@ gboolean gst_ebur128_validate_lib_return(const char *invocation, const int retur
   return TRUE;
 }
 
-gboolean gst_ebur128_add_frames(ebur128_state *state, GstAudioFormat format, guint8 *data, gint num_frames) {
+/**
+ * Maps a GStreamer channel-position to the libebur128 channel-type at the same place (ITU-R BS.2051 naming). Rear
+ * channels are the surround-pair of a 5.1 layout at +-110 degrees, unless side channels take that role as in 7.1, then
+ * they sit behind at +-135 degrees and are not weighted up. LFE channels do not contribute to the loudness.
+ */
+static int gst_ebur128_channel_type(GstAudioChannelPosition position, gboolean has_side) {
+  switch (position) {
+  case GST_AUDIO_CHANNEL_POSITION_MONO:
+  case GST_AUDIO_CHANNEL_POSITION_FRONT_CENTER:
+    return EBUR128_Mp000;
+  case GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT:
+    return EBUR128_Mp030;
+  case GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT:
+    return EBUR128_Mm030;
+  case GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT_OF_CENTER:
+    return EBUR128_MpSC;
+  case GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT_OF_CENTER:
+    return EBUR128_MmSC;
+  case GST_AUDIO_CHANNEL_POSITION_WIDE_LEFT:
+    return EBUR128_Mp060;
+  case GST_AUDIO_CHANNEL_POSITION_WIDE_RIGHT:
+    return EBUR128_Mm060;
+  case GST_AUDIO_CHANNEL_POSITION_SIDE_LEFT:
+    return EBUR128_Mp090;
+  case GST_AUDIO_CHANNEL_POSITION_SIDE_RIGHT:
+    return EBUR128_Mm090;
+  case GST_AUDIO_CHANNEL_POSITION_SURROUND_LEFT:
+    return EBUR128_Mp110;
+  case GST_AUDIO_CHANNEL_POSITION_SURROUND_RIGHT:
+    return EBUR128_Mm110;
+  case GST_AUDIO_CHANNEL_POSITION_REAR_LEFT:
+    return has_side ? EBUR128_Mp135 : EBUR128_Mp110;
+  case GST_AUDIO_CHANNEL_POSITION_REAR_RIGHT:
+    return has_side ? EBUR128_Mm135 : EBUR128_Mm110;
+  case GST_AUDIO_CHANNEL_POSITION_REAR_CENTER:
+    return EBUR128_Mp180;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_FRONT_CENTER:
+    return EBUR128_Up000;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_FRONT_LEFT:
+    return EBUR128_Up030;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_FRONT_RIGHT:
+    return EBUR128_Um030;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_SIDE_LEFT:
+    return EBUR128_Up090;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_SIDE_RIGHT:
+    return EBUR128_Um090;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_REAR_LEFT:
+    return EBUR128_Up135;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_REAR_RIGHT:
+    return EBUR128_Um135;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_REAR_CENTER:
+    return EBUR128_Up180;
+  case GST_AUDIO_CHANNEL_POSITION_TOP_CENTER:
+    return EBUR128_Tp000;
+  case GST_AUDIO_CHANNEL_POSITION_BOTTOM_FRONT_CENTER:
+    return EBUR128_Bp000;
+  case GST_AUDIO_CHANNEL_POSITION_BOTTOM_FRONT_LEFT:
+    return EBUR128_Bp045;
+  case GST_AUDIO_CHANNEL_POSITION_BOTTOM_FRONT_RIGHT:
+    return EBUR128_Bm045;
+  default:
+    // LFE1, LFE2 and silent channels
+    return EBUR128_UNUSED;
+  }
+}
+
+/**
+ * Applies the channel-positions of the caps to the state.
+ *
+ * Unpositioned layouts of up to 6 channels keep the default channel-map of libebur128, which assumes the channels of a
+ * 5.1 layout and leaves the 4th channel as LFE out. The default map knows nothing beyond that, so every channel of a
+ * wider unpositioned layout is measured with a weight of 1.0 instead of dropping all but the first 5.
+ */
+gboolean gst_ebur128_set_channel_map(GstEbur128State *state, const GstAudioInfo *audio_info) {
+  gint channels = GST_AUDIO_INFO_CHANNELS(audio_info);
+  if (GST_AUDIO_INFO_IS_UNPOSITIONED(audio_info) || channels > 64) {
+    if (channels <= 6) {
+      GST_DEBUG("Unpositioned Layout, using the default channel-map");
+      return TRUE;
+    }
+
+    GST_INFO("Unpositioned Layout of %d channels, measuring all of them with a weight of 1.0", channels);
+    gboolean success = TRUE;
+    for (gint channel = 0; channel < channels; channel++) {
+      int ret = gst_ebur128_state_set_channel(state, channel, EBUR128_CENTER);
+      success &= gst_ebur128_validate_lib_return("ebur128_set_channel", ret);
+    }
+    return success;
+  }
+
+  gboolean has_side = FALSE;
+  for (gint channel = 0; channel < channels; channel++) {
+    GstAudioChannelPosition position = GST_AUDIO_INFO_POSITION(audio_info, channel);
+    has_side |= position == GST_AUDIO_CHANNEL_POSITION_SIDE_LEFT || position == GST_AUDIO_CHANNEL_POSITION_SIDE_RIGHT;
+  }
+
+  gboolean success = TRUE;
+  for (gint channel = 0; channel < channels; channel++) {
+    GstAudioChannelPosition position = GST_AUDIO_INFO_POSITION(audio_info, channel);
+    int type = gst_ebur128_channel_type(position, has_side);
+    GST_DEBUG("Channel %d at position %d is libebur128 channel-type %d", channel, position, type);
+
+    int ret = gst_ebur128_state_set_channel(state, channel, type);
+    success &= gst_ebur128_validate_lib_return("ebur128_set_channel", ret);
+  }
+
+  return success;
+}
+
+/**
+ * Whether a state set up for the caps of a can analyze those of b as it is: the sample-rate and the channels with their
+ * positions are the same, only the sample-format may differ.
+ */
+gboolean gst_ebur128_same_layout(const GstAudioInfo *a, const GstAudioInfo *b) {
+  gint channels = GST_AUDIO_INFO_CHANNELS(a);
+  if (GST_AUDIO_INFO_RATE(a) != GST_AUDIO_INFO_RATE(b) || channels != GST_AUDIO_INFO_CHANNELS(b) ||
+      GST_AUDIO_INFO_IS_UNPOSITIONED(a) != GST_AUDIO_INFO_IS_UNPOSITIONED(b)) {
+    return FALSE;
+  }
+
+  for (gint channel = 0; channel < MIN(channels, 64); channel++) {
+    if (GST_AUDIO_INFO_POSITION(a, channel) != GST_AUDIO_INFO_POSITION(b, channel)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// formats stored in the opposite byte-order of the host
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define GST_EBUR128_AUDIO_FORMAT_OE(format) GST_AUDIO_FORMAT_##format##BE
+#else
+#define GST_EBUR128_AUDIO_FORMAT_OE(format) GST_AUDIO_FORMAT_##format##LE
+#endif
+
+static gboolean gst_ebur128_sample_format(GstAudioFormat format, GstEbur128SampleFormat *sample_format) {
+  switch (format) {
+  case GST_EBUR128_AUDIO_FORMAT_OE(S16):
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_S16_SWAPPED;
+    return TRUE;
+  case GST_EBUR128_AUDIO_FORMAT_OE(S32):
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_S32_SWAPPED;
+    return TRUE;
+  case GST_EBUR128_AUDIO_FORMAT_OE(F32):
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_F32_SWAPPED;
+    return TRUE;
+  case GST_EBUR128_AUDIO_FORMAT_OE(F64):
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_F64_SWAPPED;
+    return TRUE;
+  case GST_AUDIO_FORMAT_S24:
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_S24;
+    return TRUE;
+  case GST_EBUR128_AUDIO_FORMAT_OE(S24):
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_S24_SWAPPED;
+    return TRUE;
+  case GST_AUDIO_FORMAT_S24_32:
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_S24_32;
+    return TRUE;
+  case GST_EBUR128_AUDIO_FORMAT_OE(S24_32):
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_S24_32_SWAPPED;
+    return TRUE;
+  case GST_AUDIO_FORMAT_U8:
+    *sample_format = GST_EBUR128_SAMPLE_FORMAT_U8;
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+/**
+ * Adds num_frames frames starting at frame offset of the mapped buffer. Planar buffers are read from their planes in
+ * place, without interleaving them first. Native-endian S16, S32, F32 and F64 are read as they are, every other
+ * supported format is converted in scratch-sized chunks while it is read, so no converter is needed in front.
+ */
+gboolean gst_ebur128_add_frames(GstEbur128State *state, GstAudioBuffer *buffer, gsize offset, gsize num_frames) {
   gboolean success = TRUE;
   int ret;
 
-  GST_DEBUG("Adding %u frames to libebur128 at %p", num_frames, data);
+  GstAudioFormat format = GST_AUDIO_INFO_FORMAT(&buffer->info);
+  gboolean planar = GST_AUDIO_INFO_LAYOUT(&buffer->info) == GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+  const guint8 *data = (const guint8 *)buffer->planes[0] + offset * GST_AUDIO_INFO_BPF(&buffer->info);
+  GstEbur128SampleFormat sample_format;
+
+  GST_DEBUG("Adding %" G_GSIZE_FORMAT " frames at offset %" G_GSIZE_FORMAT " of %s %s buffer", num_frames, offset,
+            planar ? "planar" : "interleaved", gst_audio_format_to_string(format));
 
   switch (format) {
-  case GST_AUDIO_FORMAT_S16LE:
-  case GST_AUDIO_FORMAT_S16BE:
-    ret = ebur128_add_frames_short(state, (const short *)data, num_frames);
-    success &= gst_ebur128_validate_lib_return("ebur128_add_frames_short", ret);
+  case GST_AUDIO_FORMAT_S16:
+    if (planar) {
+      ret = gst_ebur128_state_add_frames_planar_short(state, (const short *const *)buffer->planes, offset, num_frames);
+    } else {
+      ret = gst_ebur128_state_add_frames_short(state, (const short *)data, num_frames);
+    }
+    success &= gst_ebur128_validate_lib_return("gst_ebur128_state_add_frames_short", ret);
     break;
-  case GST_AUDIO_FORMAT_S32LE:
-  case GST_AUDIO_FORMAT_S32BE:
-    ret = ebur128_add_frames_int(state, (const int *)data, num_frames);
-    success &= gst_ebur128_validate_lib_return("ebur128_add_frames_int", ret);
+  case GST_AUDIO_FORMAT_S32:
+    if (planar) {
+      ret = gst_ebur128_state_add_frames_planar_int(state, (const int *const *)buffer->planes, offset, num_frames);
+    } else {
+      ret = gst_ebur128_state_add_frames_int(state, (const int *)data, num_frames);
+    }
+    success &= gst_ebur128_validate_lib_return("gst_ebur128_state_add_frames_int", ret);
     break;
-  case GST_AUDIO_FORMAT_F32LE:
-  case GST_AUDIO_FORMAT_F32BE:
-    ret = ebur128_add_frames_float(state, (const float *)data, num_frames);
-
-    success &= gst_ebur128_validate_lib_return("ebur128_add_frames_float", ret);
+  case GST_AUDIO_FORMAT_F32:
+    if (planar) {
+      ret = gst_ebur128_state_add_frames_planar_float(state, (const float *const *)buffer->planes, offset, num_frames);
+    } else {
+      ret = gst_ebur128_state_add_frames_float(state, (const float *)data, num_frames);
+    }
+    success &= gst_ebur128_validate_lib_return("gst_ebur128_state_add_frames_float", ret);
     break;
-  case GST_AUDIO_FORMAT_F64LE:
-  case GST_AUDIO_FORMAT_F64BE:
-    ret = ebur128_add_frames_double(state, (const double *)data, num_frames);
-    success &= gst_ebur128_validate_lib_return("ebur128_add_frames_double", ret);
+  case GST_AUDIO_FORMAT_F64:
+    if (planar) {
+      const double *const *planes = (const double *const *)buffer->planes;
+      ret = gst_ebur128_state_add_frames_planar_double(state, planes, offset, num_frames);
+    } else {
+      ret = gst_ebur128_state_add_frames_double(state, (const double *)data, num_frames);
+    }
+    success &= gst_ebur128_validate_lib_return("gst_ebur128_state_add_frames_double", ret);
     break;
   default:
-    GST_ERROR("Unhandled Audio-Format: %s", gst_audio_format_to_string(format));
-    success = FALSE;
+    if (!gst_ebur128_sample_format(format, &sample_format)) {
+      GST_ERROR("Unhandled Audio-Format: %s", gst_audio_format_to_string(format));
+      success = FALSE;
+      break;
+    }
+
+    ret = gst_ebur128_state_add_frames_converted(state, sample_format, (const gconstpointer *)buffer->planes, planar,
+                                                 offset, num_frames);
+    success &= gst_ebur128_validate_lib_return("gst_ebur128_state_add_frames_converted", ret);
   }
 
   return success;
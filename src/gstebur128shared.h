@@ -1,12 +1,19 @@
 #ifndef __GST_EBUR128SHARED_H__
 #define __GST_EBUR128SHARED_H__
 
+#include "gstebur128state.h"
 #include <ebur128.h>
 #include <gst/audio/audio.h>
 #include <gst/gst.h>
 
+#define GST_TYPE_EBUR128_GATING_ENGINE (gst_ebur128_gating_engine_get_type())
+GType gst_ebur128_gating_engine_get_type(void);
+
 gboolean gst_ebur128_validate_lib_return(const char *invocation, const int return_value);
 
-gboolean gst_ebur128_add_frames(ebur128_state *state, GstAudioFormat format, guint8 *data, gint num_frames);
+gboolean gst_ebur128_set_channel_map(GstEbur128State *state, const GstAudioInfo *audio_info);
+gboolean gst_ebur128_same_layout(const GstAudioInfo *a, const GstAudioInfo *b);
+
+gboolean gst_ebur128_add_frames(GstEbur128State *state, GstAudioBuffer *buffer, gsize offset, gsize num_frames);
 
 #endif // __GST_EBUR128SHARED_H__
@@ -0,0 +1,313 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128shm.h"
+#include "gstebur128fence.h"
+#include <errno.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// header and slots are aligned to cache-lines, so readers of one slot do not share a line with the writer of the next
+#define GST_EBUR128_SHM_ALIGNMENT 64
+#define GST_EBUR128_SHM_ALIGN(size) (((size) + GST_EBUR128_SHM_ALIGNMENT - 1) & ~(gsize)(GST_EBUR128_SHM_ALIGNMENT - 1))
+
+struct _GstEbur128ShmWriter {
+  gchar *name;
+  guint8 *data;
+  gsize size;
+  GstEbur128ShmHeader *header;
+
+  // index of the next record, only the writer changes it
+  guint32 sequence;
+};
+
+struct _GstEbur128ShmReader {
+  guint8 *data;
+  gsize size;
+  const GstEbur128ShmHeader *header;
+
+  // copy of the header as it was checked when opening, slots are only ever located with it
+  GstEbur128ShmHeader layout;
+
+  guint32 next;
+  gboolean peeked;
+  guint64 lost;
+};
+
+static gint32 *gst_ebur128_shm_slot_sequence(guint8 *data, const GstEbur128ShmHeader *header, guint32 index) {
+  return (gint32 *)(data + header->header_size + (gsize)(index & (header->capacity - 1)) * header->slot_size);
+}
+
+static GstEbur128MeasurementRecord *gst_ebur128_shm_slot_record(guint8 *data, const GstEbur128ShmHeader *header,
+                                                                guint32 index) {
+  return (GstEbur128MeasurementRecord *)((guint8 *)gst_ebur128_shm_slot_sequence(data, header, index) +
+                                         GST_EBUR128_SHM_RECORD_OFFSET);
+}
+
+#ifdef G_OS_UNIX
+
+static void gst_ebur128_shm_set_error(GError **error, const gchar *what, const gchar *name) {
+  int errsv = errno;
+  g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errsv), "could not %s shared memory %s: %s", what, name,
+              g_strerror(errsv));
+}
+
+/**
+ * Creates a fresh segment, replacing whatever had this name before. Readers of a previous segment keep their mapping,
+ * which stays valid after the name has been unlinked.
+ */
+GstEbur128ShmWriter *gst_ebur128_shm_writer_new(const gchar *name, guint capacity, guint channels, guint num_windows,
+                                                GError **error) {
+  g_return_val_if_fail(name != NULL, NULL);
+
+  guint32 ring_capacity = 1;
+  while (ring_capacity < capacity && ring_capacity < G_MAXINT / 4) {
+    ring_capacity *= 2;
+  }
+
+  gsize record_size = GST_EBUR128_MEASUREMENT_SIZE(channels, num_windows);
+  gsize header_size = GST_EBUR128_SHM_ALIGN(sizeof(GstEbur128ShmHeader));
+  gsize slot_size = GST_EBUR128_SHM_ALIGN(GST_EBUR128_SHM_RECORD_OFFSET + record_size);
+  gsize size = header_size + ring_capacity * slot_size;
+
+  shm_unlink(name);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    gst_ebur128_shm_set_error(error, "create", name);
+    return NULL;
+  }
+
+  if (ftruncate(fd, size) != 0) {
+    gst_ebur128_shm_set_error(error, "size", name);
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  guint8 *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    gst_ebur128_shm_set_error(error, "map", name);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  GstEbur128ShmWriter *writer = g_new0(GstEbur128ShmWriter, 1);
+  writer->name = g_strdup(name);
+  writer->data = data;
+  writer->size = size;
+  writer->header = (GstEbur128ShmHeader *)data;
+
+  // the segment is zero-filled by ftruncate, so all slots start out as never written
+  GstEbur128ShmHeader *header = writer->header;
+  header->version = GST_EBUR128_SHM_VERSION;
+  header->header_size = header_size;
+  header->slot_size = slot_size;
+  header->record_size = record_size;
+  header->capacity = ring_capacity;
+  header->channels = channels;
+  header->num_windows = num_windows;
+
+  gst_ebur128_fence();
+  g_atomic_int_set((gint *)&header->magic, GST_EBUR128_SHM_MAGIC);
+  return writer;
+}
+
+void gst_ebur128_shm_writer_free(GstEbur128ShmWriter *writer) {
+  g_atomic_int_set(&writer->header->closed, TRUE);
+  shm_unlink(writer->name);
+  munmap(writer->data, writer->size);
+  g_free(writer->name);
+  g_free(writer);
+}
+
+static void gst_ebur128_shm_reader_unmap(GstEbur128ShmReader *reader) {
+  munmap(reader->data, reader->size);
+}
+
+/**
+ * Maps an existing segment read-only. With from_oldest the reader starts at the oldest record still in the ring,
+ * otherwise at the next one that is going to be written.
+ */
+GstEbur128ShmReader *gst_ebur128_shm_reader_open(const gchar *name, gboolean from_oldest, GError **error) {
+  g_return_val_if_fail(name != NULL, NULL);
+
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    gst_ebur128_shm_set_error(error, "open", name);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    gst_ebur128_shm_set_error(error, "stat", name);
+    close(fd);
+    return NULL;
+  }
+
+  if ((gsize)st.st_size < sizeof(GstEbur128ShmHeader)) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_AGAIN, "shared memory %s is not initialized yet", name);
+    close(fd);
+    return NULL;
+  }
+
+  guint8 *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    gst_ebur128_shm_set_error(error, "map", name);
+    return NULL;
+  }
+
+  GstEbur128ShmReader *reader = g_new0(GstEbur128ShmReader, 1);
+  reader->data = data;
+  reader->size = st.st_size;
+  reader->header = (const GstEbur128ShmHeader *)data;
+
+  const GstEbur128ShmHeader *header = reader->header;
+  if ((guint32)g_atomic_int_get((gint *)&header->magic) != GST_EBUR128_SHM_MAGIC) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_AGAIN, "shared memory %s is not initialized yet", name);
+    gst_ebur128_shm_reader_close(reader);
+    return NULL;
+  }
+
+  // slots are indexed with capacity - 1 as mask and read as far as the channels and windows of the records reach, so a
+  // truncated or foreign segment must not get past here
+  gst_ebur128_fence();
+  if (header->version != GST_EBUR128_SHM_VERSION || header->capacity == 0 ||
+      (header->capacity & (header->capacity - 1)) != 0 || header->header_size < sizeof(GstEbur128ShmHeader) ||
+      header->header_size % GST_EBUR128_SHM_ALIGNMENT != 0 || header->slot_size % GST_EBUR128_SHM_ALIGNMENT != 0 ||
+      header->header_size + (gsize)header->capacity * header->slot_size > reader->size ||
+      GST_EBUR128_SHM_RECORD_OFFSET + (gsize)header->record_size > header->slot_size ||
+      GST_EBUR128_MEASUREMENT_SIZE(header->channels, header->num_windows) > header->record_size) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "shared memory %s has an unsupported layout (version %u)",
+                name, header->version);
+    gst_ebur128_shm_reader_close(reader);
+    return NULL;
+  }
+  reader->layout = *header;
+
+  guint32 sequence = g_atomic_int_get((gint *)&header->sequence);
+  reader->next = sequence;
+  if (from_oldest) {
+    reader->next = sequence - MIN(sequence, header->capacity);
+  }
+  return reader;
+}
+
+#else // G_OS_UNIX
+
+GstEbur128ShmWriter *gst_ebur128_shm_writer_new(const gchar *name, guint capacity, guint channels, guint num_windows,
+                                                GError **error) {
+  g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_NOSYS, "shared memory is not supported on this platform");
+  return NULL;
+}
+
+void gst_ebur128_shm_writer_free(GstEbur128ShmWriter *writer) {}
+
+static void gst_ebur128_shm_reader_unmap(GstEbur128ShmReader *reader) {}
+
+GstEbur128ShmReader *gst_ebur128_shm_reader_open(const gchar *name, gboolean from_oldest, GError **error) {
+  g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_NOSYS, "shared memory is not supported on this platform");
+  return NULL;
+}
+
+#endif // G_OS_UNIX
+
+gboolean gst_ebur128_shm_writer_matches(GstEbur128ShmWriter *writer, const gchar *name, guint channels,
+                                        guint num_windows) {
+  return g_strcmp0(writer->name, name) == 0 && writer->header->channels == channels &&
+         writer->header->num_windows == num_windows;
+}
+
+// returns the slot of the next record to be filled in place, which readers skip until it is committed
+GstEbur128MeasurementRecord *gst_ebur128_shm_writer_begin(GstEbur128ShmWriter *writer) {
+  gint32 *slot_sequence = gst_ebur128_shm_slot_sequence(writer->data, writer->header, writer->sequence);
+  g_atomic_int_set(slot_sequence, (gint32)(2 * writer->sequence + 1));
+  gst_ebur128_fence();
+
+  return gst_ebur128_shm_slot_record(writer->data, writer->header, writer->sequence);
+}
+
+void gst_ebur128_shm_writer_commit(GstEbur128ShmWriter *writer) {
+  gint32 *slot_sequence = gst_ebur128_shm_slot_sequence(writer->data, writer->header, writer->sequence);
+  gst_ebur128_fence();
+  g_atomic_int_set(slot_sequence, (gint32)(2 * writer->sequence + 2));
+
+  writer->sequence++;
+  g_atomic_int_set(&writer->header->sequence, (gint32)writer->sequence);
+}
+
+void gst_ebur128_shm_reader_close(GstEbur128ShmReader *reader) {
+  gst_ebur128_shm_reader_unmap(reader);
+  g_free(reader);
+}
+
+// the layout as checked when opening, sequence and closed are only those of that moment
+const GstEbur128ShmHeader *gst_ebur128_shm_reader_get_header(GstEbur128ShmReader *reader) {
+  return &reader->layout;
+}
+
+/**
+ * Returns the next record or NULL if there is none yet. The record stays readable in place until the next
+ * gst_ebur128_shm_reader_release.
+ */
+const GstEbur128MeasurementRecord *gst_ebur128_shm_reader_peek(GstEbur128ShmReader *reader) {
+  const GstEbur128ShmHeader *layout = &reader->layout;
+
+  while (TRUE) {
+    guint32 sequence = g_atomic_int_get((gint *)&reader->header->sequence);
+    guint32 available = sequence - reader->next;
+    if (available == 0) {
+      return NULL;
+    }
+
+    if (available > layout->capacity) {
+      reader->lost += available - layout->capacity;
+      reader->next = sequence - layout->capacity;
+    }
+
+    // a record before sequence is complete, unless the writer lapped the reader since the sequence was read
+    guint32 slot_sequence = g_atomic_int_get(gst_ebur128_shm_slot_sequence(reader->data, layout, reader->next));
+    if (slot_sequence == 2 * reader->next + 2) {
+      gst_ebur128_fence();
+      reader->peeked = TRUE;
+      return gst_ebur128_shm_slot_record(reader->data, layout, reader->next);
+    }
+
+    reader->lost++;
+    reader->next++;
+  }
+}
+
+/**
+ * Moves on to the next record and returns whether the peeked one was still intact, otherwise everything read from it
+ * has to be discarded and it counts as lost.
+ */
+gboolean gst_ebur128_shm_reader_release(GstEbur128ShmReader *reader) {
+  g_return_val_if_fail(reader->peeked, FALSE);
+
+  gst_ebur128_fence();
+  guint32 slot_sequence = g_atomic_int_get(gst_ebur128_shm_slot_sequence(reader->data, &reader->layout, reader->next));
+  gboolean intact = slot_sequence == 2 * reader->next + 2;
+
+  reader->lost += intact ? 0 : 1;
+  reader->next++;
+  reader->peeked = FALSE;
+  return intact;
+}
+
+// a closed segment gets no more records, the writer has moved on to a new one under the same name
+gboolean gst_ebur128_shm_reader_is_closed(GstEbur128ShmReader *reader) {
+  return g_atomic_int_get((gint *)&reader->header->closed);
+}
+
+guint64 gst_ebur128_shm_reader_get_lost(GstEbur128ShmReader *reader) {
+  return reader->lost;
+}
@@ -0,0 +1,76 @@
+#ifndef __GST_EBUR128SHM_H__
+#define __GST_EBUR128SHM_H__
+
+#include "gstebur128measurement.h"
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+// "EBUR" in a little-endian dump
+#define GST_EBUR128_SHM_MAGIC 0x52554245
+#define GST_EBUR128_SHM_VERSION 1
+
+/**
+ * Shared-Memory Ring of Measurement-Records, written by one ebur128 Element with shm-name set and read by any number
+ * of local Processes.
+ *
+ * The Segment starts with this Header, followed by capacity Slots of slot_size Bytes at header_size. Each Slot holds
+ * its sequence followed by one GstEbur128MeasurementRecord of record_size Bytes at an offset of 8. The Record with
+ * index i is written to Slot i % capacity, whose sequence is 2 * i + 1 while it is being written and 2 * i + 2 once it
+ * is complete. sequence in the Header is the number of Records written so far. Sequences are 32 bit and wrap around.
+ *
+ * The Layout of a Segment never changes. When the Channels or Windows change, or the Element stops, the Writer sets
+ * closed and unlinks the Segment, and creates a new one under the same name for the next Record. Readers that see
+ * closed open the name again.
+ */
+typedef struct _GstEbur128ShmHeader GstEbur128ShmHeader;
+struct _GstEbur128ShmHeader {
+  // written last, once the rest of the Header is valid
+  guint32 magic;
+  guint32 version;
+
+  guint32 header_size;
+  guint32 slot_size;
+  guint32 record_size;
+  guint32 capacity;
+  guint32 channels;
+  guint32 num_windows;
+
+  gint32 sequence;
+  gint32 closed;
+};
+
+#define GST_EBUR128_SHM_RECORD_OFFSET 8
+
+typedef struct _GstEbur128ShmWriter GstEbur128ShmWriter;
+
+GstEbur128ShmWriter *gst_ebur128_shm_writer_new(const gchar *name, guint capacity, guint channels, guint num_windows,
+                                                GError **error);
+void gst_ebur128_shm_writer_free(GstEbur128ShmWriter *writer);
+gboolean gst_ebur128_shm_writer_matches(GstEbur128ShmWriter *writer, const gchar *name, guint channels,
+                                        guint num_windows);
+
+GstEbur128MeasurementRecord *gst_ebur128_shm_writer_begin(GstEbur128ShmWriter *writer);
+void gst_ebur128_shm_writer_commit(GstEbur128ShmWriter *writer);
+
+/**
+ * Reader of a Shared-Memory Ring, used from one Thread.
+ *
+ * Records are read in place: gst_ebur128_shm_reader_peek returns the next Record, which stays readable until
+ * gst_ebur128_shm_reader_release, which tells whether the Writer overwrote it in the meantime. Readers that fall behind
+ * by more than the capacity skip to the oldest Record still in the Ring and count the ones they missed as lost.
+ */
+typedef struct _GstEbur128ShmReader GstEbur128ShmReader;
+
+GstEbur128ShmReader *gst_ebur128_shm_reader_open(const gchar *name, gboolean from_oldest, GError **error);
+void gst_ebur128_shm_reader_close(GstEbur128ShmReader *reader);
+
+const GstEbur128ShmHeader *gst_ebur128_shm_reader_get_header(GstEbur128ShmReader *reader);
+const GstEbur128MeasurementRecord *gst_ebur128_shm_reader_peek(GstEbur128ShmReader *reader);
+gboolean gst_ebur128_shm_reader_release(GstEbur128ShmReader *reader);
+gboolean gst_ebur128_shm_reader_is_closed(GstEbur128ShmReader *reader);
+guint64 gst_ebur128_shm_reader_get_lost(GstEbur128ShmReader *reader);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128SHM_H__
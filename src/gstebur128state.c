@@ -0,0 +1,1165 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128state.h"
+#include "gstebur128checkpoint.h"
+#include <math.h>
+#include <string.h>
+
+// size of the conversion scratch-buffer, small enough to stay in L1 together with the filter-state
+#define SCRATCH_BYTES (16 * 1024)
+
+// the lowest rate an analysis-rate may decimate to, everything below would cut into the audible band
+#define MIN_ANALYSIS_RATE 44100
+#define MAX_DECIMATION 16
+
+#define MOMENTARY_BLOCKS 4
+#define SHORTTERM_BLOCKS 30
+
+// gating-blocks quieter than -70 LUFS never take part in the integrated loudness, relative gate is at -10 LU
+#define ABSOLUTE_GATE_ENERGY 1.1724653045822981e-7
+#define RELATIVE_GATE_FACTOR 0.1
+
+// a horizon is summed from this many periods, so it overshoots by at most 1/24th
+#define HORIZON_PERIODS 24
+
+// gating-sets contained in a checkpoint
+#define CHECKPOINT_GATING (1 << 0)
+#define CHECKPOINT_RANGE_GATING (1 << 1)
+#define CHECKPOINT_HORIZON (1 << 2)
+
+// short-term blocks for the loudness-range are taken every 1s and gated 20 LU below their mean
+#define RANGE_BLOCK_STEP 10
+#define RANGE_RELATIVE_GATE_FACTOR 0.01
+
+/**
+ * libebur128 keeps at least 400ms (3s with LRA) of history, a gating-block per 100ms and a short-term block per 3s of
+ * it. A history that outlasts every stream is kept unlimited instead of preallocating for it.
+ */
+static gulong gst_ebur128_state_clamped_history(GstEbur128State *state) {
+  gulong history = state->max_history;
+  if ((state->mode & EBUR128_MODE_LRA) == EBUR128_MODE_LRA) {
+    history = MAX(history, 3000);
+  } else {
+    history = MAX(history, 400);
+  }
+  return history;
+}
+
+static guint64 gst_ebur128_state_history_blocks(GstEbur128State *state, gulong block_ms) {
+  guint64 blocks = gst_ebur128_state_clamped_history(state) / block_ms;
+  return blocks >= G_MAXUINT32 ? 0 : blocks;
+}
+
+/**
+ * Weight of a libebur128 channel-type as applied by libebur128 when summing a gating-block: the surround-positions
+ * between 60 and 110 degrees are weighted with 1.41, dual-mono with 2.0 and unused channels are skipped.
+ */
+static gdouble gst_ebur128_state_channel_weight(int value) {
+  switch (value) {
+  case EBUR128_UNUSED:
+    return 0.0;
+  case EBUR128_Mp110:
+  case EBUR128_Mm110:
+  case EBUR128_Mp060:
+  case EBUR128_Mm060:
+  case EBUR128_Mp090:
+  case EBUR128_Mm090:
+    return 1.41;
+  case EBUR128_DUAL_MONO:
+    return 2.0;
+  default:
+    return 1.0;
+  }
+}
+
+/**
+ * Default channel-map of libebur128: L, R, LS, RS for four channels, L, R, C, LS, RS for five and L, R, C, unused,
+ * LS, RS for everything else, further channels are unused.
+ */
+static void gst_ebur128_state_init_channel_map(GstEbur128State *state) {
+  for (guint channel = 0; channel < state->channels; channel++) {
+    int value;
+    if (state->channels == 4) {
+      value = channel < 2 ? EBUR128_LEFT + (int)channel : EBUR128_LEFT_SURROUND + (int)channel - 2;
+    } else if (state->channels == 5) {
+      value = channel < 3 ? EBUR128_LEFT + (int)channel : EBUR128_LEFT_SURROUND + (int)channel - 3;
+    } else if (channel < 3) {
+      value = EBUR128_LEFT + (int)channel;
+    } else if (channel == 4 || channel == 5) {
+      value = EBUR128_LEFT_SURROUND + (int)channel - 4;
+    } else {
+      value = EBUR128_UNUSED;
+    }
+    state->channel_map[channel] = value;
+  }
+}
+
+// rate the K-Weighting and all loudness-blocks run at, the peaks always run at the native samplerate
+static gulong gst_ebur128_state_filter_rate(GstEbur128State *state) { return state->samplerate / state->decimation; }
+
+// sized after scratch_frames, every channel has a lane of its own; only runs with EBUR128_MODE_TRUE_PEAK
+static void gst_ebur128_state_setup_truepeak(GstEbur128State *state) {
+  g_clear_pointer(&state->truepeak, gst_ebur128_truepeak_free);
+  g_clear_pointer(&state->peak_scratch, g_free);
+
+  if ((state->mode & EBUR128_MODE_TRUE_PEAK) == EBUR128_MODE_TRUE_PEAK) {
+    state->truepeak = gst_ebur128_truepeak_new(state->channels, state->samplerate, state->scratch_frames);
+    state->peak_stride = gst_ebur128_truepeak_get_stride(state->truepeak);
+    state->peak_scratch = g_new0(gdouble, state->scratch_frames * state->peak_stride);
+  }
+}
+
+/**
+ * Assigns a filter-lane to every channel that contributes to the loudness, unused channels get none and are never
+ * converted or filtered. Re-creates the filter, so any sub-block in progress is lost.
+ */
+static void gst_ebur128_state_setup_lanes(GstEbur128State *state) {
+  guint lanes = 0;
+  for (guint channel = 0; channel < state->channels; channel++) {
+    gboolean used = gst_ebur128_state_channel_weight(state->channel_map[channel]) > 0.0;
+    state->channel_lane[channel] = used ? (gint)lanes++ : -1;
+  }
+
+  if (state->kweighting != NULL) {
+    gst_ebur128_kweighting_free(state->kweighting);
+  }
+
+  // without any used channel a single silent lane keeps the filter and the energy-accounting alive
+  state->kweighting = gst_ebur128_kweighting_new(MAX(lanes, 1), gst_ebur128_state_filter_rate(state));
+  state->stride = gst_ebur128_kweighting_get_stride(state->kweighting);
+  for (guint channel = 0; channel < state->channels; channel++) {
+    if (state->channel_lane[channel] >= 0) {
+      gst_ebur128_kweighting_set_channel_weight(state->kweighting, state->channel_lane[channel],
+                                                gst_ebur128_state_channel_weight(state->channel_map[channel]));
+    }
+  }
+  if (lanes == 0) {
+    gst_ebur128_kweighting_set_channel_weight(state->kweighting, 0, 0.0);
+  }
+
+  g_free(state->scratch);
+  state->scratch_frames = MAX(64, SCRATCH_BYTES / (state->stride * sizeof(gdouble)));
+  state->scratch = g_new0(gdouble, state->scratch_frames * state->stride);
+
+  gst_ebur128_state_setup_truepeak(state);
+
+  // works in the lanes of the filter, so it follows its stride
+  g_clear_pointer(&state->decimator, gst_ebur128_decimator_free);
+  if (state->decimation > 1) {
+    state->decimator = gst_ebur128_decimator_new(state->decimation, state->stride, state->scratch_frames);
+  }
+}
+
+static void gst_ebur128_state_free_gating(GstEbur128State *state) {
+  g_clear_pointer(&state->gating, gst_ebur128_gating_free);
+  g_clear_pointer(&state->range_gating, gst_ebur128_gating_free);
+}
+
+static GstEbur128Gating *gst_ebur128_state_new_gating(GstEbur128State *state, gulong block_ms) {
+  if (state->gating_engine == GST_EBUR128_GATING_ENGINE_HISTOGRAM) {
+    return gst_ebur128_gating_new_histogram();
+  }
+  return gst_ebur128_gating_new(gst_ebur128_state_history_blocks(state, block_ms));
+}
+
+static void gst_ebur128_state_create_gating(GstEbur128State *state) {
+  if ((state->mode & EBUR128_MODE_I) == EBUR128_MODE_I) {
+    state->gating = gst_ebur128_state_new_gating(state, 100);
+  }
+  if ((state->mode & EBUR128_MODE_LRA) == EBUR128_MODE_LRA) {
+    state->range_gating = gst_ebur128_state_new_gating(state, 3000);
+  }
+}
+
+static void gst_ebur128_state_free_horizon(GstEbur128State *state) {
+  if (state->horizon_periods != NULL) {
+    for (guint i = 0; i <= HORIZON_PERIODS; i++) {
+      gst_ebur128_gating_free(state->horizon_periods[i]);
+    }
+  }
+  g_clear_pointer(&state->horizon_periods, g_free);
+  g_clear_pointer(&state->horizon_gating, gst_ebur128_gating_free);
+}
+
+GstEbur128State *gst_ebur128_state_new(guint channels, gulong samplerate, gint mode) {
+  if (channels == 0 || samplerate < 16) {
+    return NULL;
+  }
+
+  GstEbur128State *state = g_new0(GstEbur128State, 1);
+  state->mode = mode;
+  state->channels = channels;
+  state->samplerate = samplerate;
+  state->max_history = ULONG_MAX;
+  state->decimation = 1;
+
+  state->planes = g_new0(gconstpointer, channels);
+  state->channel_map = g_new0(int, channels);
+  state->channel_lane = g_new0(gint, channels);
+  gst_ebur128_state_init_channel_map(state);
+  gst_ebur128_state_setup_lanes(state);
+
+  // same rounding as libebur128 uses for its samples_in_100ms
+  state->frames_per_block = (samplerate + 5) / 10;
+
+  state->sample_peak = g_new0(gdouble, channels);
+  state->prev_sample_peak = g_new0(gdouble, channels);
+  state->true_peak = g_new0(gdouble, channels);
+  state->prev_true_peak = g_new0(gdouble, channels);
+  state->true_peak_bound = g_new0(gdouble, channels);
+
+  state->gating_engine = GST_EBUR128_GATING_ENGINE_EXACT;
+  gst_ebur128_state_create_gating(state);
+
+  return state;
+}
+
+void gst_ebur128_state_destroy(GstEbur128State **state) {
+  GstEbur128State *s = *state;
+  if (s == NULL) {
+    return;
+  }
+
+  gst_ebur128_state_free_gating(s);
+  gst_ebur128_state_free_horizon(s);
+  if (s->history != NULL) {
+    gst_ebur128_history_free(s->history);
+  }
+
+  if (s->decimator != NULL) {
+    gst_ebur128_decimator_free(s->decimator);
+  }
+  if (s->truepeak != NULL) {
+    gst_ebur128_truepeak_free(s->truepeak);
+  }
+
+  gst_ebur128_kweighting_free(s->kweighting);
+  g_free(s->scratch);
+  g_free(s->planes);
+  g_free(s->peak_scratch);
+  g_free(s->channel_map);
+  g_free(s->channel_lane);
+  g_free(s->sample_peak);
+  g_free(s->prev_sample_peak);
+  g_free(s->true_peak);
+  g_free(s->prev_true_peak);
+  g_free(s->true_peak_bound);
+  g_free(s);
+
+  *state = NULL;
+}
+
+/**
+ * Number of complete sub-blocks needed to cover window milliseconds behind the sub-block in progress.
+ */
+static guint gst_ebur128_state_window_blocks(GstEbur128State *state, gulong window) {
+  guint64 frames = (guint64)gst_ebur128_state_filter_rate(state) * window / 1000;
+  if (frames <= state->block_frames) {
+    return 0;
+  }
+  return (guint)((frames - state->block_frames + state->frames_per_block - 1) / state->frames_per_block);
+}
+
+int gst_ebur128_state_set_channel(GstEbur128State *state, unsigned int channel_number, int value) {
+  if (channel_number >= state->channels) {
+    return EBUR128_ERROR_INVALID_CHANNEL_INDEX;
+  }
+  if (value == EBUR128_DUAL_MONO && (state->channels != 1 || channel_number != 0)) {
+    return EBUR128_ERROR_INVALID_CHANNEL_INDEX;
+  }
+
+  if (state->channel_map[channel_number] != value) {
+    state->channel_map[channel_number] = value;
+    gst_ebur128_state_setup_lanes(state);
+  }
+  return EBUR128_SUCCESS;
+}
+
+/**
+ * Decimates the filter-input by the largest power of two that keeps the filter-rate at or above the requested rate, a
+ * rate of 0 disables decimation. Requests below 44.1 kHz are raised to it. Only possible before the first frame is
+ * added, as the sub-blocks change their length.
+ *
+ * The anti-alias filter passes the band up to 0.366 of the filter-rate within 0.015 dB and attenuates everything that
+ * folds back into it by at least 50 dB. For material band-limited to 17.6 kHz at a filter-rate of 48 kHz (16.1 kHz at
+ * 44.1 kHz) the loudness is within 0.005 LU of the same material recorded at the filter-rate, and within 0.05 LU of
+ * the full-rate result. Most of the latter is the K-Weighting itself: its coefficients are derived per rate like
+ * libebur128 does, which already measures the same material about 0.02 LU quieter at 96 kHz and 0.035 LU at 192 kHz
+ * than at 48 kHz. Content above the band is attenuated and does not count towards the loudness, up to its full energy
+ * above the Nyquist-Frequency of the filter-rate. The filter delays the loudness by less than 0.25ms.
+ */
+int gst_ebur128_state_set_analysis_rate(GstEbur128State *state, gulong rate) {
+  guint decimation = 1;
+  if (rate > 0) {
+    gulong target = MAX(rate, MIN_ANALYSIS_RATE);
+    while (decimation < MAX_DECIMATION && state->samplerate % (decimation * 2) == 0 &&
+           state->samplerate / (decimation * 2) >= target) {
+      decimation *= 2;
+    }
+  }
+
+  if (decimation != state->decimation && (state->blocks_total > 0 || state->block_frames > 0)) {
+    return EBUR128_ERROR_INVALID_MODE;
+  }
+
+  state->analysis_rate = rate;
+  if (decimation == state->decimation) {
+    return EBUR128_SUCCESS;
+  }
+
+  state->decimation = decimation;
+  state->frames_per_block = (gst_ebur128_state_filter_rate(state) + 5) / 10;
+  gst_ebur128_state_setup_lanes(state);
+
+  // the history holds the same number of sub-blocks, but is sized through the frame-count of the window
+  if (state->max_window > 0) {
+    return gst_ebur128_state_set_max_window(state, state->max_window);
+  }
+  return EBUR128_SUCCESS;
+}
+
+/**
+ * Takes a snapshot every interval frames of input while frames are added, so a caller which needs the measurements in
+ * shorter intervals than its buffers can add a whole buffer at once instead of slicing it. Frames already counted
+ * towards the next snapshot are kept, but never more than the new interval allows.
+ */
+void gst_ebur128_state_set_snapshot_func(GstEbur128State *state, guint interval, GstEbur128StateSnapshotFunc func,
+                                         gpointer user_data) {
+  state->snapshot_interval = func != NULL ? interval : 0;
+  state->snapshot_position = state->snapshot_interval > 0 ? MIN(state->snapshot_position, interval - 1) : 0;
+  state->snapshot_func = func;
+  state->snapshot_data = user_data;
+}
+
+int gst_ebur128_state_set_max_window(GstEbur128State *state, gulong window) {
+  // enough sub-blocks for the window to start anywhere in the oldest one, a window too long for that keeps the history
+  // and the max-window it has been sized for
+  guint64 frames = (guint64)gst_ebur128_state_filter_rate(state) * window / 1000;
+  guint64 capacity = (frames + state->frames_per_block - 1) / state->frames_per_block;
+  if (capacity >= G_MAXUINT32 / sizeof(gdouble)) {
+    return EBUR128_ERROR_NOMEM;
+  }
+
+  state->max_window = window;
+
+  if (window == 0) {
+    if (state->history != NULL) {
+      gst_ebur128_history_free(state->history);
+      state->history = NULL;
+    }
+  } else if (state->history == NULL) {
+    state->history = gst_ebur128_history_new(capacity);
+  } else {
+    gst_ebur128_history_set_capacity(state->history, capacity);
+  }
+  return EBUR128_SUCCESS;
+}
+
+int gst_ebur128_state_set_max_history(GstEbur128State *state, gulong history) {
+  state->max_history = history;
+  if (state->gating != NULL) {
+    gst_ebur128_gating_set_max_blocks(state->gating, gst_ebur128_state_history_blocks(state, 100));
+  }
+  if (state->range_gating != NULL) {
+    gst_ebur128_gating_set_max_blocks(state->range_gating, gst_ebur128_state_history_blocks(state, 3000));
+  }
+  return EBUR128_SUCCESS;
+}
+
+/**
+ * Switches measurements on and off like ebur128_change_parameters, but without starting the others over. A gating-set
+ * is created when its measurement is enabled for the first time and keeps collecting blocks while it is disabled, so
+ * toggling integrated loudness or loudness-range loses nothing. The true-peak meter only runs while it is enabled and
+ * keeps its maxima in between, momentary, short-term and the sample-peak are always tracked.
+ */
+int gst_ebur128_state_set_mode(GstEbur128State *state, gint mode) {
+  gboolean true_peak = (mode & EBUR128_MODE_TRUE_PEAK) == EBUR128_MODE_TRUE_PEAK;
+  state->mode = mode;
+
+  if ((mode & EBUR128_MODE_I) == EBUR128_MODE_I && state->gating == NULL) {
+    state->gating = gst_ebur128_state_new_gating(state, 100);
+  }
+  if ((mode & EBUR128_MODE_LRA) == EBUR128_MODE_LRA && state->range_gating == NULL) {
+    state->range_gating = gst_ebur128_state_new_gating(state, 3000);
+  }
+  if (true_peak != (state->truepeak != NULL)) {
+    gst_ebur128_state_setup_truepeak(state);
+  }
+
+  // the least history kept depends on the loudness-range
+  return gst_ebur128_state_set_max_history(state, state->max_history);
+}
+
+/**
+ * Replaces the gating-sets of integrated loudness and loudness-range with ones of the new engine, which starts both
+ * over. The histogram-engine ignores max_history.
+ */
+int gst_ebur128_state_set_gating_engine(GstEbur128State *state, GstEbur128GatingEngine engine) {
+  if (engine == state->gating_engine) {
+    return EBUR128_SUCCESS;
+  }
+
+  state->gating_engine = engine;
+  gst_ebur128_state_free_gating(state);
+  gst_ebur128_state_create_gating(state);
+  return EBUR128_SUCCESS;
+}
+
+/**
+ * Up to which level prev_true_peak does not have to be the exact true-peak of the last call, with 0 (the default) it
+ * always is. Chunks that can neither raise the true-peak since the start, which is always exact, nor exceed the floor
+ * skip the oversampler, their prev_true_peak stays at or below the floor. G_MAXDOUBLE skips every chunk below the
+ * true-peak since the start.
+ */
+int gst_ebur128_state_set_prev_true_peak_floor(GstEbur128State *state, gdouble floor) {
+  state->prev_true_peak_floor = floor;
+  return EBUR128_SUCCESS;
+}
+
+/**
+ * Keeps the integrated loudness of the trailing horizon (in ms) next to the one since the start, 0 stops it. Setting it
+ * starts the horizon over.
+ *
+ * The horizon is summed from HORIZON_PERIODS + 1 histograms of horizon / HORIZON_PERIODS each, the current one
+ * included. When a period is full, the oldest one is subtracted from the sum and reused, so expiring blocks costs
+ * O(bins) per period and nothing per block, and the loudness is queried like the global one. Like the windows the
+ * horizon is extended backwards to the start of the oldest period it touches, so it covers up to 1/24th more than
+ * requested. It always uses the histogram-engine and takes about 3.2 MiB.
+ */
+int gst_ebur128_state_set_horizon(GstEbur128State *state, gulong horizon) {
+  gst_ebur128_state_free_horizon(state);
+  state->horizon = horizon;
+  if (horizon == 0) {
+    return EBUR128_SUCCESS;
+  }
+
+  state->horizon_gating = gst_ebur128_gating_new_histogram();
+  state->horizon_periods = g_new0(GstEbur128Gating *, HORIZON_PERIODS + 1);
+  for (guint i = 0; i <= HORIZON_PERIODS; i++) {
+    state->horizon_periods[i] = gst_ebur128_gating_new_histogram();
+  }
+
+  // every sub-block of 100ms completes a gating-block
+  state->horizon_period_blocks = MAX(((guint64)horizon + 100 * HORIZON_PERIODS - 1) / (100 * HORIZON_PERIODS), 1);
+  state->horizon_period = 0;
+  state->horizon_period_position = 0;
+  return EBUR128_SUCCESS;
+}
+
+static void gst_ebur128_state_add_horizon_block(GstEbur128State *state, gdouble gating_energy) {
+  if (gating_energy >= ABSOLUTE_GATE_ENERGY) {
+    gst_ebur128_gating_add(state->horizon_gating, gating_energy);
+    gst_ebur128_gating_add(state->horizon_periods[state->horizon_period], gating_energy);
+  }
+
+  if (++state->horizon_period_position < state->horizon_period_blocks) {
+    return;
+  }
+
+  // the period after the current one is the oldest, it expires as the next one starts
+  state->horizon_period = (state->horizon_period + 1) % (HORIZON_PERIODS + 1);
+  state->horizon_period_position = 0;
+
+  GstEbur128Gating *expired = state->horizon_periods[state->horizon_period];
+  gst_ebur128_gating_subtract(state->horizon_gating, expired);
+  gst_ebur128_gating_clear(expired);
+}
+
+// sum over the num_blocks newest complete sub-blocks
+static gdouble gst_ebur128_state_sum_blocks(GstEbur128State *state, guint num_blocks) {
+  gdouble energy = 0.0;
+  for (guint i = 1; i <= num_blocks; i++) {
+    guint index = (state->blocks_head + G_N_ELEMENTS(state->blocks) - i) % G_N_ELEMENTS(state->blocks);
+    energy += state->blocks[index];
+  }
+  return energy;
+}
+
+static void gst_ebur128_state_push_block(GstEbur128State *state, gdouble energy) {
+  state->blocks[state->blocks_head] = energy;
+  state->blocks_head = (state->blocks_head + 1) % G_N_ELEMENTS(state->blocks);
+  if (state->blocks_count < G_N_ELEMENTS(state->blocks)) {
+    state->blocks_count++;
+  }
+  state->blocks_total++;
+
+  if (state->history != NULL) {
+    gst_ebur128_history_push(state->history, energy);
+  }
+
+  // every sub-block completes a 400ms gating-block, overlapping the previous one by 75%
+  if ((state->gating != NULL || state->horizon_gating != NULL) && state->blocks_total >= MOMENTARY_BLOCKS) {
+    gdouble gating_energy = gst_ebur128_state_sum_blocks(state, MOMENTARY_BLOCKS);
+    gating_energy /= (gdouble)(MOMENTARY_BLOCKS * state->frames_per_block);
+
+    if (state->gating != NULL && gating_energy >= ABSOLUTE_GATE_ENERGY) {
+      gst_ebur128_gating_add(state->gating, gating_energy);
+    }
+    if (state->horizon_gating != NULL) {
+      gst_ebur128_state_add_horizon_block(state, gating_energy);
+    }
+  }
+
+  // the first 3s short-term block completes after 30 sub-blocks, every further one after 10 more
+  if (state->range_gating != NULL && state->blocks_total >= SHORTTERM_BLOCKS &&
+      (state->blocks_total - SHORTTERM_BLOCKS) % RANGE_BLOCK_STEP == 0) {
+    gdouble shortterm_energy = gst_ebur128_state_sum_blocks(state, SHORTTERM_BLOCKS);
+    shortterm_energy /= (gdouble)(SHORTTERM_BLOCKS * state->frames_per_block);
+
+    if (shortterm_energy >= ABSOLUTE_GATE_ENERGY) {
+      gst_ebur128_gating_add(state->range_gating, shortterm_energy);
+    }
+  }
+}
+
+static void gst_ebur128_state_filter_scratch(GstEbur128State *state, guint num_frames) {
+  if (state->decimator != NULL) {
+    num_frames = gst_ebur128_decimator_process(state->decimator, state->scratch, num_frames);
+  }
+
+  gst_ebur128_kweighting_process(state->kweighting, state->scratch, num_frames);
+
+  state->block_frames += num_frames;
+  if (state->block_frames == state->frames_per_block) {
+    gst_ebur128_state_push_block(state, gst_ebur128_kweighting_take_energy(state->kweighting));
+    state->block_frames = 0;
+  }
+}
+
+// input-frames up to the end of the sub-block in progress, which is counted in decimated frames
+static guint gst_ebur128_state_frames_to_boundary(GstEbur128State *state) {
+  guint frames = state->frames_per_block - state->block_frames;
+  if (state->decimator != NULL) {
+    frames = gst_ebur128_decimator_get_input_frames(state->decimator, frames);
+  }
+  if (state->snapshot_interval > 0) {
+    frames = MIN(frames, state->snapshot_interval - state->snapshot_position);
+  }
+  return frames;
+}
+
+static void gst_ebur128_state_update_peaks(GstEbur128State *state) {
+  for (guint channel = 0; channel < state->channels; channel++) {
+    state->sample_peak[channel] = MAX(state->sample_peak[channel], state->prev_sample_peak[channel]);
+    state->true_peak[channel] = MAX(state->true_peak[channel], state->prev_true_peak[channel]);
+  }
+}
+
+/**
+ * Counts the frames of a chunk towards the next snapshot. Chunks end on snapshot boundaries, so once one is reached
+ * everything up to it has been filtered and only the peaks of the running call need to be folded in.
+ */
+static void gst_ebur128_state_count_snapshot(GstEbur128State *state, gsize frames_done, guint num_frames) {
+  if (state->snapshot_interval == 0) {
+    return;
+  }
+
+  state->snapshot_position += num_frames;
+  if (state->snapshot_position >= state->snapshot_interval) {
+    state->snapshot_position = 0;
+    gst_ebur128_state_update_peaks(state);
+    state->snapshot_func(state, frames_done, state->snapshot_data);
+  }
+}
+
+/**
+ * Sample-formats other than native-endian short, int, float and double are loaded through these, so they are converted
+ * in the same scratch-sized chunks as everything else instead of a full-size intermediate buffer. 24 bit samples are
+ * widened to the int range, 8 bit ones to the short range, both without losing precision.
+ */
+typedef struct {
+  guint8 bytes[3];
+} GstEbur128S24;
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define S24_TO_INT(x) ((int)((guint32)(x).bytes[0] << 8 | (guint32)(x).bytes[1] << 16 | (guint32)(x).bytes[2] << 24))
+#define S24_SWAPPED_TO_INT(x)                                                                                          \
+  ((int)((guint32)(x).bytes[2] << 8 | (guint32)(x).bytes[1] << 16 | (guint32)(x).bytes[0] << 24))
+#else
+#define S24_TO_INT(x) ((int)((guint32)(x).bytes[2] << 8 | (guint32)(x).bytes[1] << 16 | (guint32)(x).bytes[0] << 24))
+#define S24_SWAPPED_TO_INT(x)                                                                                          \
+  ((int)((guint32)(x).bytes[0] << 8 | (guint32)(x).bytes[1] << 16 | (guint32)(x).bytes[2] << 24))
+#endif
+
+// the upper byte of S24_32 is padding, shifting it out sign-extends from bit 23 like audioconvert does
+#define S24_32_TO_INT(x) ((int)((guint32)(x) << 8))
+#define S24_32_SWAPPED_TO_INT(x) ((int)(GUINT32_SWAP_LE_BE(x) << 8))
+
+#define U8_TO_SHORT(x) ((short)(((gint)(x)-128) * 256))
+
+#define SHORT_SWAPPED_TO_SHORT(x) ((short)GUINT16_SWAP_LE_BE(x))
+#define INT_SWAPPED_TO_INT(x) ((int)GUINT32_SWAP_LE_BE(x))
+#define FLOAT_SWAPPED_TO_FLOAT(x) gst_ebur128_state_swap_float(x)
+#define DOUBLE_SWAPPED_TO_DOUBLE(x) gst_ebur128_state_swap_double(x)
+#define IDENTITY(x) (x)
+
+static inline float gst_ebur128_state_swap_float(guint32 x) {
+  union {
+    guint32 i;
+    float f;
+  } u;
+  u.i = GUINT32_SWAP_LE_BE(x);
+  return u.f;
+}
+
+static inline double gst_ebur128_state_swap_double(guint64 x) {
+  union {
+    guint64 i;
+    double f;
+  } u;
+  u.i = GUINT64_SWAP_LE_BE(x);
+  return u.f;
+}
+
+/**
+ * Runs the true-peak meter over a chunk converted into the peak-scratch and copies the channels that take part in the
+ * loudness into the filter-input.
+ */
+static void gst_ebur128_state_peak_scratch(GstEbur128State *state, guint num_frames) {
+  const gdouble *bound = NULL;
+  if (state->prev_true_peak_floor > 0.0) {
+    for (guint channel = 0; channel < state->channels; channel++) {
+      state->true_peak_bound[channel] = MIN(state->true_peak[channel], state->prev_true_peak_floor);
+    }
+    bound = state->true_peak_bound;
+  }
+
+  state->truepeak_skipped +=
+      gst_ebur128_truepeak_process(state->truepeak, state->peak_scratch, num_frames, state->prev_true_peak, bound);
+
+  for (guint channel = 0; channel < state->channels; channel++) {
+    if (state->channel_lane[channel] < 0) {
+      continue;
+    }
+
+    const gdouble *in = state->peak_scratch + channel;
+    gdouble *out = state->scratch + state->channel_lane[channel];
+    for (guint frame = 0; frame < num_frames; frame++, in += state->peak_stride, out += state->stride) {
+      *out = *in;
+    }
+  }
+}
+
+/**
+ * Converts the frames in scratch-sized chunks that never cross a sub-block or snapshot boundary into the filter-input,
+ * tracking the sample-peak on the way. Channel c is read from state->planes[c], step samples apart, so interleaved and
+ * planar input share the same loop. Unused channels only take part in the peak. With the true-peak meter every channel
+ * is converted into a lane of the peak-scratch first.
+ *
+ * Samples of type T are loaded by LOAD as a value of the matching native type, which SCALE brings to +-1.0.
+ */
+#define DEFINE_INGEST(NAME, T, LOAD, SCALE)                                                                            \
+  static void gst_ebur128_state_filter_##NAME(GstEbur128State *state, gsize step, gsize frames) {                     \
+    const guint channels = state->channels;                                                                            \
+    const guint stride = state->stride;                                                                                \
+    const T **planes = (const T **)state->planes;                                                                      \
+    memset(state->prev_sample_peak, 0, channels * sizeof(gdouble));                                                    \
+    memset(state->prev_true_peak, 0, channels * sizeof(gdouble));                                                      \
+                                                                                                                       \
+    gsize frames_done = 0;                                                                                             \
+    while (frames > 0) {                                                                                               \
+      guint num_frames = MIN(frames, MIN(state->scratch_frames, gst_ebur128_state_frames_to_boundary(state)));        \
+                                                                                                                       \
+      for (guint channel = 0; channel < channels; channel++) {                                                         \
+        const T *in = planes[channel];                                                                                 \
+        gdouble peak = state->prev_sample_peak[channel];                                                               \
+        if (state->truepeak != NULL || state->channel_lane[channel] >= 0) {                                            \
+          guint out_stride = state->truepeak != NULL ? state->peak_stride : stride;                                    \
+          gdouble *out = state->truepeak != NULL ? state->peak_scratch + channel                                       \
+                                                 : state->scratch + state->channel_lane[channel];                      \
+          for (guint frame = 0; frame < num_frames; frame++, in += step, out += out_stride) {                          \
+            gdouble sample = (gdouble)LOAD(*in) * (SCALE);                                                             \
+            *out = sample;                                                                                             \
+            peak = MAX(peak, fabs(sample));                                                                            \
+          }                                                                                                            \
+        } else {                                                                                                       \
+          for (guint frame = 0; frame < num_frames; frame++, in += step) {                                             \
+            peak = MAX(peak, fabs((gdouble)LOAD(*in) * (SCALE)));                                                      \
+          }                                                                                                            \
+        }                                                                                                              \
+        state->prev_sample_peak[channel] = peak;                                                                       \
+        planes[channel] = in;                                                                                          \
+      }                                                                                                                \
+                                                                                                                       \
+      if (state->truepeak != NULL) {                                                                                   \
+        gst_ebur128_state_peak_scratch(state, num_frames);                                                             \
+      }                                                                                                                \
+      gst_ebur128_state_filter_scratch(state, num_frames);                                                             \
+      frames -= num_frames;                                                                                            \
+      frames_done += num_frames;                                                                                       \
+      gst_ebur128_state_count_snapshot(state, frames_done, num_frames);                                                \
+    }                                                                                                                  \
+                                                                                                                       \
+    gst_ebur128_state_update_peaks(state);                                                                             \
+  }                                                                                                                    \
+                                                                                                                       \
+  static int gst_ebur128_state_ingest_##NAME(GstEbur128State *state, const gconstpointer *src, gboolean planar,        \
+                                             gsize offset, gsize frames) {                                             \
+    const guint channels = state->channels;                                                                            \
+    for (guint channel = 0; channel < channels; channel++) {                                                           \
+      if (planar) {                                                                                                    \
+        state->planes[channel] = (const T *)src[channel] + offset;                                                     \
+      } else {                                                                                                         \
+        state->planes[channel] = (const T *)src[0] + offset * channels + channel;                                      \
+      }                                                                                                                \
+    }                                                                                                                  \
+                                                                                                                       \
+    gst_ebur128_state_filter_##NAME(state, planar ? 1 : channels, frames);                                             \
+    return EBUR128_SUCCESS;                                                                                            \
+  }
+
+DEFINE_INGEST(short, short, IDENTITY, 1.0 / 32768.0)
+DEFINE_INGEST(int, int, IDENTITY, 1.0 / 2147483648.0)
+DEFINE_INGEST(float, float, IDENTITY, 1.0)
+DEFINE_INGEST(double, double, IDENTITY, 1.0)
+
+DEFINE_INGEST(short_swapped, guint16, SHORT_SWAPPED_TO_SHORT, 1.0 / 32768.0)
+DEFINE_INGEST(int_swapped, guint32, INT_SWAPPED_TO_INT, 1.0 / 2147483648.0)
+DEFINE_INGEST(float_swapped, guint32, FLOAT_SWAPPED_TO_FLOAT, 1.0)
+DEFINE_INGEST(double_swapped, guint64, DOUBLE_SWAPPED_TO_DOUBLE, 1.0)
+DEFINE_INGEST(s24, GstEbur128S24, S24_TO_INT, 1.0 / 2147483648.0)
+DEFINE_INGEST(s24_swapped, GstEbur128S24, S24_SWAPPED_TO_INT, 1.0 / 2147483648.0)
+DEFINE_INGEST(s24_32, guint32, S24_32_TO_INT, 1.0 / 2147483648.0)
+DEFINE_INGEST(s24_32_swapped, guint32, S24_32_SWAPPED_TO_INT, 1.0 / 2147483648.0)
+DEFINE_INGEST(u8, guint8, U8_TO_SHORT, 1.0 / 32768.0)
+
+#define DEFINE_ADD_FRAMES(NAME, T)                                                                                     \
+  int gst_ebur128_state_add_frames_##NAME(GstEbur128State *state, const T *src, gsize frames) {                        \
+    gconstpointer planes[] = {src};                                                                                    \
+    return gst_ebur128_state_ingest_##NAME(state, planes, FALSE, 0, frames);                                           \
+  }                                                                                                                    \
+                                                                                                                       \
+  int gst_ebur128_state_add_frames_planar_##NAME(GstEbur128State *state, const T *const *src, gsize offset,            \
+                                                 gsize frames) {                                                       \
+    return gst_ebur128_state_ingest_##NAME(state, (const gconstpointer *)src, TRUE, offset, frames);                   \
+  }
+
+DEFINE_ADD_FRAMES(short, short)
+DEFINE_ADD_FRAMES(int, int)
+DEFINE_ADD_FRAMES(float, float)
+DEFINE_ADD_FRAMES(double, double)
+
+int gst_ebur128_state_add_frames_converted(GstEbur128State *state, GstEbur128SampleFormat format,
+                                           const gconstpointer *src, gboolean planar, gsize offset, gsize frames) {
+  switch (format) {
+  case GST_EBUR128_SAMPLE_FORMAT_S16_SWAPPED:
+    return gst_ebur128_state_ingest_short_swapped(state, src, planar, offset, frames);
+  case GST_EBUR128_SAMPLE_FORMAT_S32_SWAPPED:
+    return gst_ebur128_state_ingest_int_swapped(state, src, planar, offset, frames);
+  case GST_EBUR128_SAMPLE_FORMAT_F32_SWAPPED:
+    return gst_ebur128_state_ingest_float_swapped(state, src, planar, offset, frames);
+  case GST_EBUR128_SAMPLE_FORMAT_F64_SWAPPED:
+    return gst_ebur128_state_ingest_double_swapped(state, src, planar, offset, frames);
+  case GST_EBUR128_SAMPLE_FORMAT_S24:
+    return gst_ebur128_state_ingest_s24(state, src, planar, offset, frames);
+  case GST_EBUR128_SAMPLE_FORMAT_S24_SWAPPED:
+    return gst_ebur128_state_ingest_s24_swapped(state, src, planar, offset, frames);
+  case GST_EBUR128_SAMPLE_FORMAT_S24_32:
+    return gst_ebur128_state_ingest_s24_32(state, src, planar, offset, frames);
+  case GST_EBUR128_SAMPLE_FORMAT_S24_32_SWAPPED:
+    return gst_ebur128_state_ingest_s24_32_swapped(state, src, planar, offset, frames);
+  case GST_EBUR128_SAMPLE_FORMAT_U8:
+    return gst_ebur128_state_ingest_u8(state, src, planar, offset, frames);
+  }
+  return EBUR128_ERROR_INVALID_MODE;
+}
+
+/**
+ * Mean-Square over the sub-block in progress and the num_blocks complete sub-blocks before it. Sub-blocks from before
+ * the start of the stream count as silence, like the zero-initialized sample-buffer of libebur128 does.
+ */
+static gdouble gst_ebur128_state_energy_in_blocks(GstEbur128State *state, guint num_blocks) {
+  gdouble energy = gst_ebur128_kweighting_peek_energy(state->kweighting);
+  energy += gst_ebur128_state_sum_blocks(state, MIN(num_blocks, state->blocks_count));
+  return energy / (gdouble)(state->block_frames + num_blocks * state->frames_per_block);
+}
+
+static int gst_ebur128_state_energy_to_loudness(gdouble energy, double *out) {
+  if (energy <= 0.0) {
+    *out = -HUGE_VAL;
+  } else {
+    *out = 10 * log10(energy) - 0.691;
+  }
+  return EBUR128_SUCCESS;
+}
+
+int gst_ebur128_state_loudness_momentary(GstEbur128State *state, double *out) {
+  return gst_ebur128_state_energy_to_loudness(gst_ebur128_state_energy_in_blocks(state, MOMENTARY_BLOCKS), out);
+}
+
+int gst_ebur128_state_loudness_shortterm(GstEbur128State *state, double *out) {
+  if ((state->mode & EBUR128_MODE_S) != EBUR128_MODE_S) {
+    return EBUR128_ERROR_INVALID_MODE;
+  }
+  return gst_ebur128_state_energy_to_loudness(gst_ebur128_state_energy_in_blocks(state, SHORTTERM_BLOCKS), out);
+}
+
+/**
+ * Sum and count of the blocks above the absolute gate are kept by the gating-set, so the relative threshold costs
+ * nothing and the blocks above it are summed in O(log n).
+ */
+static int gst_ebur128_state_gated_loudness(GstEbur128Gating *gating, double *out) {
+  guint64 count = gst_ebur128_gating_get_count(gating);
+  if (count == 0) {
+    *out = -HUGE_VAL;
+    return EBUR128_SUCCESS;
+  }
+
+  gdouble relative_threshold = gst_ebur128_gating_get_sum(gating) / (gdouble)count * RELATIVE_GATE_FACTOR;
+
+  gdouble sum;
+  gst_ebur128_gating_sum_above(gating, relative_threshold, &count, &sum);
+  if (count == 0) {
+    *out = -HUGE_VAL;
+    return EBUR128_SUCCESS;
+  }
+
+  return gst_ebur128_state_energy_to_loudness(sum / (gdouble)count, out);
+}
+
+int gst_ebur128_state_loudness_global(GstEbur128State *state, double *out) {
+  if ((state->mode & EBUR128_MODE_I) != EBUR128_MODE_I || state->gating == NULL) {
+    return EBUR128_ERROR_INVALID_MODE;
+  }
+  return gst_ebur128_state_gated_loudness(state->gating, out);
+}
+
+int gst_ebur128_state_loudness_horizon(GstEbur128State *state, double *out) {
+  if (state->horizon_gating == NULL) {
+    return EBUR128_ERROR_INVALID_MODE;
+  }
+  return gst_ebur128_state_gated_loudness(state->horizon_gating, out);
+}
+
+/**
+ * Like Momentary and Short-Term loudness the window is extended backwards to the start of the oldest sub-block it
+ * touches, so it is identical to libebur128 on sub-block boundaries and covers up to 100ms more in between.
+ */
+int gst_ebur128_state_loudness_window(GstEbur128State *state, gulong window, double *out) {
+  if (state->history == NULL || window > state->max_window) {
+    return EBUR128_ERROR_INVALID_MODE;
+  }
+
+  guint num_blocks = gst_ebur128_state_window_blocks(state, window);
+  gdouble energy = gst_ebur128_kweighting_peek_energy(state->kweighting);
+  energy += gst_ebur128_history_sum(state->history, num_blocks);
+
+  guint64 frames = state->block_frames + (guint64)num_blocks * state->frames_per_block;
+  return gst_ebur128_state_energy_to_loudness(frames > 0 ? energy / (gdouble)frames : 0.0, out);
+}
+
+/**
+ * Same percentiles as libebur128 picks from its sorted block-list, but looked up by rank in the ordered set: blocks
+ * below the relative gate are skipped by offsetting the index with their count.
+ */
+int gst_ebur128_state_loudness_range(GstEbur128State *state, double *out) {
+  if ((state->mode & EBUR128_MODE_LRA) != EBUR128_MODE_LRA || state->range_gating == NULL) {
+    return EBUR128_ERROR_INVALID_MODE;
+  }
+
+  guint64 count = gst_ebur128_gating_get_count(state->range_gating);
+  if (count == 0) {
+    *out = 0.0;
+    return EBUR128_SUCCESS;
+  }
+
+  gdouble relative_threshold =
+      gst_ebur128_gating_get_sum(state->range_gating) / (gdouble)count * RANGE_RELATIVE_GATE_FACTOR;
+
+  guint64 gated_count;
+  gdouble gated_sum;
+  gst_ebur128_gating_sum_above(state->range_gating, relative_threshold, &gated_count, &gated_sum);
+  if (gated_count == 0) {
+    *out = 0.0;
+    return EBUR128_SUCCESS;
+  }
+
+  guint64 below = count - gated_count;
+  gdouble high = gst_ebur128_gating_nth(state->range_gating, below + (guint64)((gated_count - 1) * 0.95 + 0.5));
+  gdouble low = gst_ebur128_gating_nth(state->range_gating, below + (guint64)((gated_count - 1) * 0.1 + 0.5));
+
+  gdouble high_loudness, low_loudness;
+  gst_ebur128_state_energy_to_loudness(high, &high_loudness);
+  gst_ebur128_state_energy_to_loudness(low, &low_loudness);
+  *out = high_loudness - low_loudness;
+  return EBUR128_SUCCESS;
+}
+
+int gst_ebur128_state_sample_peak(GstEbur128State *state, unsigned int channel_number, double *out) {
+  if ((state->mode & EBUR128_MODE_SAMPLE_PEAK) != EBUR128_MODE_SAMPLE_PEAK) {
+    return EBUR128_ERROR_INVALID_MODE;
+  } else if (channel_number >= state->channels) {
+    return EBUR128_ERROR_INVALID_CHANNEL_INDEX;
+  }
+  *out = state->sample_peak[channel_number];
+  return EBUR128_SUCCESS;
+}
+
+int gst_ebur128_state_prev_sample_peak(GstEbur128State *state, unsigned int channel_number, double *out) {
+  if ((state->mode & EBUR128_MODE_SAMPLE_PEAK) != EBUR128_MODE_SAMPLE_PEAK) {
+    return EBUR128_ERROR_INVALID_MODE;
+  } else if (channel_number >= state->channels) {
+    return EBUR128_ERROR_INVALID_CHANNEL_INDEX;
+  }
+  *out = state->prev_sample_peak[channel_number];
+  return EBUR128_SUCCESS;
+}
+
+// like libebur128 the sample-peak counts as well, it is the true-peak when there is no oversampling
+int gst_ebur128_state_true_peak(GstEbur128State *state, unsigned int channel_number, double *out) {
+  if ((state->mode & EBUR128_MODE_TRUE_PEAK) != EBUR128_MODE_TRUE_PEAK) {
+    return EBUR128_ERROR_INVALID_MODE;
+  } else if (channel_number >= state->channels) {
+    return EBUR128_ERROR_INVALID_CHANNEL_INDEX;
+  }
+  *out = MAX(state->true_peak[channel_number], state->sample_peak[channel_number]);
+  return EBUR128_SUCCESS;
+}
+
+int gst_ebur128_state_prev_true_peak(GstEbur128State *state, unsigned int channel_number, double *out) {
+  if ((state->mode & EBUR128_MODE_TRUE_PEAK) != EBUR128_MODE_TRUE_PEAK) {
+    return EBUR128_ERROR_INVALID_MODE;
+  } else if (channel_number >= state->channels) {
+    return EBUR128_ERROR_INVALID_CHANNEL_INDEX;
+  }
+  *out = MAX(state->prev_true_peak[channel_number], state->prev_sample_peak[channel_number]);
+  return EBUR128_SUCCESS;
+}
+
+/**
+ * Saves a checkpoint of the gating-sets and the peaks, see gstebur128checkpoint.h for the header. Every gating-set the
+ * state keeps follows the peaks, in the order of integrated loudness, loudness-range and horizon, see
+ * gst_ebur128_gating_save. The horizon is preceded by its length in ms, the blocks per period (u64 each), the number of
+ * periods and the current one (u32 each) and the blocks added to it (u64), and followed by every period.
+ *
+ * Momentary and short-term loudness are not saved, they start over with the next frames like after a gap.
+ */
+GBytes *gst_ebur128_state_save(GstEbur128State *state) {
+  GByteArray *bytes = g_byte_array_new();
+
+  guint32 sets = 0;
+  sets |= state->gating != NULL ? CHECKPOINT_GATING : 0;
+  sets |= state->range_gating != NULL ? CHECKPOINT_RANGE_GATING : 0;
+  sets |= state->horizon_gating != NULL ? CHECKPOINT_HORIZON : 0;
+
+  gst_ebur128_checkpoint_put_u32(bytes, GST_EBUR128_CHECKPOINT_MAGIC);
+  gst_ebur128_checkpoint_put_u32(bytes, GST_EBUR128_CHECKPOINT_VERSION);
+  gst_ebur128_checkpoint_put_u32(bytes, state->channels);
+  gst_ebur128_checkpoint_put_u32(bytes, sets);
+
+  for (guint channel = 0; channel < state->channels; channel++) {
+    gst_ebur128_checkpoint_put_double(bytes, MAX(state->sample_peak[channel], state->prev_sample_peak[channel]));
+    gst_ebur128_checkpoint_put_double(bytes, MAX(state->true_peak[channel], state->prev_true_peak[channel]));
+  }
+
+  if (state->gating != NULL) {
+    gst_ebur128_gating_save(state->gating, bytes);
+  }
+  if (state->range_gating != NULL) {
+    gst_ebur128_gating_save(state->range_gating, bytes);
+  }
+  if (state->horizon_gating != NULL) {
+    gst_ebur128_checkpoint_put_u64(bytes, state->horizon);
+    gst_ebur128_checkpoint_put_u64(bytes, state->horizon_period_blocks);
+    gst_ebur128_checkpoint_put_u32(bytes, HORIZON_PERIODS + 1);
+    gst_ebur128_checkpoint_put_u32(bytes, state->horizon_period);
+    gst_ebur128_checkpoint_put_u64(bytes, state->horizon_period_position);
+    gst_ebur128_gating_save(state->horizon_gating, bytes);
+    for (guint i = 0; i <= HORIZON_PERIODS; i++) {
+      gst_ebur128_gating_save(state->horizon_periods[i], bytes);
+    }
+  }
+
+  return g_byte_array_free_to_bytes(bytes);
+}
+
+// loads a saved gating-set into the new gating, or skips over it when that is NULL
+static gboolean gst_ebur128_state_load_gating(GstEbur128CheckpointReader *reader, GstEbur128Gating *gating,
+                                              GstEbur128Gating **loaded) {
+  GstEbur128Gating *target = gating != NULL ? gating : gst_ebur128_gating_new_histogram();
+  if (!gst_ebur128_gating_load(target, reader)) {
+    gst_ebur128_gating_free(target);
+    return FALSE;
+  }
+
+  if (gating != NULL) {
+    *loaded = gating;
+  } else {
+    gst_ebur128_gating_free(target);
+  }
+  return TRUE;
+}
+
+static void gst_ebur128_state_free_periods(GstEbur128Gating **periods, guint n_periods) {
+  for (guint i = 0; i < n_periods; i++) {
+    if (periods[i] != NULL) {
+      gst_ebur128_gating_free(periods[i]);
+    }
+  }
+  g_free(periods);
+}
+
+/**
+ * Replaces the gating-sets and the peaks with the ones of a checkpoint taken by gst_ebur128_state_save, from a state
+ * with the same number of channels. The state keeps its mode and engine: sets it does not keep are skipped, sets the
+ * checkpoint lacks start over, and blocks taken exactly can be restored into a histogram but not the other way round.
+ * The horizon is only restored into a state with the same horizon and otherwise kept. The state is left untouched when
+ * the checkpoint can not be restored.
+ */
+gboolean gst_ebur128_state_restore(GstEbur128State *state, GBytes *checkpoint, GError **error) {
+  gsize size;
+  const guint8 *data = g_bytes_get_data(checkpoint, &size);
+
+  GstEbur128CheckpointReader reader;
+  gst_ebur128_checkpoint_reader_init(&reader, data, size);
+
+  guint32 magic = gst_ebur128_checkpoint_get_u32(&reader);
+  guint32 version = gst_ebur128_checkpoint_get_u32(&reader);
+  guint32 channels = gst_ebur128_checkpoint_get_u32(&reader);
+  guint32 sets = gst_ebur128_checkpoint_get_u32(&reader);
+  if (reader.truncated || magic != GST_EBUR128_CHECKPOINT_MAGIC) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "not a loudness checkpoint");
+    return FALSE;
+  }
+  if (version != GST_EBUR128_CHECKPOINT_VERSION) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "unsupported loudness checkpoint version %u", version);
+    return FALSE;
+  }
+  if (channels != state->channels) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                "loudness checkpoint of %u channels can not be restored into %u", channels, state->channels);
+    return FALSE;
+  }
+
+  gdouble *peaks = g_new(gdouble, 2 * channels);
+  for (guint i = 0; i < 2 * channels; i++) {
+    peaks[i] = gst_ebur128_checkpoint_get_double(&reader);
+  }
+
+  GstEbur128Gating *gating = NULL, *range_gating = NULL, *horizon_gating = NULL;
+  GstEbur128Gating **horizon_periods = NULL;
+  guint32 n_periods = 0, horizon_period = 0;
+  guint64 horizon_period_position = 0;
+
+  gboolean success = !reader.truncated;
+  if (success && (sets & CHECKPOINT_GATING)) {
+    GstEbur128Gating *target = state->gating != NULL ? gst_ebur128_state_new_gating(state, 100) : NULL;
+    success = gst_ebur128_state_load_gating(&reader, target, &gating);
+  }
+  if (success && (sets & CHECKPOINT_RANGE_GATING)) {
+    GstEbur128Gating *target = state->range_gating != NULL ? gst_ebur128_state_new_gating(state, 3000) : NULL;
+    success = gst_ebur128_state_load_gating(&reader, target, &range_gating);
+  }
+  if (success && (sets & CHECKPOINT_HORIZON)) {
+    guint64 horizon = gst_ebur128_checkpoint_get_u64(&reader);
+    guint64 horizon_period_blocks = gst_ebur128_checkpoint_get_u64(&reader);
+    n_periods = gst_ebur128_checkpoint_get_u32(&reader);
+    horizon_period = gst_ebur128_checkpoint_get_u32(&reader);
+    horizon_period_position = gst_ebur128_checkpoint_get_u64(&reader);
+
+    // periods of another horizon are only read to check them
+    gboolean matches = state->horizon_gating != NULL && horizon == state->horizon &&
+                       horizon_period_blocks == state->horizon_period_blocks && n_periods == HORIZON_PERIODS + 1;
+
+    success = !reader.truncated && horizon_period < n_periods && horizon_period_position < horizon_period_blocks &&
+              n_periods <= gst_ebur128_checkpoint_reader_remaining(&reader);
+    if (success) {
+      horizon_periods = g_new0(GstEbur128Gating *, n_periods);
+      success = gst_ebur128_state_load_gating(&reader, matches ? gst_ebur128_gating_new_histogram() : NULL,
+                                              &horizon_gating);
+    }
+    for (guint i = 0; success && i < n_periods; i++) {
+      success = gst_ebur128_state_load_gating(&reader, matches ? gst_ebur128_gating_new_histogram() : NULL,
+                                              &horizon_periods[i]);
+    }
+  }
+
+  if (!success || reader.position != reader.size) {
+    g_clear_pointer(&gating, gst_ebur128_gating_free);
+    g_clear_pointer(&range_gating, gst_ebur128_gating_free);
+    g_clear_pointer(&horizon_gating, gst_ebur128_gating_free);
+    if (horizon_periods != NULL) {
+      gst_ebur128_state_free_periods(horizon_periods, n_periods);
+    }
+    g_free(peaks);
+
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "loudness checkpoint is corrupt or of another gating-engine");
+    return FALSE;
+  }
+
+  for (guint channel = 0; channel < channels; channel++) {
+    state->sample_peak[channel] = peaks[2 * channel];
+    state->true_peak[channel] = peaks[2 * channel + 1];
+  }
+  g_free(peaks);
+
+  // sets the checkpoint lacks start over
+  if (state->gating != NULL) {
+    gst_ebur128_gating_free(state->gating);
+    state->gating = gating != NULL ? gating : gst_ebur128_state_new_gating(state, 100);
+  }
+  if (state->range_gating != NULL) {
+    gst_ebur128_gating_free(state->range_gating);
+    state->range_gating = range_gating != NULL ? range_gating : gst_ebur128_state_new_gating(state, 3000);
+  }
+  if (horizon_gating != NULL) {
+    gst_ebur128_state_free_horizon(state);
+    state->horizon_gating = horizon_gating;
+    state->horizon_periods = horizon_periods;
+    state->horizon_period = horizon_period;
+    state->horizon_period_position = horizon_period_position;
+  } else if (horizon_periods != NULL) {
+    gst_ebur128_state_free_periods(horizon_periods, n_periods);
+  }
+
+  return TRUE;
+}
+
+/**
+ * Adds what previous has measured to state, where previous analyzed the same programme before its sample-rate or
+ * channel-layout changed. Like ebur128_loudness_global_multiple, integrated loudness and loudness-range are then gated
+ * over the blocks of both. A horizon of the same length continues with the periods of both lined up at their current
+ * one. Peaks are kept per channel as long as the number of channels is the same. Both states keep mode and engine,
+ * state is left untouched when previous counted its blocks in histograms and state keeps them exactly.
+ */
+gboolean gst_ebur128_state_carry_over(GstEbur128State *state, GstEbur128State *previous) {
+  GstEbur128Gating *targets[] = {state->gating, state->range_gating};
+  GstEbur128Gating *sources[] = {previous->gating, previous->range_gating};
+  for (guint i = 0; i < G_N_ELEMENTS(targets); i++) {
+    if (targets[i] != NULL && sources[i] != NULL &&
+        gst_ebur128_gating_get_engine(sources[i]) == GST_EBUR128_GATING_ENGINE_HISTOGRAM &&
+        gst_ebur128_gating_get_engine(targets[i]) == GST_EBUR128_GATING_ENGINE_EXACT) {
+      return FALSE;
+    }
+  }
+
+  for (guint i = 0; i < G_N_ELEMENTS(targets); i++) {
+    if (targets[i] != NULL && sources[i] != NULL) {
+      gst_ebur128_gating_add_all(targets[i], sources[i]);
+    }
+  }
+
+  // horizons are always histograms
+  if (state->horizon_gating != NULL && previous->horizon_gating != NULL && state->horizon == previous->horizon) {
+    gst_ebur128_gating_add_all(state->horizon_gating, previous->horizon_gating);
+    for (guint i = 0; i <= HORIZON_PERIODS; i++) {
+      guint period = (state->horizon_period + HORIZON_PERIODS + 1 - i) % (HORIZON_PERIODS + 1);
+      guint previous_period = (previous->horizon_period + HORIZON_PERIODS + 1 - i) % (HORIZON_PERIODS + 1);
+      gst_ebur128_gating_add_all(state->horizon_periods[period], previous->horizon_periods[previous_period]);
+    }
+    state->horizon_period_position = MAX(state->horizon_period_position, previous->horizon_period_position);
+  }
+
+  if (state->channels == previous->channels) {
+    for (guint channel = 0; channel < state->channels; channel++) {
+      gdouble sample_peak = MAX(previous->sample_peak[channel], previous->prev_sample_peak[channel]);
+      gdouble true_peak = MAX(previous->true_peak[channel], previous->prev_true_peak[channel]);
+      state->sample_peak[channel] = MAX(state->sample_peak[channel], sample_peak);
+      state->true_peak[channel] = MAX(state->true_peak[channel], true_peak);
+    }
+  }
+
+  return TRUE;
+}
@@ -0,0 +1,192 @@
+#ifndef __GST_EBUR128STATE_H__
+#define __GST_EBUR128STATE_H__
+
+#include "gstebur128decimator.h"
+#include "gstebur128gating.h"
+#include "gstebur128history.h"
+#include "gstebur128kweighting.h"
+#include "gstebur128truepeak.h"
+#include <ebur128.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Sample-formats which are converted while they are read, in addition to the native-endian short, int, float and
+ * double ones. Swapped formats are stored in the opposite byte-order of the host, S24 packs a sample into 3 bytes and
+ * S24_32 into the lower 3 bytes of 4.
+ */
+typedef enum {
+  GST_EBUR128_SAMPLE_FORMAT_S16_SWAPPED,
+  GST_EBUR128_SAMPLE_FORMAT_S32_SWAPPED,
+  GST_EBUR128_SAMPLE_FORMAT_F32_SWAPPED,
+  GST_EBUR128_SAMPLE_FORMAT_F64_SWAPPED,
+  GST_EBUR128_SAMPLE_FORMAT_S24,
+  GST_EBUR128_SAMPLE_FORMAT_S24_SWAPPED,
+  GST_EBUR128_SAMPLE_FORMAT_S24_32,
+  GST_EBUR128_SAMPLE_FORMAT_S24_32_SWAPPED,
+  GST_EBUR128_SAMPLE_FORMAT_U8,
+} GstEbur128SampleFormat;
+
+/**
+ * Loudness-State shared by both Elements.
+ *
+ * Mirrors the ebur128_state API of libebur128, but runs the K-Weighting and the Mean-Square calculation in-tree with
+ * SIMD-Kernels and keeps the result as a ring of 100ms sub-block energies, which is all Momentary and Short-Term
+ * loudness need. Every sub-block also completes a 400ms gating-block which is kept in an ordered set for the
+ * integrated loudness, so querying it does not re-walk the whole history. The loudness-range does the same with a
+ * short-term block every second, and windowed loudness is answered from a prefix-summed history of sub-blocks that is
+ * as long as the window. True-Peak is measured by an in-tree polyphase oversampler with the coefficients of
+ * libebur128, which is only created and fed when EBUR128_MODE_TRUE_PEAK is requested. libebur128 itself is no longer
+ * instantiated, only its constants and channel-types are shared.
+ *
+ * Momentary, Short-Term and windowed loudness are identical to libebur128 when queried on a sub-block boundary. Between
+ * two boundaries the window is extended backwards to the start of the oldest sub-block it touches, so it covers up to
+ * 100ms more than requested (400 to 500ms for Momentary, 3.0 to 3.1s for Short-Term). For a window of w ms over
+ * steady material this is within 10 * log10(1 + 100 / w) LU, 0.05 LU for a 10s window.
+ *
+ * With an analysis-rate set, high-rate input is decimated before the K-Weighting, see
+ * gst_ebur128_state_set_analysis_rate. Sample- and True-Peak are always measured at the native rate. The histogram
+ * gating-engine keeps integrated loudness and loudness-range in constant memory instead of the ordered sets, see
+ * gst_ebur128_state_set_gating_engine. Integrated loudness over a trailing horizon is kept alongside the one since
+ * the start, see gst_ebur128_state_set_horizon.
+ */
+typedef struct _GstEbur128State GstEbur128State;
+
+/**
+ * Called while frames are added, whenever another snapshot-interval of frames has been ingested. frames counts the
+ * frames of the current add_frames call up to the snapshot, and all queries answer for exactly that point. Must neither
+ * add frames nor reconfigure the state.
+ */
+typedef void (*GstEbur128StateSnapshotFunc)(GstEbur128State *state, gsize frames, gpointer user_data);
+
+struct _GstEbur128State {
+  gint mode;
+  guint channels;
+  gulong samplerate;
+
+  /*< private >*/
+  gulong max_window;
+  gulong max_history;
+  gulong horizon;
+
+  // libebur128 channel-type of every channel and the filter-lane it is converted into, -1 for unused channels
+  int *channel_map;
+  gint *channel_lane;
+
+  // requested analysis-rate and the power of two the filter-input is decimated by to get there, 1 if it is not
+  gulong analysis_rate;
+  guint decimation;
+  GstEbur128Decimator *decimator;
+
+  GstEbur128KWeighting *kweighting;
+  guint stride;
+
+  // conversion target for the filter, scratch_frames * stride doubles, padding-lanes are never written
+  gdouble *scratch;
+  guint scratch_frames;
+
+  // read-position of every channel while converting
+  gconstpointer *planes;
+
+  // true-peak meter with its own conversion target of scratch_frames * peak_stride doubles, only with
+  // EBUR128_MODE_TRUE_PEAK
+  GstEbur128TruePeak *truepeak;
+  gdouble *peak_scratch;
+  guint peak_stride;
+
+  // level above which prev_true_peak is read, see gst_ebur128_state_set_prev_true_peak_floor, the bound chunks are
+  // skipped against and the lane-groups of chunks that skipped the oversampler because they could not raise the peak
+  gdouble prev_true_peak_floor;
+  gdouble *true_peak_bound;
+  guint64 truepeak_skipped;
+
+  // ring of sub-block energies (sum of weighted squares), newest at blocks_head - 1
+  guint frames_per_block;
+  guint block_frames;
+  gdouble blocks[30];
+  guint blocks_head;
+  guint blocks_count;
+  guint64 blocks_total;
+
+  // engine of both gating-sets
+  GstEbur128GatingEngine gating_engine;
+
+  // gating-blocks above the absolute gate, once EBUR128_MODE_I has been set
+  GstEbur128Gating *gating;
+
+  // short-term blocks above the absolute gate, once EBUR128_MODE_LRA has been set
+  GstEbur128Gating *range_gating;
+
+  // gating-blocks of the trailing horizon and the ring of periods it is summed from, the current one at
+  // horizon_period, all histograms and only with a horizon set
+  GstEbur128Gating *horizon_gating;
+  GstEbur128Gating **horizon_periods;
+  guint horizon_period;
+  guint64 horizon_period_blocks;
+  guint64 horizon_period_position;
+
+  // sub-blocks covering max_window, only if it is set
+  GstEbur128History *history;
+
+  gdouble *sample_peak;
+  gdouble *prev_sample_peak;
+  gdouble *true_peak;
+  gdouble *prev_true_peak;
+
+  // frames between two snapshots and since the last one, no snapshots are taken with an interval of 0
+  guint snapshot_interval;
+  guint snapshot_position;
+  GstEbur128StateSnapshotFunc snapshot_func;
+  gpointer snapshot_data;
+};
+
+GstEbur128State *gst_ebur128_state_new(guint channels, gulong samplerate, gint mode);
+void gst_ebur128_state_destroy(GstEbur128State **state);
+
+int gst_ebur128_state_set_channel(GstEbur128State *state, unsigned int channel_number, int value);
+int gst_ebur128_state_set_mode(GstEbur128State *state, gint mode);
+int gst_ebur128_state_set_max_window(GstEbur128State *state, gulong window);
+int gst_ebur128_state_set_max_history(GstEbur128State *state, gulong history);
+int gst_ebur128_state_set_gating_engine(GstEbur128State *state, GstEbur128GatingEngine engine);
+int gst_ebur128_state_set_prev_true_peak_floor(GstEbur128State *state, gdouble floor);
+int gst_ebur128_state_set_horizon(GstEbur128State *state, gulong horizon);
+int gst_ebur128_state_set_analysis_rate(GstEbur128State *state, gulong rate);
+void gst_ebur128_state_set_snapshot_func(GstEbur128State *state, guint interval, GstEbur128StateSnapshotFunc func,
+                                         gpointer user_data);
+
+int gst_ebur128_state_add_frames_short(GstEbur128State *state, const short *src, gsize frames);
+int gst_ebur128_state_add_frames_int(GstEbur128State *state, const int *src, gsize frames);
+int gst_ebur128_state_add_frames_float(GstEbur128State *state, const float *src, gsize frames);
+int gst_ebur128_state_add_frames_double(GstEbur128State *state, const double *src, gsize frames);
+
+int gst_ebur128_state_add_frames_planar_short(GstEbur128State *state, const short *const *src, gsize offset,
+                                              gsize frames);
+int gst_ebur128_state_add_frames_planar_int(GstEbur128State *state, const int *const *src, gsize offset, gsize frames);
+int gst_ebur128_state_add_frames_planar_float(GstEbur128State *state, const float *const *src, gsize offset,
+                                              gsize frames);
+int gst_ebur128_state_add_frames_planar_double(GstEbur128State *state, const double *const *src, gsize offset,
+                                               gsize frames);
+
+int gst_ebur128_state_add_frames_converted(GstEbur128State *state, GstEbur128SampleFormat format,
+                                           const gconstpointer *src, gboolean planar, gsize offset, gsize frames);
+
+GBytes *gst_ebur128_state_save(GstEbur128State *state);
+gboolean gst_ebur128_state_restore(GstEbur128State *state, GBytes *checkpoint, GError **error);
+gboolean gst_ebur128_state_carry_over(GstEbur128State *state, GstEbur128State *previous);
+
+int gst_ebur128_state_loudness_momentary(GstEbur128State *state, double *out);
+int gst_ebur128_state_loudness_shortterm(GstEbur128State *state, double *out);
+int gst_ebur128_state_loudness_global(GstEbur128State *state, double *out);
+int gst_ebur128_state_loudness_horizon(GstEbur128State *state, double *out);
+int gst_ebur128_state_loudness_window(GstEbur128State *state, gulong window, double *out);
+int gst_ebur128_state_loudness_range(GstEbur128State *state, double *out);
+
+int gst_ebur128_state_sample_peak(GstEbur128State *state, unsigned int channel_number, double *out);
+int gst_ebur128_state_prev_sample_peak(GstEbur128State *state, unsigned int channel_number, double *out);
+int gst_ebur128_state_true_peak(GstEbur128State *state, unsigned int channel_number, double *out);
+int gst_ebur128_state_prev_true_peak(GstEbur128State *state, unsigned int channel_number, double *out);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128STATE_H__
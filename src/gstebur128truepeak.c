@@ -0,0 +1,279 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstebur128truepeak.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GST_EBUR128_TRUEPEAK_X86 1
+#include <immintrin.h>
+#endif
+
+#define TAPS 49
+#define MAX_FACTOR 4
+
+// coefficients this close to zero are dropped from their phase, like libebur128 does
+#define ALMOST_ZERO 0.000001
+
+typedef struct _GstEbur128TruePeakPhase GstEbur128TruePeakPhase;
+struct _GstEbur128TruePeakPhase {
+  guint count;
+  gdouble coefficients[TAPS];
+
+  // distance of the input-sample multiplied with each coefficient, in doubles of the input-buffer
+  gsize offsets[TAPS];
+};
+
+typedef void (*GstEbur128TruePeakFunc)(GstEbur128TruePeak *truepeak, guint lane, const gdouble *input,
+                                       guint num_frames);
+
+struct _GstEbur128TruePeak {
+  guint channels;
+  guint stride;
+  guint lanes;
+  const gchar *kernel_name;
+  GstEbur128TruePeakFunc func;
+
+  guint factor;
+  GstEbur128TruePeakPhase phases[MAX_FACTOR];
+
+  // largest sum of absolute coefficients over all phases, no interpolated sample exceeds the input by more
+  gdouble gain;
+
+  // the last delay - 1 input-frames followed by the block in progress, (delay - 1 + max_frames) * stride doubles
+  gdouble *buffer;
+  guint delay;
+
+  // absolute maximum of the delay-line, of the block in progress and the interpolated peaks, stride entries each
+  gdouble *history_peak;
+  gdouble *block_peak;
+  gdouble *peak;
+};
+
+/**
+ * Hann-windowed sinc, split into one sub-filter per phase. Derived like libebur128 does, so both interpolate the same
+ * samples.
+ */
+static void gst_ebur128_truepeak_calculate_coefficients(GstEbur128TruePeak *truepeak) {
+  for (guint tap = 0; tap < TAPS; tap++) {
+    gdouble m = (gdouble)tap - (gdouble)(TAPS - 1) / 2.0;
+    gdouble c = 1.0;
+    if (fabs(m) > ALMOST_ZERO) {
+      c = sin(m * G_PI / truepeak->factor) / (m * G_PI / truepeak->factor);
+    }
+    c *= 0.5 * (1 - cos(2 * G_PI * tap / (TAPS - 1)));
+
+    if (fabs(c) > ALMOST_ZERO) {
+      GstEbur128TruePeakPhase *phase = &truepeak->phases[tap % truepeak->factor];
+      phase->coefficients[phase->count] = c;
+      phase->offsets[phase->count] = (gsize)(tap / truepeak->factor) * truepeak->stride;
+      phase->count++;
+    }
+  }
+
+  truepeak->gain = 0.0;
+  for (guint f = 0; f < truepeak->factor; f++) {
+    gdouble sum = 0.0;
+    for (guint t = 0; t < truepeak->phases[f].count; t++) {
+      sum += fabs(truepeak->phases[f].coefficients[t]);
+    }
+    truepeak->gain = MAX(truepeak->gain, sum);
+  }
+}
+
+/**
+ * Reference-Implementation, one lane at a time. Input points at the first frame of the block in the input-buffer, the
+ * delay-line in front of it provides the older samples.
+ */
+static void gst_ebur128_truepeak_process_scalar(GstEbur128TruePeak *truepeak, guint lane, const gdouble *input,
+                                                guint num_frames) {
+  const guint stride = truepeak->stride;
+  gdouble max = truepeak->peak[lane];
+
+  const gdouble *in = input + lane;
+  for (guint frame = 0; frame < num_frames; frame++, in += stride) {
+    for (guint f = 0; f < truepeak->factor; f++) {
+      const GstEbur128TruePeakPhase *phase = &truepeak->phases[f];
+      gdouble acc = 0.0;
+      for (guint t = 0; t < phase->count; t++) {
+        acc += phase->coefficients[t] * *(in - phase->offsets[t]);
+      }
+      max = MAX(max, fabs(acc));
+    }
+  }
+
+  truepeak->peak[lane] = max;
+}
+
+#ifdef GST_EBUR128_TRUEPEAK_X86
+/**
+ * Two lanes per __m128d, same operation-order as the scalar Implementation.
+ */
+__attribute__((target("sse2"))) static void
+gst_ebur128_truepeak_process_sse2(GstEbur128TruePeak *truepeak, guint lane, const gdouble *input, guint num_frames) {
+  const guint stride = truepeak->stride;
+  const __m128d sign = _mm_set1_pd(-0.0);
+  __m128d max = _mm_loadu_pd(&truepeak->peak[lane]);
+
+  const gdouble *in = input + lane;
+  for (guint frame = 0; frame < num_frames; frame++, in += stride) {
+    for (guint f = 0; f < truepeak->factor; f++) {
+      const GstEbur128TruePeakPhase *phase = &truepeak->phases[f];
+      __m128d acc = _mm_setzero_pd();
+      for (guint t = 0; t < phase->count; t++) {
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(phase->coefficients[t]), _mm_loadu_pd(in - phase->offsets[t])));
+      }
+      max = _mm_max_pd(max, _mm_andnot_pd(sign, acc));
+    }
+  }
+
+  _mm_storeu_pd(&truepeak->peak[lane], max);
+}
+
+/**
+ * Four lanes per __m256d, same operation-order as the scalar Implementation.
+ */
+__attribute__((target("avx2"))) static void
+gst_ebur128_truepeak_process_avx2(GstEbur128TruePeak *truepeak, guint lane, const gdouble *input, guint num_frames) {
+  const guint stride = truepeak->stride;
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d max = _mm256_loadu_pd(&truepeak->peak[lane]);
+
+  const gdouble *in = input + lane;
+  for (guint frame = 0; frame < num_frames; frame++, in += stride) {
+    for (guint f = 0; f < truepeak->factor; f++) {
+      const GstEbur128TruePeakPhase *phase = &truepeak->phases[f];
+      __m256d acc = _mm256_setzero_pd();
+      for (guint t = 0; t < phase->count; t++) {
+        __m256d sample = _mm256_loadu_pd(in - phase->offsets[t]);
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_set1_pd(phase->coefficients[t]), sample));
+      }
+      max = _mm256_max_pd(max, _mm256_andnot_pd(sign, acc));
+    }
+  }
+
+  _mm256_storeu_pd(&truepeak->peak[lane], max);
+}
+#endif
+
+static void gst_ebur128_truepeak_select_kernel(GstEbur128TruePeak *truepeak) {
+  truepeak->stride = truepeak->channels;
+  truepeak->lanes = 1;
+  truepeak->kernel_name = "scalar";
+  truepeak->func = gst_ebur128_truepeak_process_scalar;
+
+#ifdef GST_EBUR128_TRUEPEAK_X86
+  __builtin_cpu_init();
+
+  // mono gains nothing from lanes, stereo fits exactly into sse2 like in the K-Weighting Filter
+  if (truepeak->channels > 2 && __builtin_cpu_supports("avx2")) {
+    truepeak->stride = (truepeak->channels + 3) & ~3u;
+    truepeak->lanes = 4;
+    truepeak->kernel_name = "avx2";
+    truepeak->func = gst_ebur128_truepeak_process_avx2;
+  } else if (truepeak->channels > 1 && __builtin_cpu_supports("sse2")) {
+    truepeak->stride = (truepeak->channels + 1) & ~1u;
+    truepeak->lanes = 2;
+    truepeak->kernel_name = "sse2";
+    truepeak->func = gst_ebur128_truepeak_process_sse2;
+  }
+#endif
+}
+
+GstEbur128TruePeak *gst_ebur128_truepeak_new(guint channels, guint rate, guint max_frames) {
+  GstEbur128TruePeak *truepeak = g_new0(GstEbur128TruePeak, 1);
+  truepeak->channels = channels;
+
+  // same oversampling as libebur128, none at all from 192 kHz on
+  if (rate < 96000) {
+    truepeak->factor = 4;
+  } else if (rate < 192000) {
+    truepeak->factor = 2;
+  } else {
+    truepeak->factor = 1;
+  }
+
+  gst_ebur128_truepeak_select_kernel(truepeak);
+  gst_ebur128_truepeak_calculate_coefficients(truepeak);
+
+  truepeak->delay = (TAPS + truepeak->factor - 1) / truepeak->factor;
+  truepeak->buffer = g_new0(gdouble, (gsize)(truepeak->delay - 1 + max_frames) * truepeak->stride);
+  truepeak->history_peak = g_new0(gdouble, truepeak->stride);
+  truepeak->block_peak = g_new0(gdouble, truepeak->stride);
+  truepeak->peak = g_new0(gdouble, truepeak->stride);
+
+  return truepeak;
+}
+
+void gst_ebur128_truepeak_free(GstEbur128TruePeak *truepeak) {
+  g_free(truepeak->buffer);
+  g_free(truepeak->history_peak);
+  g_free(truepeak->block_peak);
+  g_free(truepeak->peak);
+  g_free(truepeak);
+}
+
+void gst_ebur128_truepeak_reset(GstEbur128TruePeak *truepeak) {
+  memset(truepeak->buffer, 0, (gsize)(truepeak->delay - 1) * truepeak->stride * sizeof(gdouble));
+  memset(truepeak->history_peak, 0, truepeak->stride * sizeof(gdouble));
+}
+
+guint gst_ebur128_truepeak_get_stride(GstEbur128TruePeak *truepeak) { return truepeak->stride; }
+
+guint gst_ebur128_truepeak_get_factor(GstEbur128TruePeak *truepeak) { return truepeak->factor; }
+
+const gchar *gst_ebur128_truepeak_get_kernel_name(GstEbur128TruePeak *truepeak) { return truepeak->kernel_name; }
+
+/**
+ * Interpolates num_frames frames of input and raises peak[c] of every channel to the largest absolute interpolated
+ * sample. Lane-groups whose peaks the block can not raise skip the filter. With bound, blocks that can not exceed
+ * bound[c] either are skipped as well, so peak[c] is only exact where it ends up above bound[c]. Returns the number of
+ * lane-groups that have been skipped.
+ */
+guint gst_ebur128_truepeak_process(GstEbur128TruePeak *truepeak, const gdouble *input, guint num_frames, gdouble *peak,
+                                   const gdouble *bound) {
+  const guint stride = truepeak->stride;
+  const guint history = truepeak->delay - 1;
+  if (truepeak->factor == 1) {
+    return 0;
+  }
+
+  gdouble *block = truepeak->buffer + (gsize)history * stride;
+  memcpy(block, input, (gsize)num_frames * stride * sizeof(gdouble));
+
+  memcpy(truepeak->block_peak, truepeak->history_peak, stride * sizeof(gdouble));
+  for (guint frame = 0; frame < num_frames; frame++) {
+    for (guint lane = 0; lane < stride; lane++) {
+      truepeak->block_peak[lane] = MAX(truepeak->block_peak[lane], fabs(block[frame * stride + lane]));
+    }
+  }
+
+  memcpy(truepeak->peak, peak, truepeak->channels * sizeof(gdouble));
+  guint skipped = 0;
+  for (guint lane = 0; lane < stride; lane += truepeak->lanes) {
+    gboolean skip = TRUE;
+    for (guint channel = lane; channel < MIN(lane + truepeak->lanes, truepeak->channels); channel++) {
+      gdouble known = bound != NULL ? MAX(truepeak->peak[channel], bound[channel]) : truepeak->peak[channel];
+      skip &= truepeak->block_peak[channel] * truepeak->gain <= known;
+    }
+
+    if (skip) {
+      skipped++;
+    } else {
+      truepeak->func(truepeak, lane, block, num_frames);
+    }
+  }
+  memcpy(peak, truepeak->peak, truepeak->channels * sizeof(gdouble));
+
+  // keep the newest frames as delay-line for the next block
+  memmove(truepeak->buffer, truepeak->buffer + (gsize)num_frames * stride, (gsize)history * stride * sizeof(gdouble));
+  memset(truepeak->history_peak, 0, stride * sizeof(gdouble));
+  for (guint frame = 0; frame < history; frame++) {
+    for (guint lane = 0; lane < stride; lane++) {
+      truepeak->history_peak[lane] = MAX(truepeak->history_peak[lane], fabs(truepeak->buffer[frame * stride + lane]));
+    }
+  }
+  return skipped;
+}
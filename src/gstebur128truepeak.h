@@ -0,0 +1,36 @@
+#ifndef __GST_EBUR128TRUEPEAK_H__
+#define __GST_EBUR128TRUEPEAK_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * True-Peak Meter (ITU-R BS.1770 Annex 2).
+ *
+ * Oversamples by 4 below 96 kHz and by 2 below 192 kHz with the same 49-tap polyphase FIR as libebur128 and tracks the
+ * absolute maximum of the interpolated samples, at 192 kHz and above the sample-peak is the true-peak. Frames are laid
+ * out like the input of the K-Weighting Filter, channel c of frame f at input[f * stride + c], but every channel has a
+ * lane of its own, and are processed with several channels side by side in SIMD-Lanes.
+ *
+ * Interpolated samples are bounded by the input-peak times the largest sum of absolute coefficients of a phase, so a
+ * group of lanes whose block of input could not raise any of their peaks even after interpolation skips the filter
+ * and only updates its delay-line. The resulting peaks are identical to not skipping. Where only the running maximum
+ * is needed, a block is also skipped when it can not exceed a peak measured before, like that of the whole stream.
+ */
+typedef struct _GstEbur128TruePeak GstEbur128TruePeak;
+
+GstEbur128TruePeak *gst_ebur128_truepeak_new(guint channels, guint rate, guint max_frames);
+void gst_ebur128_truepeak_free(GstEbur128TruePeak *truepeak);
+void gst_ebur128_truepeak_reset(GstEbur128TruePeak *truepeak);
+
+guint gst_ebur128_truepeak_get_stride(GstEbur128TruePeak *truepeak);
+guint gst_ebur128_truepeak_get_factor(GstEbur128TruePeak *truepeak);
+const gchar *gst_ebur128_truepeak_get_kernel_name(GstEbur128TruePeak *truepeak);
+
+guint gst_ebur128_truepeak_process(GstEbur128TruePeak *truepeak, const gdouble *input, guint num_frames, gdouble *peak,
+                                   const gdouble *bound);
+
+G_END_DECLS
+
+#endif // __GST_EBUR128TRUEPEAK_H__
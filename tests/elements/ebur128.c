@@ -8,18 +8,36 @@
 
 #include <gst/audio/audio.h>
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// only the layout, the api is looked up by name like any consumer outside of the plugin would
+#include "../../src/gstebur128archive.h"
+#include "../../src/gstebur128latest.h"
+#include "../../src/gstebur128measurement.h"
+#include "../../src/gstebur128shm.h"
+#include "../../src/gstebur128meta.h"
+
+// required to assert internal state
+#include "../../src/gstebur128element.h"
 
 #define SUPPORTED_AUDIO_FORMATS                                                                                        \
-  "{ " GST_AUDIO_NE(S16) ", " GST_AUDIO_NE(S32) "," GST_AUDIO_NE(F32) ", " GST_AUDIO_NE(F64) " }"
+  "{ " GST_AUDIO_NE(S16) ", " GST_AUDIO_NE(S32) "," GST_AUDIO_NE(F32) ", " GST_AUDIO_NE(F64) ", "                      \
+  GST_AUDIO_NE(S24) ", " GST_AUDIO_NE(S24_32) ", U8, "                                                                 \
+  GST_AUDIO_OE(S16) ", " GST_AUDIO_OE(S32) ", " GST_AUDIO_OE(F32) ", " GST_AUDIO_OE(F64) ", "                          \
+  GST_AUDIO_OE(S24) ", " GST_AUDIO_OE(S24_32) " }"
 
-#define SUPPORTED_AUDIO_CHANNELS "(int) {1, 2, 5 }"
+#define SUPPORTED_AUDIO_CHANNELS "(int) [ 1, MAX ]"
 
 #define SUPPORTED_CAPS_STRING                                                                                          \
   "audio/x-raw, "                                                                                                      \
   "format = (string) " SUPPORTED_AUDIO_FORMATS ", "                                                                    \
   "rate = " GST_AUDIO_RATE_RANGE ", "                                                                                  \
   "channels = " SUPPORTED_AUDIO_CHANNELS ", "                                                                          \
-  "layout = (string) interleaved "
+  "layout = (string) { interleaved, non-interleaved } "
 
 #define S16_CAPS_STRING                                                                                                \
   "audio/x-raw, "                                                                                                      \
@@ -46,6 +64,86 @@
                                          "layout = (string) interleaved, "                                             \
                                          "rate = (int) 48000, "                                                        \
                                          "channels = (int) 2"
+#define S24_CAPS_STRING                                                                                                \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S24) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 2"
+#define S24_32_CAPS_STRING                                                                                             \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S24_32) ", "                                                                       \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 2"
+#define U8_CAPS_STRING                                                                                                 \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) U8, "                                                                                             \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 2"
+#define S16_OE_CAPS_STRING                                                                                             \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_OE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 2"
+
+#define S16_96K_CAPS_STRING                                                                                            \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 96000, "                                                        \
+                                         "channels = (int) 2"
+
+#define S16_MONO_CAPS_STRING                                                                                           \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 1"
+#define S16_5CH_CAPS_STRING                                                                                            \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 5"
+
+#define F32_PLANAR_CAPS_STRING                                                                                         \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(F32) ", "                                                                          \
+                                         "layout = (string) non-interleaved, "                                         \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 2"
+
+#define S16_51_CAPS_STRING                                                                                             \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 6, "                                                        \
+                                         "channel-mask = (bitmask) 0x3f"
+#define S16_71_CAPS_STRING                                                                                             \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 8, "                                                        \
+                                         "channel-mask = (bitmask) 0xc3f"
+#define S16_16CH_CAPS_STRING                                                                                           \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 16, "                                                       \
+                                         "channel-mask = (bitmask) 0x0"
+#define S16_40CH_CAPS_STRING                                                                                           \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 40, "                                                       \
+                                         "channel-mask = (bitmask) 0x0"
 
 static GstStaticPadTemplate sinktemplate =
     GST_STATIC_PAD_TEMPLATE("sink", GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS(SUPPORTED_CAPS_STRING));
@@ -123,12 +221,23 @@ static GstBuffer *create_buffer(const char *caps_string, const guint num_msecs)
   GstBuffer *buf = gst_buffer_new_and_alloc(num_bytes);
   GST_BUFFER_TIMESTAMP(buf) = G_GUINT64_CONSTANT(0);
 
+  // planar buffers describe the position of their planes with a meta
+  if (GST_AUDIO_INFO_LAYOUT(&audio_info) == GST_AUDIO_LAYOUT_NON_INTERLEAVED) {
+    gst_buffer_add_audio_meta(buf, &audio_info, num_frames, NULL);
+  }
+
+  return buf;
+}
+
+static GstBuffer *create_silent_buffer(const char *caps_string, const guint num_msecs) {
+  GstBuffer *buf = create_buffer(caps_string, num_msecs);
+  gst_buffer_memset(buf, 0, 0, gst_buffer_get_size(buf));
   return buf;
 }
 
 #define DEFINE_TRIANGLE_BUFFER(NAME, T, MIN, MAX)                                                                      \
   static void fill_triangle_buffer_##NAME(guint8 *buffer_data, guint num_samples_per_wave, guint num_frames,           \
-                                          const guint channels) {                                                      \
+                                          const guint channels, gboolean planar) {                                     \
     T *ptr = (T *)buffer_data;                                                                                         \
                                                                                                                        \
     for (guint frame_idx = 0; frame_idx < num_frames; frame_idx++) {                                                   \
@@ -136,7 +245,8 @@ static GstBuffer *create_buffer(const char *caps_string, const guint num_msecs)
       T sample = (frame_idx % num_samples_per_wave) * (MAX / num_samples_per_wave * 2) - MIN;                          \
                                                                                                                        \
       for (gint channel_idx = 0; channel_idx < channels; channel_idx++) {                                              \
-        ptr[frame_idx * channels + channel_idx] = sample / 8;                                                          \
+        guint index = planar ? channel_idx * num_frames + frame_idx : frame_idx * channels + channel_idx;              \
+        ptr[index] = sample / 8;                                                                                       \
       }                                                                                                                \
     }                                                                                                                  \
   };
@@ -146,6 +256,29 @@ DEFINE_TRIANGLE_BUFFER(s32, gint, G_MININT, G_MAXINT)
 DEFINE_TRIANGLE_BUFFER(f32, gfloat, -1.0, 1.0)
 DEFINE_TRIANGLE_BUFFER(f64, gdouble, -1.0, 1.0)
 
+// 1 kHz Sine, 1/4 FS, in every channel of an interleaved S16 buffer
+static GstBuffer *create_sine_buffer(const char *caps_string, const guint num_msecs) {
+  GstBuffer *buf = create_buffer(caps_string, num_msecs);
+
+  GstAudioInfo audio_info;
+  caps_to_audio_info(caps_string, &audio_info);
+
+  GstMapInfo map;
+  gst_buffer_map(buf, &map, GST_MAP_WRITE);
+
+  gshort *ptr = (gshort *)map.data;
+  guint num_frames = audio_info.rate * num_msecs / 1000;
+  for (guint frame_idx = 0; frame_idx < num_frames; frame_idx++) {
+    gshort sample = G_MAXSHORT / 4 * sin(2 * G_PI * 1000 * frame_idx / audio_info.rate);
+    for (gint channel_idx = 0; channel_idx < audio_info.channels; channel_idx++) {
+      ptr[frame_idx * audio_info.channels + channel_idx] = sample;
+    }
+  }
+
+  gst_buffer_unmap(buf, &map);
+  return buf;
+}
+
 static GstBuffer *create_triangle_buffer(const char *caps_string, const guint num_msecs) {
   GstBuffer *buf = create_buffer(caps_string, num_msecs);
 
@@ -159,15 +292,24 @@ static GstBuffer *create_triangle_buffer(const char *caps_string, const guint nu
   guint num_samples_per_wave = audio_info.rate / 500 /* Hz */;
   guint num_frames = audio_info.rate * num_msecs / 1000;
 
+  gboolean planar = GST_AUDIO_INFO_LAYOUT(&audio_info) == GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+
   GST_INFO("num_samples_per_wave=%d", num_samples_per_wave);
   if (audio_info.finfo->format == GST_AUDIO_FORMAT_S16LE) {
-    fill_triangle_buffer_s16(map.data, num_samples_per_wave, num_frames, audio_info.channels);
+    fill_triangle_buffer_s16(map.data, num_samples_per_wave, num_frames, audio_info.channels, planar);
   } else if (audio_info.finfo->format == GST_AUDIO_FORMAT_S32LE) {
-    fill_triangle_buffer_s32(map.data, num_samples_per_wave, num_frames, audio_info.channels);
+    fill_triangle_buffer_s32(map.data, num_samples_per_wave, num_frames, audio_info.channels, planar);
   } else if (audio_info.finfo->format == GST_AUDIO_FORMAT_F32LE) {
-    fill_triangle_buffer_f32(map.data, num_samples_per_wave, num_frames, audio_info.channels);
+    fill_triangle_buffer_f32(map.data, num_samples_per_wave, num_frames, audio_info.channels, planar);
   } else if (audio_info.finfo->format == GST_AUDIO_FORMAT_F64LE) {
-    fill_triangle_buffer_f64(map.data, num_samples_per_wave, num_frames, audio_info.channels);
+    fill_triangle_buffer_f64(map.data, num_samples_per_wave, num_frames, audio_info.channels, planar);
+  } else if (audio_info.finfo->unpack_format == GST_AUDIO_FORMAT_S32 && !planar) {
+    // formats the element converts itself are packed from an S32 triangle, like audioconvert would
+    gint32 *unpacked = g_new(gint32, num_frames * audio_info.channels);
+    fill_triangle_buffer_s32((guint8 *)unpacked, num_samples_per_wave, num_frames, audio_info.channels, planar);
+    audio_info.finfo->pack_func(audio_info.finfo, GST_AUDIO_PACK_FLAG_NONE, unpacked, map.data,
+                                num_frames * audio_info.channels);
+    g_free(unpacked);
   } else {
     fail("Unhandled Format");
   }
@@ -385,7 +527,295 @@ GST_START_TEST(test_mode_change) {
 }
 GST_END_TEST;
 
-static void test_accepts(const char *caps_str) {
+GST_START_TEST(test_mode_change_keeps_global) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "global", TRUE, NULL);
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 1000));
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  gdouble global_before;
+  fail_unless(gst_structure_get_double(gst_message_get_structure(message), "global", &global_before));
+  gst_message_unref(message);
+
+  // enabling further measurements mid-stream keeps the integrated history, silence does not add to it
+  g_object_set(element, "range", TRUE, "true-peak", TRUE, NULL);
+  gst_pad_push(mysrcpad, create_silent_buffer(S16_CAPS_STRING, 1000));
+
+  message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+  gdouble global;
+  fail_unless(gst_structure_get_double(structure, "global", &global));
+  fail_unless(gst_structure_has_field(structure, "range"));
+  fail_unless(gst_structure_has_field(structure, "true-peak"));
+  GST_INFO("got global=%f, before=%f", global, global_before);
+  fail_unless_equals_float(global, global_before);
+
+  gst_message_unref(message);
+  cleanup_element();
+}
+GST_END_TEST;
+
+static GstBusSyncReply enable_global_on_message(GstBus *bus, GstMessage *message, gpointer user_data) {
+  if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ELEMENT) {
+    g_object_set(GST_MESSAGE_SRC(message), "global", TRUE, "shortterm", TRUE, NULL);
+  }
+  return GST_BUS_PASS;
+}
+
+GST_START_TEST(test_mode_change_mid_buffer) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "momentary", TRUE, NULL);
+
+  // enabled from the first message on, the measurements only apply from the next buffer on
+  gst_bus_set_sync_handler(bus, enable_global_on_message, NULL, NULL);
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 500));
+  gst_bus_set_sync_handler(bus, NULL, NULL, NULL);
+
+  for (int i = 0; i < 5; i++) {
+    GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+    const GstStructure *structure = gst_message_get_structure(message);
+    fail_unless(gst_structure_has_field(structure, "momentary"));
+    fail_if(gst_structure_has_field(structure, "global"));
+    fail_if(gst_structure_has_field(structure, "shortterm"));
+    gst_message_unref(message);
+  }
+
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 500));
+
+  for (int i = 0; i < 5; i++) {
+    GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+    const GstStructure *structure = gst_message_get_structure(message);
+    gdouble global, shortterm;
+    fail_unless(gst_structure_get_double(structure, "global", &global));
+    fail_unless(gst_structure_get_double(structure, "shortterm", &shortterm));
+    GST_INFO("got global=%f, shortterm=%f", global, shortterm);
+    fail_unless(global < 0.0 && shortterm < 0.0);
+    gst_message_unref(message);
+  }
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_max_history_change_applies) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "global", TRUE, NULL);
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 1000));
+  gst_message_unref(gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1));
+
+  // like the other properties a new max-history is applied by the running state with the next buffer, so the loud
+  // second drops out of the history and the global loudness is the one of the 12 dB quieter signal after it
+  g_object_set(element, "max-history", 1000UL, NULL);
+  GstBuffer *quiet = create_triangle_buffer(S16_CAPS_STRING, 3000);
+  GstMapInfo map;
+  gst_buffer_map(quiet, &map, GST_MAP_WRITE);
+  gshort *samples = (gshort *)map.data;
+  for (gsize i = 0; i < map.size / sizeof(gshort); i++) {
+    samples[i] /= 4;
+  }
+  gst_buffer_unmap(quiet, &map);
+  gst_pad_push(mysrcpad, quiet);
+
+  gdouble global;
+  for (guint i = 0; i < 3; i++) {
+    GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+    fail_unless(gst_structure_get_double(gst_message_get_structure(message), "global", &global));
+    gst_message_unref(message);
+  }
+
+  // with the whole history kept it would be about -25.5 LUFS
+  GST_INFO("got global=%f", global);
+  fail_unless(-33.0 < global && global < -31.0);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_renegotiation_keeps_global) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "global", TRUE, NULL);
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 1000));
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  gdouble global_before;
+  fail_unless(gst_structure_get_double(gst_message_get_structure(message), "global", &global_before));
+  gst_message_unref(message);
+
+  // a new format is analyzed by the same state, a new channel-layout by one continuing it, silence adds to neither
+  const gchar *caps_strings[] = {F32_CAPS_STRING, S16_51_CAPS_STRING};
+  for (guint i = 0; i < G_N_ELEMENTS(caps_strings); i++) {
+    GstCaps *caps = gst_caps_from_string(caps_strings[i]);
+    fail_unless(gst_pad_push_event(mysrcpad, gst_event_new_caps(caps)));
+    gst_caps_unref(caps);
+    gst_pad_push(mysrcpad, create_silent_buffer(caps_strings[i], 1000));
+
+    message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+    gdouble global;
+    fail_unless(gst_structure_get_double(gst_message_get_structure(message), "global", &global));
+    GST_INFO("got global=%f after %s, before=%f", global, caps_strings[i], global_before);
+    fail_unless_equals_float(global, global_before);
+    gst_message_unref(message);
+  }
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_global_loudness) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "global", TRUE, NULL);
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+
+  // a steady signal passes both gates with every block, so the integrated loudness matches the momentary one
+  gdouble global;
+  fail_unless(gst_structure_get_double(structure, "global", &global));
+  GST_INFO("got global=%f", global);
+  fail_unless(-20.0 < global && global < -19.0);
+
+  gst_message_unref(message);
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_integrated_horizon) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 3000 * GST_MSECOND, "global", TRUE, "integrated-horizon", (gulong)2000, NULL);
+
+  gulong integrated_horizon;
+  g_object_get(element, "integrated-horizon", &integrated_horizon, NULL);
+  fail_unless(integrated_horizon == 2000);
+
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 3000));
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+
+  gdouble global, horizon;
+  fail_unless(gst_structure_get_double(structure, "global", &global));
+  fail_unless(gst_structure_get_double(structure, "integrated-horizon", &horizon));
+  GST_INFO("got global=%f integrated-horizon=%f", global, horizon);
+  fail_unless(-20.0 < horizon && horizon < -19.0);
+  gst_message_unref(message);
+
+  // silence is below the absolute gate, the global loudness keeps the triangle while it expires from the horizon
+  gst_pad_push(mysrcpad, create_silent_buffer(S16_CAPS_STRING, 3000));
+
+  message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  structure = gst_message_get_structure(message);
+
+  fail_unless(gst_structure_get_double(structure, "global", &global));
+  fail_unless(gst_structure_get_double(structure, "integrated-horizon", &horizon));
+  GST_INFO("got global=%f integrated-horizon=%f", global, horizon);
+  fail_unless(-20.0 < global && global < -19.0);
+  fail_unless(isinf(horizon) && horizon < 0);
+
+  gst_message_unref(message);
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_save_and_restore_state) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 4000 * GST_MSECOND, "global", TRUE, "range", TRUE, NULL);
+
+  GBytes *checkpoint = NULL;
+  g_signal_emit_by_name(element, "save-state", &checkpoint);
+  fail_unless(checkpoint == NULL);
+
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 4000));
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+  gdouble saved_global, saved_range;
+  fail_unless(gst_structure_get_double(structure, "global", &saved_global));
+  fail_unless(gst_structure_get_double(structure, "range", &saved_range));
+  gst_message_unref(message);
+
+  g_signal_emit_by_name(element, "save-state", &checkpoint);
+  fail_unless(checkpoint != NULL);
+  cleanup_element();
+
+  // silence is below the absolute gate, so the restored element reports what the first one had measured
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "global", TRUE, "range", TRUE, NULL);
+  g_signal_emit_by_name(element, "restore-state", checkpoint);
+  gst_pad_push(mysrcpad, create_silent_buffer(S16_CAPS_STRING, 1000));
+
+  message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  structure = gst_message_get_structure(message);
+  gdouble global, range;
+  fail_unless(gst_structure_get_double(structure, "global", &global));
+  fail_unless(gst_structure_get_double(structure, "range", &range));
+  GST_INFO("restored global=%f range=%f, saved global=%f range=%f", global, range, saved_global, saved_range);
+  fail_unless_equals_float(global, saved_global);
+  fail_unless_equals_float(range, saved_range);
+  gst_message_unref(message);
+
+  // a truncated checkpoint is reported and leaves the state as it is
+  GBytes *truncated = g_bytes_new_from_bytes(checkpoint, 0, g_bytes_get_size(checkpoint) / 2);
+  g_signal_emit_by_name(element, "restore-state", truncated);
+  gst_pad_push(mysrcpad, create_silent_buffer(S16_CAPS_STRING, 1000));
+
+  message = gst_bus_poll(bus, GST_MESSAGE_WARNING, -1);
+  gst_message_unref(message);
+
+  message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  structure = gst_message_get_structure(message);
+  fail_unless(gst_structure_get_double(structure, "global", &global));
+  fail_unless_equals_float(global, saved_global);
+  gst_message_unref(message);
+
+  g_bytes_unref(truncated);
+  g_bytes_unref(checkpoint);
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_loudness_range) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 4000 * GST_MSECOND, "range", TRUE, NULL);
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 4000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+
+  // two short-term blocks of a steady signal, no spread in loudness
+  gdouble range;
+  fail_unless(gst_structure_get_double(structure, "range", &range));
+  GST_INFO("got range=%f", range);
+  fail_unless(0.0 <= range && range < 0.1);
+
+  gst_message_unref(message);
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_window_loudness) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "window", 60000, NULL);
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+
+  // the window reaches 59s before the stream started, that part counts as silence: 1s of signal is 17.8 LU down
+  gdouble window;
+  fail_unless(gst_structure_get_double(structure, "window", &window));
+  GST_INFO("got window=%f", window);
+  fail_unless(-38.0 < window && window < -37.0);
+
+  gst_message_unref(message);
+  cleanup_element();
+}
+GST_END_TEST;
+
+static void test_momentary_between(const char *caps_str, gdouble lower, gdouble upper) {
   setup_element(caps_str);
   g_object_set(element, "interval", 1000 * GST_MSECOND, NULL);
   GstBuffer *inbuffer = create_triangle_buffer(caps_str, 1000);
@@ -397,12 +827,14 @@ static void test_accepts(const char *caps_str) {
   gdouble momentary;
   gst_structure_get_double(structure, "momentary", &momentary);
   GST_INFO("got momentary=%f", momentary);
-  fail_unless(-20.0 < momentary && momentary < -19.0);
+  fail_unless(lower < momentary && momentary < upper);
 
   gst_message_unref(message);
   cleanup_element();
 }
 
+static void test_accepts(const char *caps_str) { test_momentary_between(caps_str, -20.0, -19.0); }
+
 GST_START_TEST(test_accepts_s16) { test_accepts(S16_CAPS_STRING); }
 GST_END_TEST;
 
@@ -415,6 +847,43 @@ GST_END_TEST;
 GST_START_TEST(test_accepts_f64) { test_accepts(F64_CAPS_STRING); }
 GST_END_TEST;
 
+GST_START_TEST(test_accepts_s24) { test_accepts(S24_CAPS_STRING); }
+GST_END_TEST;
+
+GST_START_TEST(test_accepts_s24_32) { test_accepts(S24_32_CAPS_STRING); }
+GST_END_TEST;
+
+GST_START_TEST(test_accepts_u8) { test_accepts(U8_CAPS_STRING); }
+GST_END_TEST;
+
+// opposite byte-order is swapped while converting, same loudness as native
+GST_START_TEST(test_accepts_s16_oe) { test_accepts(S16_OE_CAPS_STRING); }
+GST_END_TEST;
+
+// planes are read in place, same loudness as interleaved
+GST_START_TEST(test_accepts_f32_planar) { test_accepts(F32_PLANAR_CAPS_STRING); }
+GST_END_TEST;
+
+// mono runs through the frame-blocked filter-kernel, 3 dB below the stereo-signal
+GST_START_TEST(test_accepts_mono) { test_momentary_between(S16_MONO_CAPS_STRING, -23.0, -22.0); }
+GST_END_TEST;
+
+// 5 channels run through the widest filter-kernel, surround-channels are weighted with 1.41
+GST_START_TEST(test_accepts_5ch) { test_momentary_between(S16_5CH_CAPS_STRING, -15.0, -14.0); }
+GST_END_TEST;
+
+// the LFE is skipped, the rear channels are the weighted surround-pair: same loudness as the 5 channel stream
+GST_START_TEST(test_accepts_51) { test_momentary_between(S16_51_CAPS_STRING, -15.0, -14.0); }
+GST_END_TEST;
+
+// next to the weighted side channels the rear channels sit at +-135 degrees and count with 1.0
+GST_START_TEST(test_accepts_71) { test_momentary_between(S16_71_CAPS_STRING, -14.0, -13.0); }
+GST_END_TEST;
+
+// beyond the default channel-map of libebur128 unpositioned channels all count with 1.0: 12 dB above mono
+GST_START_TEST(test_accepts_16ch) { test_momentary_between(S16_16CH_CAPS_STRING, -11.0, -10.0); }
+GST_END_TEST;
+
 static void has_only_property(const char *prop_name) {
   GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
   const GstStructure *structure = gst_message_get_structure(message);
@@ -512,26 +981,784 @@ GST_END_TEST;
 GST_START_TEST(test_prop_window) { test_ulong_property("window", 42); }
 GST_END_TEST;
 
-GST_START_TEST(test_prop_range) { test_bool_property("range"); }
-GST_END_TEST;
+static void measure_analysis_rate(gulong analysis_rate, gdouble *momentary, gdouble *shortterm, gdouble *global,
+                                  gdouble *sample_peak) {
+  setup_element(S16_96K_CAPS_STRING);
+  g_object_set(element, "interval", 3000 * GST_MSECOND, "shortterm", TRUE, "global", TRUE, "sample-peak", TRUE,
+               "analysis-rate", analysis_rate, NULL);
 
-GST_START_TEST(test_prop_sample_peak) { test_bool_property("sample-peak"); }
-GST_END_TEST;
+  gulong read_back;
+  g_object_get(element, "analysis-rate", &read_back, NULL);
+  fail_unless(read_back == analysis_rate);
 
-GST_START_TEST(test_prop_true_peak) { test_bool_property("true-peak"); }
-GST_END_TEST;
+  gst_pad_push(mysrcpad, create_sine_buffer(S16_96K_CAPS_STRING, 3000));
 
-GST_START_TEST(test_prop_post_messages) {
-  setup_element(S16_CAPS_STRING);
-  g_object_set(element,
-               // interval
-               "interval", 100 * GST_MSECOND,
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+  fail_unless(gst_structure_get_double(structure, "momentary", momentary));
+  fail_unless(gst_structure_get_double(structure, "shortterm", shortterm));
+  fail_unless(gst_structure_get_double(structure, "global", global));
 
-               // post_messages
-               "post-messages", FALSE,
+  GValueArray *sample_peaks = g_value_get_boxed(gst_structure_get_value(structure, "sample-peak"));
+  *sample_peak = g_value_get_double(g_value_array_get_nth(sample_peaks, 0));
+  GST_INFO("analysis-rate=%lu: got momentary=%f shortterm=%f global=%f sample-peak=%f", analysis_rate, *momentary,
+           *shortterm, *global, *sample_peak);
 
-               // sentinel
-               NULL);
+  gst_message_unref(message);
+  cleanup_element();
+}
+
+// the filter runs at 48 kHz, the sine is well below its band and measures like at the native rate
+GST_START_TEST(test_prop_analysis_rate) {
+  gdouble native_momentary, native_shortterm, native_global, native_sample_peak;
+  measure_analysis_rate(0, &native_momentary, &native_shortterm, &native_global, &native_sample_peak);
+
+  gdouble momentary, shortterm, global, sample_peak;
+  measure_analysis_rate(48000, &momentary, &shortterm, &global, &sample_peak);
+
+  fail_unless(-13.0 < native_momentary && native_momentary < -12.0);
+  fail_unless(fabs(momentary - native_momentary) < 0.05);
+  fail_unless(fabs(shortterm - native_shortterm) < 0.05);
+  fail_unless(fabs(global - native_global) < 0.05);
+
+  // peaks are taken before decimating
+  fail_unless_equals_float(sample_peak, native_sample_peak);
+}
+GST_END_TEST;
+
+static void measure_gating_engine(const gchar *gating_engine, gdouble *global, gdouble *range) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 4000 * GST_MSECOND, "global", TRUE, "range", TRUE, NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "gating-engine", gating_engine);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 4000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+  fail_unless(gst_structure_get_double(structure, "global", global));
+  fail_unless(gst_structure_get_double(structure, "range", range));
+  GST_INFO("gating-engine=%s: got global=%f range=%f", gating_engine, *global, *range);
+
+  gst_message_unref(message);
+  cleanup_element();
+}
+
+GST_START_TEST(test_prop_gating_engine) {
+  gdouble exact_global, exact_range;
+  measure_gating_engine("exact", &exact_global, &exact_range);
+
+  gdouble histogram_global, histogram_range;
+  measure_gating_engine("histogram", &histogram_global, &histogram_range);
+
+  // the histogram only rounds the gates to its bins, the loudness itself is summed from the exact block energies
+  fail_unless(fabs(exact_global - histogram_global) < 0.01);
+  fail_unless(fabs(exact_range - histogram_range) < 0.02);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_true_peak_of_triangle) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "sample-peak", TRUE, "true-peak", TRUE, NULL);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+
+  GValueArray *sample_peaks = g_value_get_boxed(gst_structure_get_value(structure, "sample-peak"));
+  GValueArray *true_peaks = g_value_get_boxed(gst_structure_get_value(structure, "true-peak"));
+  gdouble sample_peak = g_value_get_double(g_value_array_get_nth(sample_peaks, 0));
+  gdouble true_peak = g_value_get_double(g_value_array_get_nth(true_peaks, 0));
+  GST_INFO("got sample-peak=%f true-peak=%f", sample_peak, true_peak);
+
+  // the wave jumps from its top back to its bottom once per period, which overshoots between the samples
+  fail_unless(0.12 < sample_peak && sample_peak < 0.13);
+  fail_unless(0.15 < true_peak && true_peak < 0.16);
+
+  gst_message_unref(message);
+  cleanup_element();
+}
+GST_END_TEST;
+
+// a loud second followed by a quiet one, returns the true-peak of the last message and the skipped lane-groups
+static guint64 measure_true_peak_skipped(gboolean attach_meta, gdouble *true_peak) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "true-peak", TRUE, "attach-meta", attach_meta, NULL);
+
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 1000));
+
+  GstBuffer *quiet = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  GstMapInfo map;
+  gst_buffer_map(quiet, &map, GST_MAP_WRITE);
+  gshort *samples = (gshort *)map.data;
+  for (gsize i = 0; i < map.size / sizeof(gshort); i++) {
+    samples[i] /= 4;
+  }
+  gst_buffer_unmap(quiet, &map);
+  gst_pad_push(mysrcpad, quiet);
+
+  for (guint i = 0; i < 20; i++) {
+    GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+    const GstStructure *structure = gst_message_get_structure(message);
+    GValueArray *true_peaks = g_value_get_boxed(gst_structure_get_value(structure, "true-peak"));
+    *true_peak = g_value_get_double(g_value_array_get_nth(true_peaks, 0));
+    gst_message_unref(message);
+  }
+
+  guint64 skipped = ((GstEbur128 *)element)->state->truepeak_skipped;
+  cleanup_element();
+  return skipped;
+}
+
+GST_START_TEST(test_true_peak_skips_quiet_blocks) {
+  // the meta carries the true-peak of every buffer, so the quiet one is oversampled in full
+  gdouble exact;
+  guint64 exact_skipped = measure_true_peak_skipped(TRUE, &exact);
+
+  // messages only report the true-peak since the start, which the quiet second can not raise
+  gdouble true_peak;
+  guint64 skipped = measure_true_peak_skipped(FALSE, &true_peak);
+
+  GST_INFO("got true-peak=%f with %" G_GUINT64_FORMAT " skipped, exact=%f with %" G_GUINT64_FORMAT " skipped",
+           true_peak, skipped, exact, exact_skipped);
+  fail_unless(skipped >= exact_skipped + 9);
+  fail_unless_equals_float(true_peak, exact);
+  fail_unless(0.15 < true_peak && true_peak < 0.16);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prop_async) {
+  GstMessage *message;
+  const GstStructure *structure;
+  GstClockTime timestamp;
+
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "async", TRUE, "async-queue-size", 4, NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "async-overflow", "block");
+
+  // more buffers than fit into the queue, so the streaming-thread has to wait for the analysis
+  for (gint buffer = 0; buffer < 10; buffer++) {
+    gst_pad_push(mysrcpad, create_buffer(S16_CAPS_STRING, 100));
+  }
+
+  // expect 10 messages in order, timestamped like the synchronous analysis would
+  for (gint iteration = 0; iteration < 10; iteration++) {
+    message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, GST_SECOND);
+    fail_if(message == NULL);
+
+    structure = gst_message_get_structure(message);
+    gst_structure_get_clock_time(structure, "timestamp", &timestamp);
+    GST_INFO("iteration=%d, timestamp=%" GST_TIME_FORMAT, iteration, GST_TIME_ARGS(timestamp));
+    fail_unless(timestamp == 100 * GST_MSECOND * (iteration + 1));
+    gst_message_unref(message);
+  }
+
+  // all buffers have been passed on
+  fail_unless_equals_int(g_list_length(buffers), 10);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prop_attach_meta) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "attach-meta", TRUE, "shortterm", TRUE, "sample-peak", TRUE, NULL);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  fail_unless_equals_int(g_list_length(buffers), 1);
+  GstBuffer *outbuffer = buffers->data;
+
+  GType api = g_type_from_name("GstEbur128MetaAPI");
+  fail_unless(api != 0);
+
+  // survives copies, like those made by tee or a writable queue
+  GstBuffer *copy = gst_buffer_copy(outbuffer);
+  GstEbur128Meta *meta = (GstEbur128Meta *)gst_buffer_get_meta(copy, api);
+  fail_unless(meta != NULL);
+
+  fail_unless(meta->flags ==
+              (GST_EBUR128_META_MOMENTARY | GST_EBUR128_META_SHORTTERM | GST_EBUR128_META_SAMPLE_PEAK));
+  GST_INFO("got momentary=%f shortterm=%f sample-peak=%f", meta->momentary, meta->shortterm, meta->sample_peak[0]);
+  fail_unless(-20.0 < meta->momentary && meta->momentary < -19.0);
+  // the 3s short-term window is only filled for a third
+  fail_unless(-25.0 < meta->shortterm && meta->shortterm < -24.0);
+
+  fail_unless_equals_int(meta->channels, 2);
+  fail_unless(0.12 < meta->sample_peak[0] && meta->sample_peak[0] < 0.13);
+  fail_unless(0.12 < meta->sample_peak[1] && meta->sample_peak[1] < 0.13);
+
+  gst_buffer_unref(copy);
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_shm) {
+  gchar *name = g_strdup_printf("/ebur128-test-%d", getpid());
+
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "post-messages", FALSE, "sample-peak", TRUE, "shm-name", name,
+               "shm-records", 8, NULL);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  // the ring only holds the last 8 of the 10 records
+  GError *error = NULL;
+  GstEbur128ShmReader *reader = gst_ebur128_shm_reader_open(name, TRUE, &error);
+  fail_unless(reader != NULL, "could not open %s: %s", name, error ? error->message : "");
+
+  const GstEbur128ShmHeader *header = gst_ebur128_shm_reader_get_header(reader);
+  fail_unless_equals_int(header->version, GST_EBUR128_SHM_VERSION);
+  fail_unless_equals_int(header->capacity, 8);
+  fail_unless_equals_int(header->channels, 2);
+  fail_unless_equals_int(header->record_size, GST_EBUR128_MEASUREMENT_SIZE(2, 0));
+
+  for (guint index = 2; index < 10; index++) {
+    const GstEbur128MeasurementRecord *record = gst_ebur128_shm_reader_peek(reader);
+    fail_unless(record != NULL);
+
+    fail_unless_equals_int(record->flags, GST_EBUR128_META_MOMENTARY | GST_EBUR128_META_SAMPLE_PEAK);
+    fail_unless_equals_uint64(record->timestamp, (index + 1) * 100 * GST_MSECOND);
+    fail_unless(-20.0 < record->momentary && record->momentary < -19.0);
+    fail_unless(0.12 < gst_ebur128_measurement_sample_peak(record)[0]);
+
+    fail_unless(gst_ebur128_shm_reader_release(reader));
+  }
+  fail_unless(gst_ebur128_shm_reader_peek(reader) == NULL);
+  fail_unless(!gst_ebur128_shm_reader_is_closed(reader));
+
+  // the next record is read in place, as soon as it is committed
+  inbuffer = create_triangle_buffer(S16_CAPS_STRING, 100);
+  gst_pad_push(mysrcpad, inbuffer);
+  const GstEbur128MeasurementRecord *record = gst_ebur128_shm_reader_peek(reader);
+  fail_unless(record != NULL);
+  fail_unless_equals_uint64(record->timestamp, 1100 * GST_MSECOND);
+  fail_unless(gst_ebur128_shm_reader_release(reader));
+
+  // stopping the element closes the ring and removes its name
+  cleanup_element();
+  fail_unless(gst_ebur128_shm_reader_is_closed(reader));
+  fail_unless_equals_uint64(gst_ebur128_shm_reader_get_lost(reader), 0);
+  gst_ebur128_shm_reader_close(reader);
+
+  fail_unless(gst_ebur128_shm_reader_open(name, TRUE, &error) == NULL);
+  g_clear_error(&error);
+  g_free(name);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_shm_rejects_foreign_layout) {
+  gchar *name = g_strdup_printf("/ebur128-test-%d", getpid());
+  GError *error = NULL;
+  GstEbur128ShmWriter *writer = gst_ebur128_shm_writer_new(name, 8, 2, 0, &error);
+  fail_unless(writer != NULL, "could not create %s: %s", name, error ? error->message : "");
+
+  int fd = shm_open(name, O_RDWR, 0);
+  fail_unless(fd >= 0);
+  GstEbur128ShmHeader *header = mmap(NULL, sizeof(GstEbur128ShmHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  fail_unless(header != MAP_FAILED);
+
+  // the capacity masks the slot index, so it has to be a power of two whose slots all fit into the segment
+  guint32 capacities[] = {0, 3, 1024};
+  for (guint i = 0; i < G_N_ELEMENTS(capacities); i++) {
+    header->capacity = capacities[i];
+    fail_unless(gst_ebur128_shm_reader_open(name, TRUE, &error) == NULL);
+    fail_unless(g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_INVAL));
+    g_clear_error(&error);
+  }
+
+  // records have to hold the channels they claim
+  header->capacity = 8;
+  header->channels = 64;
+  fail_unless(gst_ebur128_shm_reader_open(name, TRUE, &error) == NULL);
+  g_clear_error(&error);
+
+  header->channels = 2;
+  GstEbur128ShmReader *reader = gst_ebur128_shm_reader_open(name, TRUE, &error);
+  fail_unless(reader != NULL, "could not open %s: %s", name, error ? error->message : "");
+  gst_ebur128_shm_reader_close(reader);
+
+  munmap(header, sizeof(GstEbur128ShmHeader));
+  gst_ebur128_shm_writer_free(writer);
+  g_free(name);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prop_location) {
+  gchar *location = g_build_filename(g_get_tmp_dir(), "ebur128-test-log.csv", NULL);
+
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "post-messages", FALSE, "sample-peak", TRUE, "location",
+               location, "log-fsync-interval", GST_CLOCK_TIME_NONE, NULL);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  // stopping the element writes all queued rows
+  cleanup_element();
+
+  gchar *contents = NULL;
+  fail_unless(g_file_get_contents(location, &contents, NULL, NULL));
+  gchar **lines = g_strsplit(contents, "\n", -1);
+
+  // header, 10 rows and the empty string after the last newline
+  fail_unless_equals_int(g_strv_length(lines), 12);
+  fail_unless_equals_string(lines[0], "timestamp,running-time,stream-time,momentary,shortterm,global,range,"
+                                      "sample-peak-0,sample-peak-1,true-peak-0,true-peak-1");
+  for (guint index = 0; index < 10; index++) {
+    gchar **columns = g_strsplit(lines[index + 1], ",", -1);
+    fail_unless_equals_int(g_strv_length(columns), 11);
+    fail_unless_equals_uint64(g_ascii_strtoull(columns[0], NULL, 10), (index + 1) * 100 * GST_MSECOND);
+
+    gdouble momentary = g_ascii_strtod(columns[3], NULL);
+    fail_unless(-20.0 < momentary && momentary < -19.0);
+    g_strfreev(columns);
+  }
+  fail_unless_equals_string(lines[11], "");
+
+  g_strfreev(lines);
+  g_free(contents);
+  g_unlink(location);
+  g_free(location);
+}
+GST_END_TEST;
+
+static gboolean collect_archived(gint64 time, const GstEbur128MeasurementRecord *record, gpointer user_data) {
+  GArray *timestamps = user_data;
+  fail_unless(-20.0 < record->momentary && record->momentary < -19.0);
+  fail_unless(0.12 < gst_ebur128_measurement_sample_peak(record)[0]);
+  g_array_append_val(timestamps, record->timestamp);
+  return TRUE;
+}
+
+GST_START_TEST(test_prop_log_format_archive) {
+  gchar *location = g_build_filename(g_get_tmp_dir(), "ebur128-test-log.archive", NULL);
+  g_unlink(location);
+
+  // two runs into the same archive, the second one is appended
+  for (guint run = 0; run < 2; run++) {
+    setup_element(S16_CAPS_STRING);
+    g_object_set(element, "interval", 100 * GST_MSECOND, "post-messages", FALSE, "sample-peak", TRUE, "location",
+                 location, "log-format", GST_EBUR128_LOG_FORMAT_ARCHIVE, NULL);
+
+    GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+    gst_pad_push(mysrcpad, inbuffer);
+    cleanup_element();
+  }
+
+  GError *error = NULL;
+  GstEbur128ArchiveReader *reader = gst_ebur128_archive_reader_open(location, &error);
+  fail_unless(reader != NULL, "could not open %s: %s", location, error ? error->message : "");
+  fail_unless_equals_int(gst_ebur128_archive_reader_get_n_blocks(reader), 2);
+
+  GArray *timestamps = g_array_new(FALSE, FALSE, sizeof(guint64));
+  fail_unless(gst_ebur128_archive_reader_query(reader, G_MININT64, G_MAXINT64, collect_archived, timestamps, NULL));
+  fail_unless_equals_int(timestamps->len, 20);
+  for (guint index = 0; index < 20; index++) {
+    fail_unless_equals_uint64(g_array_index(timestamps, guint64, index), (index % 10 + 1) * 100 * GST_MSECOND);
+  }
+
+  // only the records of the second run are measured after it started
+  const GstEbur128ArchiveBlock *second = gst_ebur128_archive_reader_get_block(reader, 1);
+  g_array_set_size(timestamps, 0);
+  fail_unless(gst_ebur128_archive_reader_query(reader, second->first_time, G_MAXINT64, collect_archived, timestamps,
+                                               NULL));
+  fail_unless_equals_int(timestamps->len, 10);
+
+  g_array_free(timestamps, TRUE);
+  gst_ebur128_archive_reader_close(reader);
+  g_unlink(location);
+  g_free(location);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_get_latest) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "post-messages", FALSE, "true-peak", TRUE, NULL);
+
+  GstEbur128Latest latest;
+  gboolean valid = TRUE;
+  g_signal_emit_by_name(element, "get-latest", &latest, &valid);
+  fail_unless(!valid);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  g_signal_emit_by_name(element, "get-latest", &latest, &valid);
+  fail_unless(valid);
+
+  fail_unless_equals_int(latest.flags, GST_EBUR128_META_MOMENTARY | GST_EBUR128_META_TRUE_PEAK);
+  fail_unless_equals_int(latest.channels, 2);
+  fail_unless_equals_uint64(latest.timestamp, 1000 * GST_MSECOND);
+  fail_unless(-20.0 < latest.momentary && latest.momentary < -19.0);
+  fail_unless(0.15 < latest.true_peak[0] && latest.true_peak[0] < 0.16);
+  fail_unless(latest.shortterm == 0.0);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+static GList *measurements = NULL;
+
+static GstFlowReturn measurement_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer) {
+  measurements = g_list_append(measurements, buffer);
+  return GST_FLOW_OK;
+}
+
+GST_START_TEST(test_meas_src) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "post-messages", FALSE, "sample-peak", TRUE, "window", 400,
+               NULL);
+
+  GstPad *meas_srcpad = gst_element_request_pad_simple(element, "meas_src");
+  fail_unless(meas_srcpad != NULL);
+  // only one measurement pad per element
+  fail_unless(gst_element_request_pad_simple(element, "meas_src") == NULL);
+
+  GstPad *meas_sinkpad = gst_pad_new("meas_sink", GST_PAD_SINK);
+  gst_pad_set_chain_function(meas_sinkpad, measurement_chain);
+  gst_pad_set_active(meas_sinkpad, TRUE);
+  fail_unless(gst_pad_link(meas_srcpad, meas_sinkpad) == GST_PAD_LINK_OK);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  // no messages, but one record per interval
+  fail_unless(gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT) == NULL);
+  fail_unless_equals_int(g_list_length(measurements), 10);
+
+  GstCaps *caps = gst_pad_get_current_caps(meas_sinkpad);
+  GstStructure *structure = gst_caps_get_structure(caps, 0);
+  fail_unless(gst_structure_has_name(structure, GST_EBUR128_MEASUREMENT_MEDIA_TYPE));
+  gint channels, windows;
+  fail_unless(gst_structure_get_int(structure, "channels", &channels) && channels == 2);
+  fail_unless(gst_structure_get_int(structure, "windows", &windows) && windows == 1);
+  gst_caps_unref(caps);
+
+  guint index = 0;
+  for (GList *l = measurements; l != NULL; l = l->next, index++) {
+    GstBuffer *buffer = l->data;
+    fail_unless_equals_int(gst_buffer_get_size(buffer), GST_EBUR128_MEASUREMENT_SIZE(2, 1));
+
+    GstMapInfo map;
+    gst_buffer_map(buffer, &map, GST_MAP_READ);
+    GstEbur128MeasurementRecord *measurement = (GstEbur128MeasurementRecord *)map.data;
+
+    fail_unless_equals_int(measurement->version, GST_EBUR128_MEASUREMENT_VERSION);
+    fail_unless_equals_int(measurement->flags, GST_EBUR128_META_MOMENTARY | GST_EBUR128_META_SAMPLE_PEAK);
+    fail_unless_equals_uint64(measurement->timestamp, (index + 1) * 100 * GST_MSECOND);
+    fail_unless_equals_uint64(GST_BUFFER_PTS(buffer), measurement->timestamp);
+    if (index >= 3) {
+      // the momentary and the 400ms window are the same measurement once the window is filled
+      fail_unless(-20.0 < measurement->momentary && measurement->momentary < -19.0);
+      fail_unless(measurement->momentary == gst_ebur128_measurement_windows(measurement)[0]);
+    }
+    fail_unless(0.12 < gst_ebur128_measurement_sample_peak(measurement)[1]);
+
+    gst_buffer_unmap(buffer, &map);
+  }
+
+  g_list_free_full(measurements, (GDestroyNotify)gst_buffer_unref);
+  measurements = NULL;
+
+  gst_pad_unlink(meas_srcpad, meas_sinkpad);
+  gst_pad_set_active(meas_sinkpad, FALSE);
+  gst_object_unref(meas_sinkpad);
+  gst_element_release_request_pad(element, meas_srcpad);
+  gst_object_unref(meas_srcpad);
+  cleanup_element();
+}
+GST_END_TEST;
+
+static GList *measurement_gaps = NULL;
+static GMutex measurement_lock;
+static GCond measurement_cond;
+static gboolean measurement_blocked, measurement_released;
+
+static gboolean measurement_event(GstPad *pad, GstObject *parent, GstEvent *event) {
+  if (GST_EVENT_TYPE(event) == GST_EVENT_GAP) {
+    measurement_gaps = g_list_append(measurement_gaps, gst_event_ref(event));
+  }
+  gst_event_unref(event);
+  return TRUE;
+}
+
+// stands in for a sink that waits for preroll
+static GstFlowReturn blocking_measurement_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer) {
+  g_mutex_lock(&measurement_lock);
+  measurement_blocked = TRUE;
+  g_cond_broadcast(&measurement_cond);
+  while (!measurement_released) {
+    g_cond_wait(&measurement_cond, &measurement_lock);
+  }
+  g_mutex_unlock(&measurement_lock);
+
+  gst_buffer_unref(buffer);
+  return GST_FLOW_OK;
+}
+
+static gpointer push_buffer(gpointer buffer) {
+  gst_pad_push(mysrcpad, buffer);
+  return NULL;
+}
+
+GST_START_TEST(test_meas_src_gap_and_blocking) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "post-messages", FALSE, NULL);
+
+  GstPad *meas_srcpad = gst_element_request_pad_simple(element, "meas_src");
+  GstPad *meas_sinkpad = gst_pad_new("meas_sink", GST_PAD_SINK);
+  gst_pad_set_chain_function(meas_sinkpad, blocking_measurement_chain);
+  gst_pad_set_event_function(meas_sinkpad, measurement_event);
+  gst_pad_set_active(meas_sinkpad, TRUE);
+  fail_unless(gst_pad_link(meas_srcpad, meas_sinkpad) == GST_PAD_LINK_OK);
+
+  // a buffer shorter than the interval completes no record, the stream is advanced by a gap after its caps
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 50));
+  fail_unless_equals_int(g_list_length(measurement_gaps), 1);
+  GstClockTime timestamp, duration;
+  gst_event_parse_gap(measurement_gaps->data, &timestamp, &duration);
+  fail_unless_equals_uint64(timestamp, 0);
+  fail_unless_equals_uint64(duration, 50 * GST_MSECOND);
+
+  GstCaps *caps = gst_pad_get_current_caps(meas_sinkpad);
+  fail_unless(caps != NULL);
+  gst_caps_unref(caps);
+
+  // the next one completes a record, which is pushed after the state-lock has been released
+  GThread *thread = g_thread_new("push", push_buffer, create_triangle_buffer(S16_CAPS_STRING, 100));
+  g_mutex_lock(&measurement_lock);
+  while (!measurement_blocked) {
+    g_cond_wait(&measurement_cond, &measurement_lock);
+  }
+  g_mutex_unlock(&measurement_lock);
+
+  GBytes *checkpoint = NULL;
+  g_signal_emit_by_name(element, "save-state", &checkpoint);
+  fail_unless(checkpoint != NULL);
+  g_bytes_unref(checkpoint);
+
+  g_mutex_lock(&measurement_lock);
+  measurement_released = TRUE;
+  g_cond_broadcast(&measurement_cond);
+  g_mutex_unlock(&measurement_lock);
+  g_thread_join(thread);
+
+  g_list_free_full(measurement_gaps, (GDestroyNotify)gst_event_unref);
+  measurement_gaps = NULL;
+
+  gst_pad_unlink(meas_srcpad, meas_sinkpad);
+  gst_pad_set_active(meas_sinkpad, FALSE);
+  gst_object_unref(meas_sinkpad);
+  gst_element_release_request_pad(element, meas_srcpad);
+  gst_object_unref(meas_srcpad);
+  cleanup_element();
+}
+GST_END_TEST;
+
+static gpointer push_buffer_flow(gpointer buffer) {
+  return GINT_TO_POINTER(gst_pad_push(mysrcpad, buffer));
+}
+
+GST_START_TEST(test_async_flush) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "async", TRUE, "async-queue-size", 1, NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "async-overflow", "block");
+  measurement_blocked = measurement_released = FALSE;
+
+  GstPad *meas_srcpad = gst_element_request_pad_simple(element, "meas_src");
+  GstPad *meas_sinkpad = gst_pad_new("meas_sink", GST_PAD_SINK);
+  gst_pad_set_chain_function(meas_sinkpad, blocking_measurement_chain);
+  gst_pad_set_event_function(meas_sinkpad, measurement_event);
+  gst_pad_set_active(meas_sinkpad, TRUE);
+  fail_unless(gst_pad_link(meas_srcpad, meas_sinkpad) == GST_PAD_LINK_OK);
+
+  // the analysis-thread waits in meas_src with the first buffer, the second one fills the queue
+  fail_unless_equals_int(gst_pad_push(mysrcpad, create_buffer(S16_CAPS_STRING, 100)), GST_FLOW_OK);
+  g_mutex_lock(&measurement_lock);
+  while (!measurement_blocked) {
+    g_cond_wait(&measurement_cond, &measurement_lock);
+  }
+  g_mutex_unlock(&measurement_lock);
+  fail_unless_equals_int(gst_pad_push(mysrcpad, create_buffer(S16_CAPS_STRING, 100)), GST_FLOW_OK);
+
+  // the third one waits for space until the flush wakes it up
+  GThread *thread = g_thread_new("push", push_buffer_flow, create_buffer(S16_CAPS_STRING, 100));
+  g_usleep(10 * G_TIME_SPAN_MILLISECOND);
+  fail_unless(gst_pad_push_event(mysrcpad, gst_event_new_flush_start()));
+  fail_unless_equals_int(GPOINTER_TO_INT(g_thread_join(thread)), GST_FLOW_FLUSHING);
+
+  g_mutex_lock(&measurement_lock);
+  measurement_released = TRUE;
+  g_cond_broadcast(&measurement_cond);
+  g_mutex_unlock(&measurement_lock);
+
+  fail_unless(gst_pad_push_event(mysrcpad, gst_event_new_flush_stop(TRUE)));
+  GstSegment segment;
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  fail_unless(gst_pad_push_event(mysrcpad, gst_event_new_segment(&segment)));
+  fail_unless_equals_int(gst_pad_push(mysrcpad, create_buffer(S16_CAPS_STRING, 100)), GST_FLOW_OK);
+
+  // the queued second buffer has been dropped, so the one after the flush continues right after the first
+  GstClockTime expected_timestamps[] = {100 * GST_MSECOND, 200 * GST_MSECOND};
+  for (guint i = 0; i < G_N_ELEMENTS(expected_timestamps); i++) {
+    GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, GST_SECOND);
+    fail_if(message == NULL);
+
+    GstClockTime timestamp;
+    fail_unless(gst_structure_get_clock_time(gst_message_get_structure(message), "timestamp", &timestamp));
+    fail_unless_equals_uint64(timestamp, expected_timestamps[i]);
+    gst_message_unref(message);
+  }
+
+  g_list_free_full(measurement_gaps, (GDestroyNotify)gst_event_unref);
+  measurement_gaps = NULL;
+
+  gst_pad_unlink(meas_srcpad, meas_sinkpad);
+  gst_pad_set_active(meas_sinkpad, FALSE);
+  gst_object_unref(meas_sinkpad);
+  gst_element_release_request_pad(element, meas_srcpad);
+  gst_object_unref(meas_srcpad);
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prop_windows) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "momentary", FALSE, NULL);
+
+  // set like gst-launch would, with plain integers
+  gst_util_set_object_arg(G_OBJECT(element), "windows", "<400, 1000, 10000>");
+
+  GValue read_back_value = G_VALUE_INIT;
+  g_value_init(&read_back_value, GST_TYPE_ARRAY);
+  g_object_get_property(G_OBJECT(element), "windows", &read_back_value);
+  fail_unless(gst_value_array_get_size(&read_back_value) == 3);
+  fail_unless(g_value_get_ulong(gst_value_array_get_value(&read_back_value, 2)) == 10000);
+  g_value_unset(&read_back_value);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+
+  fail_unless(gst_structure_n_fields(structure) == 4);
+  const GValue *windows_gvalue = gst_structure_get_value(structure, "windows");
+  fail_unless(windows_gvalue != NULL);
+
+  // one value per window, in the order of the property; the 10s window is 90% silence
+  GValueArray *windows = g_value_get_boxed(windows_gvalue);
+  fail_unless(windows->n_values == 3);
+  gdouble short_window = g_value_get_double(g_value_array_get_nth(windows, 0));
+  gdouble long_window = g_value_get_double(g_value_array_get_nth(windows, 2));
+  GST_INFO("got windows=%f,%f", short_window, long_window);
+  fail_unless(-20.0 < short_window && short_window < -19.0);
+  fail_unless(-30.0 < long_window && long_window < -29.0);
+
+  gst_message_unref(message);
+  cleanup_element();
+}
+GST_END_TEST;
+
+static GstBusSyncReply lengthen_windows_on_message(GstBus *bus, GstMessage *message, gpointer user_data) {
+  if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ELEMENT) {
+    gst_util_set_object_arg(G_OBJECT(GST_MESSAGE_SRC(message)), "windows", "<400, 10000>");
+  }
+  return GST_BUS_PASS;
+}
+
+GST_START_TEST(test_windows_change_mid_buffer) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "momentary", FALSE, NULL);
+  gst_util_set_object_arg(G_OBJECT(element), "windows", "<400>");
+
+  // the longer window is set from the first message on, the history only grows for it with the next buffer
+  gst_bus_set_sync_handler(bus, lengthen_windows_on_message, NULL, NULL);
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 500));
+  gst_bus_set_sync_handler(bus, NULL, NULL, NULL);
+
+  for (int i = 0; i < 5; i++) {
+    GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+    GValueArray *windows = g_value_get_boxed(gst_structure_get_value(gst_message_get_structure(message), "windows"));
+    fail_unless(windows->n_values == 1);
+    gst_message_unref(message);
+  }
+
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 500));
+
+  for (int i = 0; i < 5; i++) {
+    GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+    GValueArray *windows = g_value_get_boxed(gst_structure_get_value(gst_message_get_structure(message), "windows"));
+    fail_unless(windows->n_values == 2);
+    gdouble long_window = g_value_get_double(g_value_array_get_nth(windows, 1));
+    GST_INFO("got long window=%f", long_window);
+    fail_unless(long_window < -20.0 && long_window > -HUGE_VAL);
+    gst_message_unref(message);
+  }
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prop_range) { test_bool_property("range"); }
+GST_END_TEST;
+
+GST_START_TEST(test_prop_sample_peak) { test_bool_property("sample-peak"); }
+GST_END_TEST;
+
+GST_START_TEST(test_prop_true_peak) { test_bool_property("true-peak"); }
+GST_END_TEST;
+
+GST_START_TEST(test_prop_packed_peaks) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1000 * GST_MSECOND, "sample-peak", TRUE, "true-peak", TRUE, "packed-peaks", TRUE,
+               NULL);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  GstMessage *message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, -1);
+  const GstStructure *structure = gst_message_get_structure(message);
+
+  GBytes *sample_peak = NULL, *true_peak = NULL;
+  fail_unless(gst_structure_get(structure, "sample-peak", G_TYPE_BYTES, &sample_peak, "true-peak", G_TYPE_BYTES,
+                                &true_peak, NULL));
+
+  // one native double per channel
+  gsize size;
+  const gdouble *sample_peaks = g_bytes_get_data(sample_peak, &size);
+  fail_unless_equals_int(size, 2 * sizeof(gdouble));
+  fail_unless(0.12 < sample_peaks[0] && sample_peaks[0] < 0.13);
+  fail_unless(0.12 < sample_peaks[1] && sample_peaks[1] < 0.13);
+
+  const gdouble *true_peaks = g_bytes_get_data(true_peak, &size);
+  fail_unless_equals_int(size, 2 * sizeof(gdouble));
+  fail_unless(0.15 < true_peaks[0] && true_peaks[0] < 0.16);
+
+  g_bytes_unref(sample_peak);
+  g_bytes_unref(true_peak);
+  gst_message_unref(message);
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prop_post_messages) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element,
+               // interval
+               "interval", 100 * GST_MSECOND,
+
+               // post_messages
+               "post-messages", FALSE,
+
+               // sentinel
+               NULL);
 
   GstBuffer *inbuffer = create_buffer(S16_CAPS_STRING, 100);
   gst_pad_push(mysrcpad, inbuffer);
@@ -543,6 +1770,134 @@ GST_START_TEST(test_prop_post_messages) {
 }
 GST_END_TEST;
 
+GST_START_TEST(test_prop_post_threshold) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "post-threshold", 1.0, NULL);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  // the momentary loudness changes by more than 1 LU until its 400ms window is filled and then stays
+  GstClockTime expected_timestamps[] = {100 * GST_MSECOND, 200 * GST_MSECOND, 300 * GST_MSECOND, 400 * GST_MSECOND};
+  for (guint i = 0; i < G_N_ELEMENTS(expected_timestamps); i++) {
+    GstMessage *message = gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT);
+    fail_unless(message != NULL);
+
+    GstClockTime timestamp;
+    fail_unless(gst_structure_get_clock_time(gst_message_get_structure(message), "timestamp", &timestamp));
+    fail_unless_equals_uint64(timestamp, expected_timestamps[i]);
+    gst_message_unref(message);
+  }
+  fail_unless(gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  // the last message at EOS is always posted
+  gst_pad_push_event(mysrcpad, gst_event_new_eos());
+  GstMessage *message = gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT);
+  fail_unless(message != NULL);
+  gst_message_unref(message);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prop_post_max_silence) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "post-threshold", 100.0, "post-max-silence",
+               500 * GST_MSECOND, NULL);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 2000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  // nothing changes by 100 LU, so only the first one and one every 500ms are posted
+  GstClockTime expected_timestamps[] = {100 * GST_MSECOND, 600 * GST_MSECOND, 1100 * GST_MSECOND,
+                                        1600 * GST_MSECOND};
+  for (guint i = 0; i < G_N_ELEMENTS(expected_timestamps); i++) {
+    GstMessage *message = gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT);
+    fail_unless(message != NULL);
+
+    GstClockTime timestamp;
+    fail_unless(gst_structure_get_clock_time(gst_message_get_structure(message), "timestamp", &timestamp));
+    fail_unless_equals_uint64(timestamp, expected_timestamps[i]);
+    gst_message_unref(message);
+  }
+  fail_unless(gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_post_threshold_beyond_latest_channels) {
+  setup_element(S16_40CH_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "momentary", FALSE, "sample-peak", TRUE, "post-threshold", 1.0,
+               NULL);
+
+  // nothing changes in silence, so only the first one is posted
+  gst_pad_push(mysrcpad, create_silent_buffer(S16_40CH_CAPS_STRING, 500));
+  GstMessage *message = gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT);
+  fail_unless(message != NULL);
+  gst_message_unref(message);
+  fail_unless(gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  // a peak on a channel beyond the latest values is a change as well
+  GstBuffer *inbuffer = create_silent_buffer(S16_40CH_CAPS_STRING, 100);
+  GST_BUFFER_TIMESTAMP(inbuffer) = 500 * GST_MSECOND;
+  GstMapInfo map;
+  gst_buffer_map(inbuffer, &map, GST_MAP_WRITE);
+  ((gint16 *)map.data)[35] = G_MAXINT16 / 2;
+  gst_buffer_unmap(inbuffer, &map);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  message = gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT);
+  fail_unless(message != NULL);
+  const GstStructure *structure = gst_message_get_structure(message);
+  GValueArray *sample_peaks = g_value_get_boxed(gst_structure_get_value(structure, "sample-peak"));
+  fail_unless_equals_int(sample_peaks->n_values, 40);
+  gdouble sample_peak = g_value_get_double(g_value_array_get_nth(sample_peaks, 35));
+  GST_INFO("got sample-peak=%f on channel 35", sample_peak);
+  fail_unless(0.49 < sample_peak && sample_peak < 0.51);
+  gst_message_unref(message);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_prop_post_batch) {
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 100 * GST_MSECOND, "post-batch", 4, NULL);
+
+  GstBuffer *inbuffer = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  // 10 intervals make two full batches, the remaining two are posted at EOS together with the last measurement
+  gst_pad_push_event(mysrcpad, gst_event_new_eos());
+
+  guint expected_sizes[] = {4, 4, 3};
+  guint index = 0;
+  for (guint i = 0; i < G_N_ELEMENTS(expected_sizes); i++) {
+    GstMessage *message = gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT);
+    fail_unless(message != NULL);
+
+    const GstStructure *structure = gst_message_get_structure(message);
+    fail_unless(gst_structure_has_name(structure, "loudness-batch"));
+
+    const GValue *measurements = gst_structure_get_value(structure, "measurements");
+    fail_unless_equals_int(gst_value_array_get_size(measurements), expected_sizes[i]);
+    for (guint j = 0; j < expected_sizes[i]; j++, index++) {
+      const GstStructure *measurement = gst_value_get_structure(gst_value_array_get_value(measurements, j));
+      fail_unless(gst_structure_has_name(measurement, "loudness"));
+
+      GstClockTime timestamp;
+      fail_unless(gst_structure_get_clock_time(measurement, "timestamp", &timestamp));
+      fail_unless_equals_uint64(timestamp, MIN(index + 1, 10) * 100 * GST_MSECOND);
+    }
+    gst_message_unref(message);
+  }
+  fail_unless(gst_bus_pop_filtered(bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
 // buffers smaller then interval
 GST_START_TEST(test_small_buffers) {
   GstMessage *message;
@@ -685,6 +2040,39 @@ GST_START_TEST(test_large_buffers) {
 }
 GST_END_TEST;
 
+// interval much smaller then buffers
+GST_START_TEST(test_short_interval) {
+  GstMessage *message;
+  const GstStructure *structure;
+  GstBuffer *inbuffer;
+  GstClockTime timestamp;
+
+  setup_element(S16_CAPS_STRING);
+  g_object_set(element, "interval", 1 * GST_MSECOND, NULL);
+
+  // 100 ms
+  inbuffer = create_buffer(S16_CAPS_STRING, 100);
+  gst_pad_push(mysrcpad, inbuffer);
+
+  // expect 100 messages
+  for (gint iteration = 0; iteration < 100; iteration++) {
+    message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, 50 * GST_MSECOND);
+    fail_if(message == NULL);
+
+    // validate timestamp
+    structure = gst_message_get_structure(message);
+    gst_structure_get_clock_time(structure, "timestamp", &timestamp);
+    fail_unless(timestamp == 1 * GST_MSECOND * (iteration + 1));
+    gst_message_unref(message);
+  }
+
+  message = gst_bus_poll(bus, GST_MESSAGE_ELEMENT, 50 * GST_MSECOND);
+  fail_unless(message == NULL);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
 static Suite *element_suite(void) {
   Suite *s = suite_create("ebur128");
 
@@ -696,6 +2084,15 @@ static Suite *element_suite(void) {
   tcase_add_test(tc_general, test_timestamps);
   tcase_add_test(tc_general, test_per_channel_array);
   tcase_add_test(tc_general, test_mode_change);
+  tcase_add_test(tc_general, test_mode_change_keeps_global);
+  tcase_add_test(tc_general, test_mode_change_mid_buffer);
+  tcase_add_test(tc_general, test_max_history_change_applies);
+  tcase_add_test(tc_general, test_renegotiation_keeps_global);
+  tcase_add_test(tc_general, test_global_loudness);
+  tcase_add_test(tc_general, test_integrated_horizon);
+  tcase_add_test(tc_general, test_save_and_restore_state);
+  tcase_add_test(tc_general, test_loudness_range);
+  tcase_add_test(tc_general, test_window_loudness);
 
   TCase *tc_audio_formats = tcase_create("audio_formats");
   suite_add_tcase(s, tc_audio_formats);
@@ -703,6 +2100,16 @@ static Suite *element_suite(void) {
   tcase_add_test(tc_audio_formats, test_accepts_s32);
   tcase_add_test(tc_audio_formats, test_accepts_f32);
   tcase_add_test(tc_audio_formats, test_accepts_f64);
+  tcase_add_test(tc_audio_formats, test_accepts_s24);
+  tcase_add_test(tc_audio_formats, test_accepts_s24_32);
+  tcase_add_test(tc_audio_formats, test_accepts_u8);
+  tcase_add_test(tc_audio_formats, test_accepts_s16_oe);
+  tcase_add_test(tc_audio_formats, test_accepts_f32_planar);
+  tcase_add_test(tc_audio_formats, test_accepts_mono);
+  tcase_add_test(tc_audio_formats, test_accepts_5ch);
+  tcase_add_test(tc_audio_formats, test_accepts_51);
+  tcase_add_test(tc_audio_formats, test_accepts_71);
+  tcase_add_test(tc_audio_formats, test_accepts_16ch);
 
   TCase *tc_properties = tcase_create("properties");
   suite_add_tcase(s, tc_properties);
@@ -710,10 +2117,31 @@ static Suite *element_suite(void) {
   tcase_add_test(tc_properties, test_prop_shortterm);
   tcase_add_test(tc_properties, test_prop_global);
   tcase_add_test(tc_properties, test_prop_window);
+  tcase_add_test(tc_properties, test_prop_windows);
+  tcase_add_test(tc_properties, test_windows_change_mid_buffer);
+  tcase_add_test(tc_properties, test_prop_analysis_rate);
+  tcase_add_test(tc_properties, test_prop_gating_engine);
+  tcase_add_test(tc_properties, test_prop_async);
+  tcase_add_test(tc_properties, test_prop_attach_meta);
+  tcase_add_test(tc_properties, test_meas_src);
+  tcase_add_test(tc_properties, test_meas_src_gap_and_blocking);
+  tcase_add_test(tc_properties, test_async_flush);
+  tcase_add_test(tc_properties, test_get_latest);
+  tcase_add_test(tc_properties, test_shm);
+  tcase_add_test(tc_properties, test_shm_rejects_foreign_layout);
+  tcase_add_test(tc_properties, test_prop_location);
+  tcase_add_test(tc_properties, test_prop_log_format_archive);
   tcase_add_test(tc_properties, test_prop_range);
   tcase_add_test(tc_properties, test_prop_sample_peak);
   tcase_add_test(tc_properties, test_prop_true_peak);
+  tcase_add_test(tc_properties, test_true_peak_of_triangle);
+  tcase_add_test(tc_properties, test_true_peak_skips_quiet_blocks);
+  tcase_add_test(tc_properties, test_prop_packed_peaks);
   tcase_add_test(tc_properties, test_prop_post_messages);
+  tcase_add_test(tc_properties, test_prop_post_threshold);
+  tcase_add_test(tc_properties, test_prop_post_max_silence);
+  tcase_add_test(tc_properties, test_post_threshold_beyond_latest_channels);
+  tcase_add_test(tc_properties, test_prop_post_batch);
   // prop "interval" is thoroughly tested in the buffer-size testcase
 
   TCase *tc_buffer_size = tcase_create("buffer_size");
@@ -721,6 +2149,7 @@ static Suite *element_suite(void) {
   tcase_add_test(tc_buffer_size, test_small_buffers);
   tcase_add_test(tc_buffer_size, test_medium_buffers);
   tcase_add_test(tc_buffer_size, test_large_buffers);
+  tcase_add_test(tc_buffer_size, test_short_interval);
 
   return s;
 }
@@ -8,16 +8,18 @@
 
 #include <gst/audio/audio.h>
 #include <gst/check/gstcheck.h>
+#include <math.h>
 
 // required to assert internal state
 #include "../src/gstebur128graphelement.h"
+#include "../src/gstebur128meta.h"
 
 #define SUPPORTED_AUDIO_CAPS_STRING                                                                                    \
   "audio/x-raw, "                                                                                                      \
   "           format = { (string)S16LE, (string)S32LE, (string)F32LE, (string)F64LE }, "                               \
   "             rate = [ 1, 2147483647 ], "                                                                            \
-  "         channels = { (int)1, (int)2, (int)5 }, "                                                                   \
-  "           layout = interleaved"
+  "         channels = [ 1, 2147483647 ], "                                                                            \
+  "           layout = { (string)interleaved, (string)non-interleaved }"
 
 #define SUPPORTED_VIDEO_CAPS_STRING                                                                                    \
   "video/x-raw, "                                                                                                      \
@@ -39,6 +41,12 @@
                                          "layout = (string) interleaved, "                                             \
                                          "rate = (int) 48000, "                                                        \
                                          "channels = (int) 2"
+#define S16_MONO_CAPS_STRING                                                                                           \
+  "audio/x-raw, "                                                                                                      \
+  "format = (string) " GST_AUDIO_NE(S16) ", "                                                                          \
+                                         "layout = (string) interleaved, "                                             \
+                                         "rate = (int) 48000, "                                                        \
+                                         "channels = (int) 1"
 #define F32_CAPS_STRING                                                                                                \
   "audio/x-raw, "                                                                                                      \
   "format = (string) " GST_AUDIO_NE(F32) ", "                                                                          \
@@ -141,6 +149,36 @@ static GstBuffer *create_buffer(const char *caps_string, const guint num_msecs)
   return buf;
 }
 
+static GstBuffer *create_silent_buffer(const char *caps_string, const guint num_msecs) {
+  GstBuffer *buf = create_buffer(caps_string, num_msecs);
+  gst_buffer_memset(buf, 0, 0, gst_buffer_get_size(buf));
+  return buf;
+}
+
+// 500 Hz Triangle, 1/8 (0.2) FS, in every channel of an interleaved S16 buffer
+static GstBuffer *create_triangle_buffer(const char *caps_string, const guint num_msecs) {
+  GstBuffer *buf = create_buffer(caps_string, num_msecs);
+
+  GstAudioInfo audio_info;
+  caps_to_audio_info(caps_string, &audio_info);
+
+  GstMapInfo map;
+  gst_buffer_map(buf, &map, GST_MAP_WRITE);
+
+  gshort *ptr = (gshort *)map.data;
+  guint num_samples_per_wave = audio_info.rate / 500 /* Hz */;
+  guint num_frames = audio_info.rate * num_msecs / 1000;
+  for (guint frame_idx = 0; frame_idx < num_frames; frame_idx++) {
+    gshort sample = (frame_idx % num_samples_per_wave) * (G_MAXSHORT / num_samples_per_wave * 2) - G_MINSHORT;
+    for (gint channel_idx = 0; channel_idx < audio_info.channels; channel_idx++) {
+      ptr[frame_idx * audio_info.channels + channel_idx] = sample / 8;
+    }
+  }
+
+  gst_buffer_unmap(buf, &map);
+  return buf;
+}
+
 GST_START_TEST(test_setup_and_teardown) {
   setup_element(S16_CAPS_STRING);
   cleanup_element();
@@ -545,6 +583,123 @@ GST_END_TEST;
 GST_START_TEST(test_peak_gauge_upper_limi) { test_double_property("peak_gauge_upper_limit", -25.75); }
 GST_END_TEST;
 
+static gdouble get_latest_global(void) {
+  GstEbur128Latest latest;
+  gboolean valid = FALSE;
+  g_signal_emit_by_name(element, "get-latest", &latest, &valid);
+  fail_unless(valid);
+  return latest.global;
+}
+
+GST_START_TEST(test_get_latest) {
+  setup_element_for_buffer_test();
+
+  GstEbur128Latest latest;
+  gboolean valid = TRUE;
+  g_signal_emit_by_name(element, "get-latest", &latest, &valid);
+  fail_unless(!valid);
+
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 1000));
+
+  g_signal_emit_by_name(element, "get-latest", &latest, &valid);
+  fail_unless(valid);
+
+  fail_unless(latest.flags & GST_EBUR128_META_GLOBAL);
+  fail_unless(latest.flags & GST_EBUR128_META_RANGE);
+  fail_unless_equals_int(latest.channels, 2);
+  GST_INFO("got momentary=%f global=%f true-peak=%f", latest.momentary, latest.global, latest.true_peak[0]);
+  fail_unless(-20.0 < latest.momentary && latest.momentary < -19.0);
+  fail_unless(-20.0 < latest.global && latest.global < -19.0);
+  fail_unless(0.15 < latest.true_peak[0] && latest.true_peak[0] < 0.16);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_gating_engine_change_keeps_global) {
+  setup_element_for_buffer_test();
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 1000));
+  gdouble global_before = get_latest_global();
+
+  // like in the ebur128 Element the blocks are carried over into the histograms, silence does not add to them
+  gst_util_set_object_arg(G_OBJECT(element), "gating-engine", "histogram");
+  gst_pad_push(mysrcpad, create_silent_buffer(S16_CAPS_STRING, 1000));
+
+  GstEbur128Graph *graph = (GstEbur128Graph *)element;
+  fail_unless_equals_int(graph->state->gating_engine, GST_EBUR128_GATING_ENGINE_HISTOGRAM);
+
+  gdouble global = get_latest_global();
+  GST_INFO("got global=%f, before=%f", global, global_before);
+  fail_unless(fabs(global - global_before) < 0.01);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+GST_START_TEST(test_renegotiation_keeps_global) {
+  setup_element_for_buffer_test();
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 1000));
+  gdouble global_before = get_latest_global();
+
+  // a new channel-layout is analyzed by a new state continuing the old one, silence does not add to it
+  GstCaps *caps = gst_caps_from_string(S16_MONO_CAPS_STRING);
+  fail_unless(gst_pad_push_event(mysrcpad, gst_event_new_caps(caps)));
+  gst_caps_unref(caps);
+  gst_pad_push(mysrcpad, create_silent_buffer(S16_MONO_CAPS_STRING, 1000));
+
+  gdouble global = get_latest_global();
+  GST_INFO("got global=%f, before=%f", global, global_before);
+  fail_unless_equals_float(global, global_before);
+
+  cleanup_element();
+}
+GST_END_TEST;
+
+// a loud second followed by a quiet one, returns the true-peak since the start and the skipped lane-groups
+static guint64 measure_true_peak_skipped(gboolean peak_gauge, gdouble *true_peak) {
+  setup_element_for_buffer_test();
+  g_object_set(element, "peak-gauge", peak_gauge, NULL);
+
+  gst_pad_push(mysrcpad, create_triangle_buffer(S16_CAPS_STRING, 1000));
+
+  GstBuffer *quiet = create_triangle_buffer(S16_CAPS_STRING, 1000);
+  GstMapInfo map;
+  gst_buffer_map(quiet, &map, GST_MAP_WRITE);
+  gshort *samples = (gshort *)map.data;
+  for (gsize i = 0; i < map.size / sizeof(gshort); i++) {
+    samples[i] /= 4;
+  }
+  gst_buffer_unmap(quiet, &map);
+  gst_pad_push(mysrcpad, quiet);
+
+  GstEbur128Latest latest;
+  gboolean valid = FALSE;
+  g_signal_emit_by_name(element, "get-latest", &latest, &valid);
+  fail_unless(valid);
+  *true_peak = latest.true_peak[0];
+
+  guint64 skipped = ((GstEbur128Graph *)element)->state->truepeak_skipped;
+  cleanup_element();
+  return skipped;
+}
+
+GST_START_TEST(test_true_peak_skips_quiet_blocks) {
+  // the peak-gauge draws the true-peak of every measurement, so the quiet second is oversampled in full
+  gdouble exact;
+  guint64 exact_skipped = measure_true_peak_skipped(TRUE, &exact);
+
+  // without it only the true-peak since the start is needed, which the quiet second can not raise
+  gdouble true_peak;
+  guint64 skipped = measure_true_peak_skipped(FALSE, &true_peak);
+
+  GST_INFO("got true-peak=%f with %" G_GUINT64_FORMAT " skipped, exact=%f with %" G_GUINT64_FORMAT " skipped",
+           true_peak, skipped, exact, exact_skipped);
+  fail_unless(skipped >= exact_skipped + 9);
+  fail_unless_equals_float(true_peak, exact);
+  fail_unless(0.15 < true_peak && true_peak < 0.16);
+}
+GST_END_TEST;
+
 static Suite *element_suite(void) {
   Suite *s = suite_create("ebur128graph");
 
@@ -561,6 +716,11 @@ static Suite *element_suite(void) {
   tcase_add_test(tc_general, test_generates_video_frame_rate_30fps);
   tcase_add_test(tc_general, test_generates_video_frame_rate_60fps);
 
+  tcase_add_test(tc_general, test_get_latest);
+  tcase_add_test(tc_general, test_gating_engine_change_keeps_global);
+  tcase_add_test(tc_general, test_renegotiation_keeps_global);
+  tcase_add_test(tc_general, test_true_peak_skips_quiet_blocks);
+
   TCase *tc_audio_formats = tcase_create("audio_formats");
   suite_add_tcase(s, tc_audio_formats);
   tcase_add_test(tc_audio_formats, test_accepts_s16);
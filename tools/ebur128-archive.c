@@ -0,0 +1,211 @@
+/**
+ * Command-Line Tool to inspect and query the Loudness-Archives written by the ebur128 Element with log-format=archive.
+ *
+ *     ebur128-archive info loudness.archive
+ *     ebur128-archive dump --start=2024-03-01T12:00:00Z --stop=2024-03-01T13:00:00Z loudness.archive
+ *
+ * Times are ISO 8601 or nanoseconds since the UNIX-Epoch. dump prints CSV with the columns of log-format=csv,
+ * preceded by the wall-clock time, and repeats the header-line whenever the Layout of the Records changes.
+ */
+#include "../src/gstebur128archive.h"
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+  guint32 flags;
+  guint32 channels;
+  guint32 num_windows;
+  gboolean has_layout;
+  guint64 records;
+} DumpState;
+
+static gboolean parse_time(const gchar *option_name, const gchar *value, gint64 *time, GError **error) {
+  if (value == NULL) {
+    return TRUE;
+  }
+
+  gchar *end;
+  gint64 nanoseconds = g_ascii_strtoll(value, &end, 10);
+  if (*value != '\0' && *end == '\0') {
+    *time = nanoseconds;
+    return TRUE;
+  }
+
+  GDateTime *date_time = g_date_time_new_from_iso8601(value, NULL);
+  if (date_time == NULL) {
+    g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "--%s is neither ISO 8601 nor nanoseconds: %s\n",
+                option_name, value);
+    return FALSE;
+  }
+  *time = g_date_time_to_unix(date_time) * G_GINT64_CONSTANT(1000000000) +
+          (gint64)g_date_time_get_microsecond(date_time) * 1000;
+  g_date_time_unref(date_time);
+  return TRUE;
+}
+
+static gchar *format_time(gint64 time) {
+  GDateTime *date_time = g_date_time_new_from_unix_utc(time / G_GINT64_CONSTANT(1000000000));
+  if (date_time == NULL) {
+    return g_strdup_printf("%" G_GINT64_FORMAT, time);
+  }
+
+  gchar *seconds = g_date_time_format(date_time, "%Y-%m-%dT%H:%M:%S");
+  gchar *formatted =
+      g_strdup_printf("%s.%03dZ", seconds, (gint)((time % G_GINT64_CONSTANT(1000000000)) / G_GINT64_CONSTANT(1000000)));
+  g_free(seconds);
+  g_date_time_unref(date_time);
+  return formatted;
+}
+
+static void print_double(gdouble value) {
+  gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+  printf(",%s", g_ascii_formatd(buffer, sizeof(buffer), "%.6f", value));
+}
+
+static void print_header(const GstEbur128MeasurementRecord *record) {
+  printf("time,timestamp,running-time,stream-time,momentary,shortterm,global,range");
+  for (guint i = 0; i < record->num_windows; i++) {
+    printf(",window-%u", i);
+  }
+  for (guint channel = 0; channel < record->channels; channel++) {
+    printf(",sample-peak-%u", channel);
+  }
+  for (guint channel = 0; channel < record->channels; channel++) {
+    printf(",true-peak-%u", channel);
+  }
+  printf("\n");
+}
+
+static gboolean dump_record(gint64 time, const GstEbur128MeasurementRecord *record, gpointer user_data) {
+  DumpState *state = user_data;
+  if (!state->has_layout || state->flags != record->flags || state->channels != record->channels ||
+      state->num_windows != record->num_windows) {
+    print_header(record);
+    state->flags = record->flags;
+    state->channels = record->channels;
+    state->num_windows = record->num_windows;
+    state->has_layout = TRUE;
+  }
+
+  gchar *formatted = format_time(time);
+  printf("%s,%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT, formatted, record->timestamp,
+         record->running_time, record->stream_time);
+  g_free(formatted);
+
+  // disabled measurements stay empty, like with log-format=csv
+  const gdouble loudness[] = {record->momentary, record->shortterm, record->global, record->range};
+  const guint32 loudness_flags[] = {GST_EBUR128_META_MOMENTARY, GST_EBUR128_META_SHORTTERM, GST_EBUR128_META_GLOBAL,
+                                    GST_EBUR128_META_RANGE};
+  for (guint i = 0; i < G_N_ELEMENTS(loudness); i++) {
+    if (record->flags & loudness_flags[i]) {
+      print_double(loudness[i]);
+    } else {
+      printf(",");
+    }
+  }
+
+  for (guint i = 0; i < record->num_windows; i++) {
+    print_double(gst_ebur128_measurement_windows(record)[i]);
+  }
+
+  const gdouble *peaks[] = {gst_ebur128_measurement_sample_peak(record), gst_ebur128_measurement_true_peak(record)};
+  const guint32 peak_flags[] = {GST_EBUR128_META_SAMPLE_PEAK, GST_EBUR128_META_TRUE_PEAK};
+  for (guint i = 0; i < G_N_ELEMENTS(peaks); i++) {
+    for (guint channel = 0; channel < record->channels; channel++) {
+      if (record->flags & peak_flags[i]) {
+        print_double(peaks[i][channel]);
+      } else {
+        printf(",");
+      }
+    }
+  }
+  printf("\n");
+
+  state->records++;
+  return TRUE;
+}
+
+static int info(GstEbur128ArchiveReader *reader, const gchar *location) {
+  guint n_blocks = gst_ebur128_archive_reader_get_n_blocks(reader);
+  guint64 records = 0;
+  gint64 first = G_MAXINT64, last = G_MININT64;
+  for (guint i = 0; i < n_blocks; i++) {
+    const GstEbur128ArchiveBlock *block = gst_ebur128_archive_reader_get_block(reader, i);
+    records += block->records;
+    first = MIN(first, block->first_time);
+    last = MAX(last, block->last_time);
+  }
+
+  GStatBuf stat;
+  if (g_stat(location, &stat) == 0) {
+    printf("size:    %" G_GUINT64_FORMAT " bytes", (guint64)stat.st_size);
+    if (records > 0) {
+      printf(" (%.1f bytes per record)", (gdouble)stat.st_size / records);
+    }
+    printf("\n");
+  }
+  printf("blocks:  %u\n", n_blocks);
+  printf("records: %" G_GUINT64_FORMAT "\n", records);
+
+  if (records > 0) {
+    gchar *formatted_first = format_time(first);
+    gchar *formatted_last = format_time(last);
+    printf("first:   %s\n", formatted_first);
+    printf("last:    %s\n", formatted_last);
+    g_free(formatted_first);
+    g_free(formatted_last);
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  gchar *start_value = NULL, *stop_value = NULL;
+  GOptionEntry entries[] = {
+      {"start", 's', 0, G_OPTION_ARG_STRING, &start_value, "Only dump Records measured at or after TIME", "TIME"},
+      {"stop", 'e', 0, G_OPTION_ARG_STRING, &stop_value, "Only dump Records measured before TIME", "TIME"},
+      {NULL}};
+
+  GOptionContext *context = g_option_context_new("info|dump ARCHIVE");
+  g_option_context_add_main_entries(context, entries, NULL);
+
+  GError *error = NULL;
+  gint64 start = G_MININT64, stop = G_MAXINT64;
+  if (!g_option_context_parse(context, &argc, &argv, &error) || !parse_time("start", start_value, &start, &error) ||
+      !parse_time("stop", stop_value, &stop, &error) || argc != 3 ||
+      (g_strcmp0(argv[1], "info") != 0 && g_strcmp0(argv[1], "dump") != 0)) {
+    gchar *help = g_option_context_get_help(context, TRUE, NULL);
+    fprintf(stderr, "%s%s", error != NULL ? error->message : "", help);
+    g_free(help);
+    g_clear_error(&error);
+    g_option_context_free(context);
+    g_free(start_value);
+    g_free(stop_value);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free(context);
+  g_free(start_value);
+  g_free(stop_value);
+
+  GstEbur128ArchiveReader *reader = gst_ebur128_archive_reader_open(argv[2], &error);
+  if (reader == NULL) {
+    fprintf(stderr, "%s\n", error->message);
+    g_error_free(error);
+    return EXIT_FAILURE;
+  }
+
+  int ret = EXIT_SUCCESS;
+  if (g_strcmp0(argv[1], "info") == 0) {
+    ret = info(reader, argv[2]);
+  } else {
+    DumpState state = {0};
+    if (!gst_ebur128_archive_reader_query(reader, start, stop, dump_record, &state, &error)) {
+      fprintf(stderr, "%s\n", error->message);
+      g_error_free(error);
+      ret = EXIT_FAILURE;
+    }
+  }
+
+  gst_ebur128_archive_reader_close(reader);
+  return ret;
+}